@@ -23,6 +23,22 @@
 #include <stdexcept>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define MMKV_VARINT_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#    include <arm_neon.h>
+#    define MMKV_VARINT_NEON
+#endif
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_ARM64))
+#    include <intrin.h>
+#endif
+
+// the word at a time decoding assumes little-endian
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+#    define MMKV_VARINT_WORD
+#endif
+
 #ifdef MMKV_APPLE
 #    if __has_feature(objc_arc)
 #        error This file must be compiled with MRC. Use -fno-objc-arc flag.
@@ -33,109 +49,256 @@ using namespace std;
 
 namespace mmkv {
 
+// the error messages of the exception-free decoding, also thrown by the compatible API
+constexpr const char *ErrorReachEnd = "InvalidProtocolBuffer reach end";
+constexpr const char *ErrorTruncated = "InvalidProtocolBuffer truncatedMessage";
+constexpr const char *ErrorNegativeSize = "InvalidProtocolBuffer negativeSize";
+constexpr const char *ErrorMalformedVarint32 = "InvalidProtocolBuffer malformed varint32";
+constexpr const char *ErrorMalformedInt64 = "InvalidProtocolBuffer malformedInt64";
+constexpr const char *ErrorOutOfSpace = "OutOfSpace";
+constexpr const char *ErrorMalformedKeyReference = "InvalidProtocolBuffer malformed key reference";
+
 CodedInputData::CodedInputData(const void *oData, size_t length)
     : m_ptr((uint8_t *) oData), m_size(length), m_position(0) {
     MMKV_ASSERT(m_ptr);
 }
 
-void CodedInputData::seek(size_t addedSize) {
-    if (m_position + addedSize > m_size) {
-        throw out_of_range("OutOfSpace");
+void CodedInputData::throwLastError() const {
+    if (m_error == ErrorReachEnd || m_error == ErrorTruncated || m_error == ErrorOutOfSpace) {
+        throw out_of_range(m_error);
+    } else if (m_error == ErrorNegativeSize) {
+        throw length_error(m_error);
+    }
+    throw invalid_argument(m_error ? m_error : "decode fail");
+}
+
+bool CodedInputData::trySeek(size_t addedSize) {
+    if (addedSize > m_size - m_position) {
+        return fail(ErrorOutOfSpace);
     }
     m_position += addedSize;
+    return true;
 }
 
-double CodedInputData::readDouble() {
-    return Int64ToFloat64(this->readRawLittleEndian64());
+void CodedInputData::seek(size_t addedSize) {
+    if (!trySeek(addedSize)) {
+        throwLastError();
+    }
 }
 
-float CodedInputData::readFloat() {
-    return Int32ToFloat32(this->readRawLittleEndian32());
+bool CodedInputData::tryReadDouble(double &value) {
+    int64_t bits;
+    if (mmkv_unlikely(!tryReadRawLittleEndian64(bits))) {
+        return false;
+    }
+    value = Int64ToFloat64(bits);
+    return true;
 }
 
-int64_t CodedInputData::readInt64() {
+bool CodedInputData::tryReadFloat(float &value) {
+    int32_t bits;
+    if (mmkv_unlikely(!tryReadRawLittleEndian32(bits))) {
+        return false;
+    }
+    value = Int32ToFloat32(bits);
+    return true;
+}
+
+#ifdef MMKV_VARINT_WORD
+
+constexpr uint64_t VarintStopBits = 0x8080808080808080ULL;
+
+// index of the lowest set bit, x != 0
+static inline uint32_t lowestBitIndex(uint64_t x) {
+#    if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(x));
+#    elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanForward64(&index, x);
+    return static_cast<uint32_t>(index);
+#    else
+    uint32_t index = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        index++;
+    }
+    return index;
+#    endif
+}
+
+// decode the varint at the start of an 8 bytes word, return its length, or 0 if it's longer than that
+static inline size_t decodeVarintWord(const uint8_t *ptr, uint64_t &value) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    auto stops = ~word & VarintStopBits;
+    if (mmkv_unlikely(stops == 0)) {
+        return 0;
+    }
+    auto stopBit = lowestBitIndex(stops);
+    // keep the bytes up to the stop byte, then squeeze out the continuation bits
+    auto x = word & (~0ULL >> (63 - stopBit)) & ~VarintStopBits;
+    x = ((x & 0x7f007f007f007f00ULL) >> 1) | (x & 0x007f007f007f007fULL);
+    x = ((x & 0x3fff00003fff0000ULL) >> 2) | (x & 0x00003fff00003fffULL);
+    x = ((x & 0x0fffffff00000000ULL) >> 4) | (x & 0x000000000fffffffULL);
+    value = x;
+    return (stopBit >> 3) + 1;
+}
+
+#endif // MMKV_VARINT_WORD
+
+bool CodedInputData::readVarintFast(uint64_t &value) {
+#ifdef MMKV_VARINT_WORD
+    if (mmkv_likely(m_size - m_position >= sizeof(uint64_t))) {
+        auto length = decodeVarintWord(m_ptr + m_position, value);
+        m_position += length;
+        return length != 0;
+    }
+#endif
+    return false;
+}
+
+bool CodedInputData::tryReadInt64(int64_t &value) {
+    uint64_t fastValue;
+    if (mmkv_likely(readVarintFast(fastValue))) {
+        value = static_cast<int64_t>(fastValue);
+        return true;
+    }
     int32_t shift = 0;
     int64_t result = 0;
     while (shift < 64) {
-        int8_t b = this->readRawByte();
+        int8_t b;
+        if (mmkv_unlikely(!tryReadRawByte(b))) {
+            return false;
+        }
         result |= (int64_t)(b & 0x7f) << shift;
         if ((b & 0x80) == 0) {
-            return result;
+            value = result;
+            return true;
         }
         shift += 7;
     }
-    throw invalid_argument("InvalidProtocolBuffer malformedInt64");
+    return fail(ErrorMalformedInt64);
 }
 
-uint64_t CodedInputData::readUInt64() {
-    return static_cast<uint64_t>(readInt64());
+bool CodedInputData::tryReadUInt64(uint64_t &value) {
+    int64_t result;
+    if (mmkv_unlikely(!tryReadInt64(result))) {
+        return false;
+    }
+    value = static_cast<uint64_t>(result);
+    return true;
 }
 
-int32_t CodedInputData::readInt32() {
-    return this->readRawVarint32();
+bool CodedInputData::tryReadInt32(int32_t &value) {
+    return tryReadRawVarint32(value);
 }
 
-uint32_t CodedInputData::readUInt32() {
-    return static_cast<uint32_t>(readRawVarint32());
+bool CodedInputData::tryReadUInt32(uint32_t &value) {
+    int32_t result;
+    if (mmkv_unlikely(!tryReadRawVarint32(result))) {
+        return false;
+    }
+    value = static_cast<uint32_t>(result);
+    return true;
 }
 
-bool CodedInputData::readBool() {
-    return this->readRawVarint32() != 0;
+bool CodedInputData::tryReadBool(bool &value) {
+    int32_t result;
+    if (mmkv_unlikely(!tryReadRawVarint32(result))) {
+        return false;
+    }
+    value = (result != 0);
+    return true;
+}
+
+// the size of a length-delimited field that fits in the rest of the data
+bool CodedInputData::tryReadSize(size_t &size) {
+    int32_t value;
+    if (mmkv_unlikely(!tryReadRawVarint32(value))) {
+        return false;
+    }
+    if (mmkv_unlikely(value < 0)) {
+        return fail(ErrorNegativeSize);
+    }
+    size = static_cast<size_t>(value);
+    if (mmkv_unlikely(size > m_size - m_position)) {
+        return fail(ErrorTruncated);
+    }
+    return true;
 }
 
 #ifndef MMKV_APPLE
 
-string CodedInputData::readString() {
-    int32_t size = readRawVarint32();
-    if (size < 0) {
-        throw length_error("InvalidProtocolBuffer negativeSize");
+bool CodedInputData::tryReadString(string &value) {
+    size_t size;
+    if (mmkv_unlikely(!tryReadSize(size))) {
+        return false;
     }
+    value.resize(size);
+    memcpy((void *) value.data(), (char *) (m_ptr + m_position), size);
+    m_position += size;
+    return true;
+}
+
+bool CodedInputData::tryReadString(KeyValueHolder &kvHolder, string &key) {
+    kvHolder.offset = static_cast<uint32_t>(m_position);
 
-    auto s_size = static_cast<size_t>(size);
-    if (s_size <= m_size - m_position) {
-        string result((char *) (m_ptr + m_position), s_size);
-        m_position += s_size;
-        return result;
-    } else {
-        throw out_of_range("InvalidProtocolBuffer truncatedMessage");
+    int32_t value;
+    if (mmkv_unlikely(!tryReadRawVarint32(value))) {
+        return false;
+    }
+    if (mmkv_unlikely(value < 0)) {
+        return fail(ErrorNegativeSize);
     }
+    auto size = static_cast<size_t>(value);
+    if (mmkv_unlikely(size >= KeyValueHolder::KeyReferenceBase)) {
+        return tryReadKeyReference(kvHolder, size - KeyValueHolder::KeyReferenceBase, key);
+    }
+    if (mmkv_unlikely(size > m_size - m_position)) {
+        return fail(ErrorTruncated);
+    }
+    kvHolder.keySize = static_cast<uint16_t>(size);
+    key.assign((char *) (m_ptr + m_position), size);
+    m_position += size;
+    return true;
 }
 
-void CodedInputData::readString(string &s) {
-    int32_t size = readRawVarint32();
-    if (size < 0) {
-        throw length_error("InvalidProtocolBuffer negativeSize");
+// the key is held by an earlier record, which must hold the key itself
+bool CodedInputData::tryReadKeyReference(KeyValueHolder &kvHolder, size_t keyOffset, string &key) {
+    if (keyOffset >= kvHolder.offset) {
+        return fail(ErrorMalformedKeyReference);
     }
-
-    auto s_size = static_cast<size_t>(size);
-    if (s_size <= m_size - m_position) {
-        s.resize(s_size);
-        memcpy((void *) s.data(), (char *) (m_ptr + m_position), s_size);
-        m_position += s_size;
-    } else {
-        throw out_of_range("InvalidProtocolBuffer truncatedMessage");
+    CodedInputData input(m_ptr, kvHolder.offset);
+    size_t size;
+    if (!input.trySeek(keyOffset) || !input.tryReadSize(size) || size == 0 ||
+        size >= KeyValueHolder::KeyReferenceBase) {
+        return fail(ErrorMalformedKeyReference);
     }
+    kvHolder.keySize = 0;
+    key.assign((char *) (m_ptr + input.m_position), size);
+    return true;
 }
 
-string CodedInputData::readString(KeyValueHolder &kvHolder) {
-    kvHolder.offset = static_cast<uint32_t>(m_position);
-
-    int32_t size = this->readRawVarint32();
-    if (size < 0) {
-        throw length_error("InvalidProtocolBuffer negativeSize");
+string CodedInputData::readString() {
+    string result;
+    if (!tryReadString(result)) {
+        throwLastError();
     }
+    return result;
+}
 
-    auto s_size = static_cast<size_t>(size);
-    if (s_size <= m_size - m_position) {
-        kvHolder.keySize = static_cast<uint16_t>(s_size);
+void CodedInputData::readString(string &s) {
+    if (!tryReadString(s)) {
+        throwLastError();
+    }
+}
 
-        auto ptr = m_ptr + m_position;
-        string result((char *) (m_ptr + m_position), s_size);
-        m_position += s_size;
-        return result;
-    } else {
-        throw out_of_range("InvalidProtocolBuffer truncatedMessage");
+string CodedInputData::readString(KeyValueHolder &kvHolder) {
+    string result;
+    if (!tryReadString(kvHolder, result)) {
+        throwLastError();
     }
+    return result;
 }
 
 #endif
@@ -145,105 +308,257 @@ MMBuffer CodedInputData::readRealData(mmkv::MMBuffer & data) {
     return input.readData(false, true);
 }
 
-MMBuffer CodedInputData::readData(bool copy, bool exactly) {
-    int32_t size = this->readRawVarint32();
-    if (size < 0) {
-        throw length_error("InvalidProtocolBuffer negativeSize");
+bool CodedInputData::tryReadData(MMBuffer &value, bool copy, bool exactly) {
+    size_t size;
+    if (mmkv_unlikely(!tryReadSize(size))) {
+        return false;
+    }
+    if (exactly && size != m_size - m_position) {
+        return fail(ErrorTruncated);
+    }
+    size_t pos = m_position;
+    m_position += size;
+    auto copyFlag = copy ? MMBufferCopy : MMBufferNoCopy;
+    value = MMBuffer(((int8_t *) m_ptr) + pos, size, copyFlag);
+    return true;
+}
+
+bool CodedInputData::tryReadData(KeyValueHolder &kvHolder) {
+    size_t size;
+    if (mmkv_unlikely(!tryReadSize(size))) {
+        return false;
     }
+    kvHolder.computedKVSize = static_cast<uint16_t>(m_position - kvHolder.offset);
+    kvHolder.valueSize = static_cast<uint32_t>(size);
+    m_position += size;
+    return true;
+}
 
-    auto s_size = static_cast<size_t>(size);
-    bool isSizeValid = exactly ? (s_size == m_size - m_position) : (s_size <= m_size - m_position);
-    if (isSizeValid) {
-        size_t pos = m_position;
-        m_position += s_size;
-        auto copyFlag = copy ? MMBufferCopy : MMBufferNoCopy;
-        return MMBuffer(((int8_t *) m_ptr) + pos, s_size, copyFlag);
-    } else {
-        throw out_of_range("InvalidProtocolBuffer truncatedMessage");
+MMBuffer CodedInputData::readData(bool copy, bool exactly) {
+    MMBuffer result;
+    if (!tryReadData(result, copy, exactly)) {
+        throwLastError();
     }
+    return result;
 }
 
 void CodedInputData::readData(KeyValueHolder &kvHolder) {
-    int32_t size = this->readRawVarint32();
-    if (size < 0) {
-        throw length_error("InvalidProtocolBuffer negativeSize");
+    if (!tryReadData(kvHolder)) {
+        throwLastError();
+    }
+}
+
+bool CodedInputData::tryReadRawVarint32(int32_t &value) {
+    // most sizes of keys & values take just one byte
+    if (mmkv_likely(m_position < m_size) && static_cast<int8_t>(m_ptr[m_position]) >= 0) {
+        value = m_ptr[m_position++];
+        return true;
+    }
+    // longer ones keep the lower 32 bits, the same as the byte by byte path
+    uint64_t fastValue;
+    if (mmkv_likely(readVarintFast(fastValue))) {
+        value = static_cast<int32_t>(fastValue);
+        return true;
+    }
+    int32_t result = 0;
+    for (int32_t shift = 0; shift < 32; shift += 7) {
+        int8_t tmp;
+        if (mmkv_unlikely(!tryReadRawByte(tmp))) {
+            return false;
+        }
+        result |= static_cast<int32_t>(static_cast<uint32_t>(tmp & 0x7f) << shift);
+        if (tmp >= 0) {
+            value = result;
+            return true;
+        }
+    }
+    // discard upper 32 bits
+    for (int i = 0; i < 5; i++) {
+        int8_t tmp;
+        if (mmkv_unlikely(!tryReadRawByte(tmp))) {
+            return false;
+        }
+        if (tmp >= 0) {
+            value = result;
+            return true;
+        }
+    }
+    return fail(ErrorMalformedVarint32);
+}
+
+bool CodedInputData::tryReadRawLittleEndian32(int32_t &value) {
+    if (mmkv_unlikely(m_size - m_position < sizeof(int32_t))) {
+        return fail(ErrorReachEnd);
     }
+    auto ptr = m_ptr + m_position;
+    value = static_cast<int32_t>((uint32_t) ptr[0] | ((uint32_t) ptr[1] << 8) | ((uint32_t) ptr[2] << 16) |
+                                 ((uint32_t) ptr[3] << 24));
+    m_position += sizeof(int32_t);
+    return true;
+}
 
-    auto s_size = static_cast<size_t>(size);
-    if (s_size <= m_size - m_position) {
-        kvHolder.computedKVSize = static_cast<uint16_t>(m_position - kvHolder.offset);
-        kvHolder.valueSize = static_cast<uint32_t>(s_size);
+bool CodedInputData::tryReadRawLittleEndian64(int64_t &value) {
+    if (mmkv_unlikely(m_size - m_position < sizeof(int64_t))) {
+        return fail(ErrorReachEnd);
+    }
+    auto ptr = m_ptr + m_position;
+    uint64_t result = 0;
+    for (size_t index = 0; index < sizeof(int64_t); index++) {
+        result |= (uint64_t) ptr[index] << (index * 8);
+    }
+    value = static_cast<int64_t>(result);
+    m_position += sizeof(int64_t);
+    return true;
+}
 
-        m_position += s_size;
-    } else {
-        throw out_of_range("InvalidProtocolBuffer truncatedMessage");
+bool CodedInputData::tryReadRawByte(int8_t &value) {
+    if (mmkv_unlikely(m_position == m_size)) {
+        return fail(ErrorReachEnd);
     }
+    value = static_cast<int8_t>(m_ptr[m_position++]);
+    return true;
 }
 
 int32_t CodedInputData::readRawVarint32() {
-    int8_t tmp = this->readRawByte();
-    if (tmp >= 0) {
-        return tmp;
-    }
-    int32_t result = tmp & 0x7f;
-    if ((tmp = this->readRawByte()) >= 0) {
-        result |= tmp << 7;
-    } else {
-        result |= (tmp & 0x7f) << 7;
-        if ((tmp = this->readRawByte()) >= 0) {
-            result |= tmp << 14;
-        } else {
-            result |= (tmp & 0x7f) << 14;
-            if ((tmp = this->readRawByte()) >= 0) {
-                result |= tmp << 21;
-            } else {
-                result |= (tmp & 0x7f) << 21;
-                result |= (tmp = this->readRawByte()) << 28;
-                if (tmp < 0) {
-                    // discard upper 32 bits
-                    for (int i = 0; i < 5; i++) {
-                        if (this->readRawByte() >= 0) {
-                            return result;
-                        }
-                    }
-                    throw invalid_argument("InvalidProtocolBuffer malformed varint32");
-                }
+    int32_t value;
+    if (!tryReadRawVarint32(value)) {
+        throwLastError();
+    }
+    return value;
+}
+
+// the compatible API throwing on error
+
+double CodedInputData::readDouble() {
+    double value;
+    if (!tryReadDouble(value)) {
+        throwLastError();
+    }
+    return value;
+}
+
+float CodedInputData::readFloat() {
+    float value;
+    if (!tryReadFloat(value)) {
+        throwLastError();
+    }
+    return value;
+}
+
+int64_t CodedInputData::readInt64() {
+    int64_t value;
+    if (!tryReadInt64(value)) {
+        throwLastError();
+    }
+    return value;
+}
+
+uint64_t CodedInputData::readUInt64() {
+    return static_cast<uint64_t>(readInt64());
+}
+
+int32_t CodedInputData::readInt32() {
+    return this->readRawVarint32();
+}
+
+uint32_t CodedInputData::readUInt32() {
+    return static_cast<uint32_t>(readRawVarint32());
+}
+
+bool CodedInputData::readBool() {
+    return this->readRawVarint32() != 0;
+}
+
+// the number of bytes with the top bit clear, which is the number of varints ending in [ptr, ptr + size)
+static size_t countVarintStops(const uint8_t *ptr, size_t size) {
+    size_t count = 0;
+    size_t index = 0;
+#if defined(MMKV_VARINT_SSE2)
+    const auto minusOne = _mm_set1_epi8(-1);
+    const auto one = _mm_set1_epi8(1);
+    const auto zero = _mm_setzero_si128();
+    for (; index + 16 <= size; index += 16) {
+        // 1 for a stop byte, summed up by the two halves
+        auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + index));
+        auto stops = _mm_and_si128(_mm_cmpgt_epi8(bytes, minusOne), one);
+        auto sums = _mm_sad_epu8(stops, zero);
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+    }
+#elif defined(MMKV_VARINT_NEON)
+    for (; index + 16 <= size; index += 16) {
+        // 1 for a stop byte, summed up across the lanes
+        auto stops = vshrq_n_u8(vmvnq_u8(vld1q_u8(ptr + index)), 7);
+        count += vaddvq_u8(stops);
+    }
+#endif
+    for (; index < size; index++) {
+        count += (ptr[index] >> 7) ^ 1;
+    }
+    return count;
+}
+
+// true if the next 16 bytes are all one byte varints
+static inline bool isSingleByteRun(const uint8_t *ptr) {
+#if defined(MMKV_VARINT_SSE2)
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr))) == 0;
+#elif defined(MMKV_VARINT_NEON)
+    return vmaxvq_u8(vld1q_u8(ptr)) < 0x80;
+#elif defined(MMKV_VARINT_WORD)
+    uint64_t words[2];
+    memcpy(words, ptr, sizeof(words));
+    return ((words[0] | words[1]) & VarintStopBits) == 0;
+#else
+    return false;
+#endif
+}
+
+template <typename T>
+bool CodedInputData::tryReadVarintsImpl(std::vector<T> &result) {
+    auto count = countVarintStops(m_ptr + m_position, m_size - m_position);
+    auto oldSize = result.size();
+    result.resize(oldSize + count);
+    auto output = result.data() + oldSize;
+    auto end = output + count;
+    while (output < end) {
+        auto remain = m_size - m_position;
+        if (remain >= 16 && isSingleByteRun(m_ptr + m_position)) {
+            // there must be at least 16 more varints
+            auto ptr = m_ptr + m_position;
+            for (size_t index = 0; index < 16; index++) {
+                output[index] = static_cast<T>(ptr[index]);
             }
+            output += 16;
+            m_position += 16;
+            continue;
         }
+        int64_t value;
+        if (mmkv_unlikely(!tryReadInt64(value))) {
+            result.resize(oldSize);
+            return false;
+        }
+        *output++ = static_cast<T>(value);
     }
-    return result;
+    if (m_position != m_size) {
+        result.resize(oldSize);
+        return fail(ErrorTruncated);
+    }
+    return true;
+}
+
+bool CodedInputData::tryReadVarints(std::vector<int32_t> &result) {
+    return tryReadVarintsImpl(result);
+}
+
+bool CodedInputData::tryReadVarints(std::vector<uint32_t> &result) {
+    return tryReadVarintsImpl(result);
+}
+
+bool CodedInputData::tryReadVarints(std::vector<int64_t> &result) {
+    return tryReadVarintsImpl(result);
 }
 
-int32_t CodedInputData::readRawLittleEndian32() {
-    int8_t b1 = this->readRawByte();
-    int8_t b2 = this->readRawByte();
-    int8_t b3 = this->readRawByte();
-    int8_t b4 = this->readRawByte();
-    return (((int32_t) b1 & 0xff)) | (((int32_t) b2 & 0xff) << 8) | (((int32_t) b3 & 0xff) << 16) |
-           (((int32_t) b4 & 0xff) << 24);
-}
-
-int64_t CodedInputData::readRawLittleEndian64() {
-    int8_t b1 = this->readRawByte();
-    int8_t b2 = this->readRawByte();
-    int8_t b3 = this->readRawByte();
-    int8_t b4 = this->readRawByte();
-    int8_t b5 = this->readRawByte();
-    int8_t b6 = this->readRawByte();
-    int8_t b7 = this->readRawByte();
-    int8_t b8 = this->readRawByte();
-    return (((int64_t) b1 & 0xff)) | (((int64_t) b2 & 0xff) << 8) | (((int64_t) b3 & 0xff) << 16) |
-           (((int64_t) b4 & 0xff) << 24) | (((int64_t) b5 & 0xff) << 32) | (((int64_t) b6 & 0xff) << 40) |
-           (((int64_t) b7 & 0xff) << 48) | (((int64_t) b8 & 0xff) << 56);
-}
-
-int8_t CodedInputData::readRawByte() {
-    if (m_position == m_size) {
-        auto msg = "reach end, m_position: " + to_string(m_position) + ", m_size: " + to_string(m_size);
-        throw out_of_range(msg);
-    }
-    auto *bytes = (int8_t *) m_ptr;
-    return bytes[m_position++];
+bool CodedInputData::tryReadVarints(std::vector<uint64_t> &result) {
+    return tryReadVarintsImpl(result);
 }
 
 #ifdef MMKV_APPLE
@@ -27,6 +27,7 @@
 #include "KeyValueHolder.h"
 #include "MMBuffer.h"
 #include <cstdint>
+#include <vector>
 
 namespace mmkv {
 
@@ -34,20 +35,79 @@ class CodedInputData {
     uint8_t *const m_ptr;
     size_t m_size;
     size_t m_position;
+    const char *m_error = nullptr;
 
-    int8_t readRawByte();
+    bool fail(const char *error) {
+        m_error = error;
+        return false;
+    }
 
+    [[noreturn]] void throwLastError() const;
+
+    bool tryReadRawByte(int8_t &value);
+
+    bool tryReadRawVarint32(int32_t &value);
     int32_t readRawVarint32();
 
-    int32_t readRawLittleEndian32();
+    bool tryReadRawLittleEndian32(int32_t &value);
+
+    bool tryReadRawLittleEndian64(int64_t &value);
+
+    // decode a varint of up to 8 bytes in one go, return false if it needs the byte by byte path
+    bool readVarintFast(uint64_t &value);
 
-    int64_t readRawLittleEndian64();
+    bool tryReadSize(size_t &size);
+
+#ifndef MMKV_APPLE
+    bool tryReadKeyReference(KeyValueHolder &kvHolder, size_t keyOffset, std::string &key);
+#endif
+
+    template <typename T>
+    bool tryReadVarintsImpl(std::vector<T> &result);
 
 public:
     CodedInputData(const void *oData, size_t length);
 
     bool isAtEnd() const { return m_position == m_size; };
 
+    size_t getPosition() const { return m_position; }
+
+    // the reason of the last failed tryReadXXX()
+    const char *lastError() const { return m_error ? m_error : "decode fail"; }
+
+    // the exception-free API, return false on malformed or truncated data, the position is undefined after that
+    bool trySeek(size_t addedSize);
+
+    bool tryReadBool(bool &value);
+
+    bool tryReadDouble(double &value);
+
+    bool tryReadFloat(float &value);
+
+    bool tryReadInt64(int64_t &value);
+
+    bool tryReadUInt64(uint64_t &value);
+
+    bool tryReadInt32(int32_t &value);
+
+    bool tryReadUInt32(uint32_t &value);
+
+    // exactly is like getValueSize(actualSize = true)
+    bool tryReadData(MMBuffer &value, bool copy = true, bool exactly = false);
+    bool tryReadData(KeyValueHolder &kvHolder);
+
+    // decode all the varints till the end and append them to result
+    bool tryReadVarints(std::vector<int32_t> &result);
+    bool tryReadVarints(std::vector<uint32_t> &result);
+    bool tryReadVarints(std::vector<int64_t> &result);
+    bool tryReadVarints(std::vector<uint64_t> &result);
+
+#ifndef MMKV_APPLE
+    bool tryReadString(std::string &value);
+    bool tryReadString(KeyValueHolder &kvHolder, std::string &key);
+#endif
+
+    // the compatible API, throw on malformed or truncated data
     void seek(size_t addedSize);
 
     bool readBool();
@@ -64,7 +124,6 @@ public:
 
     uint32_t readUInt32();
 
-    // exactly is like getValueSize(actualSize = true)
     MMBuffer readData(bool copy = true, bool exactly = false);
     void readData(KeyValueHolder &kvHolder);
 
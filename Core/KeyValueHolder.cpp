@@ -33,6 +33,15 @@ KeyValueHolder::KeyValueHolder(uint32_t keyLength, uint32_t valueLength, uint32_
     computedKVSize += static_cast<uint16_t>(pbRawVarint32Size(valueSize));
 }
 
+KeyValueHolder::KeyValueHolder(uint32_t keyLength, uint32_t keyFieldSize, uint32_t valueLength, uint32_t off)
+    : keySize(static_cast<uint16_t>(keyLength)), valueSize(valueLength), offset(off) {
+    computedKVSize = static_cast<uint16_t>(keyFieldSize + pbRawVarint32Size(valueSize));
+}
+
+uint32_t KeyValueHolder::keyFieldSize() const {
+    return computedKVSize - pbRawVarint32Size(valueSize);
+}
+
 MMBuffer KeyValueHolder::toMMBuffer(const void *basePtr) const {
     auto realPtr = (uint8_t *) basePtr + offset;
     realPtr += computedKVSize;
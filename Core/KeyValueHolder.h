@@ -37,8 +37,18 @@ struct KeyValueHolder {
 
     KeyValueHolder() = default;
     KeyValueHolder(uint32_t keyLength, uint32_t valueLength, uint32_t offset);
+    // keyFieldSize: the size of the encoded key, or of the key reference
+    KeyValueHolder(uint32_t keyLength, uint32_t keyFieldSize, uint32_t valueLength, uint32_t offset);
 
     MMBuffer toMMBuffer(const void *basePtr) const;
+
+    // a key length of at least this is the offset of an earlier record with the same key, see MMKV::enableKeyReference()
+    static constexpr uint32_t KeyReferenceBase = 1 << 16;
+
+    // the record refers to the key of an earlier one instead of holding it
+    bool isKeyReference() const { return keySize == 0; }
+
+    uint32_t keyFieldSize() const;
 };
 
 #ifndef MMKV_DISABLE_CRYPT
@@ -23,8 +23,10 @@
 #include "InterProcessLock.h"
 #include "KeyValueHolder.h"
 #include "MMBuffer.h"
+#include "MMKVFrozen.h"
 #include "MMKVLog.h"
 #include "MMKVMetaInfo.hpp"
+#include "MMKVNamespace.h"
 #include "MMKV_IO.h"
 #include "MMKV_OSX.h"
 #include "MemoryFile.h"
@@ -37,10 +39,17 @@
 #include "aes/openssl/openssl_md5.h"
 #include "crc32/Checksum.h"
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <unordered_set>
 #include <cassert>
+#include <mutex>
+#ifndef MMKV_APPLE
+#    include <condition_variable>
+#    include <deque>
+#    include <thread>
+#endif
 
 #if defined(__aarch64__) && defined(__linux__) && !defined (MMKV_OHOS)
 #    include <asm/hwcap.h>
@@ -57,8 +66,62 @@
 using namespace std;
 using namespace mmkv;
 
-unordered_map<string, MMKV *> *g_instanceDic;
 ThreadLock *g_instanceLock;
+// see MMKV::setMemoryBudget()
+atomic<bool> g_memoryBudgetEnabled(false);
+atomic<uint64_t> g_accessTick(0);
+static size_t g_maxLoadedInstances = 0;
+static size_t g_maxMappedBytes = 0;
+
+// lookups of existing instances only lock one shard, g_instanceLock guards creation & closing
+// walking through all instances, see MMKV::allInstances(), locks the shards one by one
+struct InstanceShard {
+    mutex lock;
+    unordered_map<string, MMKV *> dic;
+};
+constexpr size_t InstanceShardCount = 16;
+static InstanceShard g_instanceShards[InstanceShardCount];
+
+static InstanceShard &instanceShard(const string &mmapKey) {
+    return g_instanceShards[hash<string>()(mmapKey) % InstanceShardCount];
+}
+
+#ifndef MMKV_APPLE
+// keys of instances being opened by the async pool, see MMKV::mmkvWithIDAsync()
+static mutex g_openingMutex;
+static condition_variable g_openingCondition;
+static unordered_set<string> g_openingKeys;
+// the async pool
+// never destructed, its threads are still waiting at exit if onExit() is not called
+static mutex &g_openPoolMutex = *new mutex();
+static condition_variable &g_openPoolCondition = *new condition_variable();
+static vector<thread> *g_openPool = nullptr;
+static deque<function<void()>> &g_openTasks = *new deque<function<void()>>();
+static bool g_openPoolStopping = false;
+
+// g_instanceLock must be held
+bool isOpeningAsync(const string &mmapKey) {
+    lock_guard<mutex> lock(g_openingMutex);
+    return g_openingKeys.find(mmapKey) != g_openingKeys.end();
+}
+
+// g_instanceLock must be held, it's released while waiting so that other lookups and the opener are not blocked
+// returns false without waiting if the caller held g_instanceLock already, which the opener would never get
+bool waitForOpeningAsync(const string &mmapKey) {
+    if (g_instanceLock->isHeldRecursively()) {
+        MMKVError("can't wait for [%s] being opened in background while holding the instance lock", mmapKey.c_str());
+        return false;
+    }
+    g_instanceLock->unlock();
+    {
+        unique_lock<mutex> lock(g_openingMutex);
+        g_openingCondition.wait(lock, [&] { return g_openingKeys.find(mmapKey) == g_openingKeys.end(); });
+    }
+    g_instanceLock->lock();
+    return true;
+}
+#endif
+
 MMKVPath_t g_rootDir;
 static mmkv::ErrorHandler g_errorHandler;
 size_t mmkv::DEFAULT_MMAP_SIZE;
@@ -66,9 +129,13 @@ size_t mmkv::DEFAULT_MMAP_SIZE;
 #ifndef MMKV_WIN32
 constexpr auto SPECIAL_CHARACTER_DIRECTORY_NAME = "specialCharacter";
 constexpr auto CRC_SUFFIX = ".crc";
+constexpr auto SNAPSHOT_SUFFIX = ".snapshot";
+constexpr auto BLOB_SUFFIX = ".blob";
 #else
 constexpr auto SPECIAL_CHARACTER_DIRECTORY_NAME = L"specialCharacter";
 constexpr auto CRC_SUFFIX = L".crc";
+constexpr auto SNAPSHOT_SUFFIX = L".snapshot";
+constexpr auto BLOB_SUFFIX = L".blob";
 #endif
 
 MMKV_NAMESPACE_BEGIN
@@ -82,7 +149,8 @@ MMKV::MMKV(const string &mmapID, MMKVMode mode, string *cryptKey, MMKVPath_t *ro
     : m_mmapID(mmapID)
     , m_mode(mode)
     , m_path(mappedKVPathWithID(m_mmapID, mode, rootPath))
-    , m_crcPath(crcPathWithID(m_mmapID, mode, rootPath))
+    // a frozen file has no meta file, the lock is taken on the file itself
+    , m_crcPath(isFrozen() ? m_path : crcPathWithID(m_mmapID, mode, rootPath))
     , m_dic(nullptr)
     , m_dicCrypt(nullptr)
     , m_expectedCapacity(std::max<size_t>(DEFAULT_MMAP_SIZE, roundUp<size_t>(expectedCapacity, DEFAULT_MMAP_SIZE)))
@@ -127,8 +195,21 @@ MMKV::MMKV(const string &mmapID, MMKVMode mode, string *cryptKey, MMKVPath_t *ro
 #endif
 
 MMKV::~MMKV() {
+    stopWriteBehind();
     clearMemoryCache();
 
+#ifndef MMKV_APPLE
+    delete m_keyIndex;
+    delete m_expireDates;
+    delete m_frozen;
+    delete m_expireQueue;
+    if (m_namespaces) {
+        for (auto &pair : *m_namespaces) {
+            delete pair.second;
+        }
+        delete m_namespaces;
+    }
+#endif
     delete m_dic;
 #ifndef MMKV_DISABLE_CRYPT
     delete m_dicCrypt;
@@ -159,7 +240,6 @@ MMKV *MMKV::defaultMMKV(MMKVMode mode, string *cryptKey) {
 }
 
 void initialize() {
-    g_instanceDic = new unordered_map<string, MMKV *>;
     g_instanceLock = new ThreadLock();
     g_instanceLock->initialize();
 
@@ -203,6 +283,13 @@ void MMKV::initializeMMKV(const MMKVPath_t &rootDir, MMKVLogLevel logLevel, mmkv
     g_logHandler = handler;
 
     ThreadLock::ThreadOnce(&once_control, initialize);
+#ifndef MMKV_APPLE
+    {
+        // the async pool is started again on demand
+        lock_guard<mutex> lock(g_openPoolMutex);
+        g_openPoolStopping = false;
+    }
+#endif
 
 #ifdef MMKV_APPLE
     // crc32 instruction requires A10 chip, aka iPhone 7 or iPad 6th generation
@@ -238,12 +325,22 @@ MMKV *MMKV::mmkvWithID(const string &mmapID, MMKVMode mode, string *cryptKey, MM
     if (mmapID.empty() || !g_instanceLock) {
         return nullptr;
     }
+    auto mmapKey = mmapedKVKey(mmapID, rootPath);
+    if (auto kv = findInstance(mmapKey)) {
+        return kv;
+    }
     SCOPED_LOCK(g_instanceLock);
 
-    auto mmapKey = mmapedKVKey(mmapID, rootPath);
-    auto itr = g_instanceDic->find(mmapKey);
-    if (itr != g_instanceDic->end()) {
-        MMKV *kv = itr->second;
+    auto kv = findInstance(mmapKey);
+#ifndef MMKV_APPLE
+    while (!kv && isOpeningAsync(mmapKey)) {
+        if (!waitForOpeningAsync(mmapKey)) {
+            return nullptr;
+        }
+        kv = findInstance(mmapKey);
+    }
+#endif
+    if (kv) {
         return kv;
     }
 
@@ -255,29 +352,186 @@ MMKV *MMKV::mmkvWithID(const string &mmapID, MMKVMode mode, string *cryptKey, MM
         MMKVInfo("prepare to load %s (id %s) from rootPath %s", mmapID.c_str(), mmapKey.c_str(), rootPath->c_str());
     }
 
-    auto kv = new MMKV(mmapID, mode, cryptKey, rootPath, expectedCapacity);
+    kv = new MMKV(mmapID, mode, cryptKey, rootPath, expectedCapacity);
     kv->m_mmapKey = mmapKey;
-    (*g_instanceDic)[mmapKey] = kv;
+    registerInstance(mmapKey, kv);
+    kv->m_lastAccessTick = ++g_accessTick;
+    if (g_memoryBudgetEnabled) {
+        evictIdleInstances(kv);
+    }
     return kv;
 }
 #endif
 
+#ifndef MMKV_APPLE
+
+// ---- async open ----
+
+// g_instanceLock must be held
+static void finishOpeningAsync(const string &mmapKey) {
+    {
+        lock_guard<mutex> lock(g_openingMutex);
+        g_openingKeys.erase(mmapKey);
+    }
+    g_openingCondition.notify_all();
+}
+
+static void runOnOpenPool(function<void()> task) {
+    lock_guard<mutex> lock(g_openPoolMutex);
+    if (g_openPoolStopping) {
+        return;
+    }
+    g_openTasks.push_back(std::move(task));
+    if (!g_openPool) {
+        auto count = std::min<unsigned>(std::max<unsigned>(thread::hardware_concurrency(), 1), 4);
+        g_openPool = new vector<thread>();
+        for (unsigned i = 0; i < count; i++) {
+            g_openPool->emplace_back([] {
+                unique_lock<mutex> lock(g_openPoolMutex);
+                while (true) {
+                    g_openPoolCondition.wait(lock, [] { return g_openPoolStopping || !g_openTasks.empty(); });
+                    if (g_openPoolStopping) {
+                        return;
+                    }
+                    auto task = std::move(g_openTasks.front());
+                    g_openTasks.pop_front();
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            });
+        }
+    }
+    g_openPoolCondition.notify_one();
+}
+
+// running tasks are waited for, pending ones are dropped, and no more are taken until initializeMMKV() again
+static void stopOpenPool() {
+    vector<thread> *pool = nullptr;
+    {
+        lock_guard<mutex> lock(g_openPoolMutex);
+        g_openPoolStopping = true;
+        g_openTasks.clear();
+        pool = g_openPool;
+        g_openPool = nullptr;
+    }
+    g_openPoolCondition.notify_all();
+    if (pool) {
+        for (auto &worker : *pool) {
+            worker.join();
+        }
+        delete pool;
+    }
+}
+
+// the same as mmkvWithID() followed by a first access, without holding g_instanceLock during the file I/O
+MMKV *MMKV::openInstanceInBackground(const string &mmapID, MMKVMode mode, string *cryptKey, MMKVPath_t *rootPath, size_t expectedCapacity) {
+    if (mmapID.empty() || !g_instanceLock) {
+        return nullptr;
+    }
+    auto mmapKey = mmapedKVKey(mmapID, rootPath);
+    auto kv = findInstance(mmapKey);
+    if (!kv) {
+        SCOPED_LOCK(g_instanceLock);
+        kv = findInstance(mmapKey);
+        while (!kv && isOpeningAsync(mmapKey)) {
+            if (!waitForOpeningAsync(mmapKey)) {
+                return nullptr;
+            }
+            kv = findInstance(mmapKey);
+        }
+        if (!kv) {
+            lock_guard<mutex> lock(g_openingMutex);
+            g_openingKeys.insert(mmapKey);
+        }
+    }
+    if (kv) {
+        SCOPED_LOCK(kv->m_lock);
+        kv->checkLoadData();
+        return kv;
+    }
+
+#    ifndef MMKV_ANDROID
+    if (rootPath) {
+        MMKVPath_t specialPath = (*rootPath) + MMKV_PATH_SLASH + SPECIAL_CHARACTER_DIRECTORY_NAME;
+        if (!isFileExist(specialPath)) {
+            mkPath(specialPath);
+        }
+    }
+    kv = new MMKV(mmapID, mode, cryptKey, rootPath, expectedCapacity);
+    kv->m_mmapKey = mmapKey;
+#    else
+    if (rootPath && !isFileExist(*rootPath) && !mkPath(*rootPath)) {
+        SCOPED_LOCK(g_instanceLock);
+        finishOpeningAsync(mmapKey);
+        return nullptr;
+    }
+    kv = new MMKV(mmapID, DEFAULT_MMAP_SIZE, mode, cryptKey, rootPath, expectedCapacity);
+#    endif
+    {
+        // not published yet, no one else is touching it
+        SCOPED_LOCK(kv->m_lock);
+        kv->checkLoadData();
+    }
+
+    SCOPED_LOCK(g_instanceLock);
+    registerInstance(mmapKey, kv);
+    finishOpeningAsync(mmapKey);
+    kv->m_lastAccessTick = ++g_accessTick;
+    if (g_memoryBudgetEnabled) {
+        evictIdleInstances(kv);
+    }
+    MMKVInfo("opened [%s] in background", mmapID.c_str());
+    return kv;
+}
+
+void MMKV::prewarm(const vector<string> &mmapIDs, MMKVMode mode, MMKVPath_t *rootPath) {
+    for (auto &mmapID : mmapIDs) {
+        mmkvWithIDAsync(mmapID, nullptr, mode, nullptr, rootPath);
+    }
+}
+
+void MMKV::mmkvWithIDAsync(const string &mmapID, OpenCallback callback, MMKVMode mode, string *cryptKey, MMKVPath_t *rootPath, size_t expectedCapacity) {
+    // the pointers may be gone by the time the task runs
+    auto key = cryptKey ? make_shared<string>(*cryptKey) : nullptr;
+    auto path = rootPath ? make_shared<MMKVPath_t>(*rootPath) : nullptr;
+    runOnOpenPool([=] {
+        auto kv = openInstanceInBackground(mmapID, mode, key.get(), path.get(), expectedCapacity);
+        if (callback) {
+            callback(kv);
+        }
+    });
+}
+
+future<MMKV *> MMKV::mmkvWithIDAsync(const string &mmapID, MMKVMode mode, string *cryptKey, MMKVPath_t *rootPath, size_t expectedCapacity) {
+    auto promise = make_shared<std::promise<MMKV *>>();
+    auto result = promise->get_future();
+    mmkvWithIDAsync(mmapID, [promise](MMKV *kv) { promise->set_value(kv); }, mode, cryptKey, rootPath, expectedCapacity);
+    return result;
+}
+
+#endif // !MMKV_APPLE
+
 void MMKV::onExit() {
     if (!g_instanceLock) {
         return;
     }
+#ifndef MMKV_APPLE
+    stopOpenPool();
+    stopExpireReaper();
+#endif
     SCOPED_LOCK(g_instanceLock);
 
-    for (auto &pair : *g_instanceDic) {
-        MMKV *kv = pair.second;
+    auto instances = allInstances();
+    for (auto &shard : g_instanceShards) {
+        lock_guard<mutex> lock(shard.lock);
+        shard.dic.clear();
+    }
+    for (auto kv : instances) {
         kv->sync();
         kv->clearMemoryCache();
         delete kv;
-        pair.second = nullptr;
     }
-
-    delete g_instanceDic;
-    g_instanceDic = nullptr;
 }
 
 const string &MMKV::mmapID() const {
@@ -314,7 +568,13 @@ void MMKV::clearMemoryCache(bool keepSpace) {
     m_needLoadFromFile = true;
     m_hasFullWriteback = false;
 
+    invalidateIndexes();
     clearDictionary(m_dic);
+#ifndef MMKV_APPLE
+    // it points into the mapped file
+    delete m_frozen;
+    m_frozen = nullptr;
+#endif
 #ifndef MMKV_DISABLE_CRYPT
     clearDictionary(m_dicCrypt);
     if (m_crypter) {
@@ -338,22 +598,177 @@ void MMKV::clearMemoryCache(bool keepSpace) {
     m_metaInfo->m_crcDigest = 0;
 }
 
+// ---- registry ----
+
+// without g_instanceLock, a pending close() is canceled by looking the instance up again
+// the one returned is about to be used by the caller, closing it by the last handle would leave the caller a dangling pointer
+MMKV *MMKV::findInstance(const string &mmapKey) {
+    auto &shard = instanceShard(mmapKey);
+    lock_guard<mutex> lock(shard.lock);
+    auto itr = shard.dic.find(mmapKey);
+    if (itr == shard.dic.end()) {
+        return nullptr;
+    }
+    itr->second->m_closePending = false;
+    return itr->second;
+}
+
+// g_instanceLock must be held
+void MMKV::registerInstance(const string &mmapKey, MMKV *kv) {
+    auto &shard = instanceShard(mmapKey);
+    lock_guard<mutex> lock(shard.lock);
+    shard.dic[mmapKey] = kv;
+}
+
+// g_instanceLock must be held, so that none of them is closed before the caller is done
+vector<MMKV *> MMKV::allInstances() {
+    vector<MMKV *> instances;
+    for (auto &shard : g_instanceShards) {
+        lock_guard<mutex> lock(shard.lock);
+        for (auto &pair : shard.dic) {
+            instances.push_back(pair.second);
+        }
+    }
+    return instances;
+}
+
+// without g_instanceLock, the one found is kept alive by the handle, a close() meanwhile is deferred until it's released
+// it's looked up by the path of its data file if path is not null
+MMKVHandle MMKV::retainCachedInstance(const string &mmapKey, const MMKVPath_t *path) {
+    auto retain = [](MMKV *kv) {
+        kv->m_handleCount++;
+        return MMKVHandle(kv, MMKVHandle::Retained);
+    };
+    if (!path) {
+        auto &shard = instanceShard(mmapKey);
+        lock_guard<mutex> lock(shard.lock);
+        auto itr = shard.dic.find(mmapKey);
+        return (itr != shard.dic.end()) ? retain(itr->second) : MMKVHandle();
+    }
+    for (auto &shard : g_instanceShards) {
+        lock_guard<mutex> lock(shard.lock);
+        for (auto &pair : shard.dic) {
+            if (pair.second->m_path == *path) {
+                return retain(pair.second);
+            }
+        }
+    }
+    return {};
+}
+
+const string &MMKV::instanceKey() const {
+#ifndef MMKV_ANDROID
+    return m_mmapKey;
+#else
+    return m_mmapID;
+#endif
+}
+
 void MMKV::close() {
     MMKVInfo("close [%s]", m_mmapID.c_str());
     SCOPED_LOCK(g_instanceLock);
+    {
+        auto &shard = instanceShard(instanceKey());
+        lock_guard<mutex> lock(shard.lock);
+        if (m_handleCount > 0 || m_closingByHandle) {
+            // closed by the last handle, unless it's looked up again before that
+            MMKVInfo("defer closing [%s] with %d handles alive", m_mmapID.c_str(), m_handleCount);
+            m_closePending = true;
+            return;
+        }
+        // in the same critical section as the check, so that no one can retain it after that
+        if (!m_detached) {
+            shard.dic.erase(instanceKey());
+        }
+    }
+    // the writer pool needs m_lock to finish appending
+    stopWriteBehind();
     m_lock->lock();
+    delete this;
+}
+
+// ---- handles ----
 
+MMKVHandle MMKV::mmkvHandleWithID(const string &mmapID, MMKVMode mode, string *cryptKey, MMKVPath_t *rootPath) {
+    if (mmapID.empty() || !g_instanceLock) {
+        return {};
+    }
+    auto mmapKey = mmapedKVKey(mmapID, rootPath);
+    auto &shard = instanceShard(mmapKey);
+    while (true) {
 #ifndef MMKV_ANDROID
-    auto itr = g_instanceDic->find(m_mmapKey);
+        auto kv = mmkvWithID(mmapID, mode, cryptKey, rootPath);
 #else
-    auto itr = g_instanceDic->find(m_mmapID);
+        auto kv = mmkvWithID(mmapID, DEFAULT_MMAP_SIZE, mode, cryptKey, rootPath);
 #endif
-    if (itr != g_instanceDic->end()) {
-        g_instanceDic->erase(itr);
+        if (!kv) {
+            return {};
+        }
+        // only retain the one still registered, it could have been closed since mmkvWithID() returned
+        lock_guard<mutex> lock(shard.lock);
+        auto itr = shard.dic.find(mmapKey);
+        if (itr != shard.dic.end() && itr->second == kv) {
+            kv->m_handleCount++;
+            kv->m_closePending = false;
+            return MMKVHandle(kv, MMKVHandle::Retained);
+        }
+    }
+}
+
+void MMKV::retainHandle() {
+    auto &shard = instanceShard(instanceKey());
+    lock_guard<mutex> lock(shard.lock);
+    m_handleCount++;
+}
+
+void MMKV::releaseHandle() {
+    {
+        auto &shard = instanceShard(instanceKey());
+        lock_guard<mutex> lock(shard.lock);
+        if (--m_handleCount > 0 || !m_closePending || m_closingByHandle) {
+            return;
+        }
+        m_closingByHandle = true;
+    }
+    SCOPED_LOCK(g_instanceLock);
+    {
+        // it could have been retained or looked up again meanwhile
+        auto &shard = instanceShard(instanceKey());
+        lock_guard<mutex> lock(shard.lock);
+        if (m_handleCount > 0 || !m_closePending) {
+            m_closingByHandle = false;
+            return;
+        }
+        if (!m_detached) {
+            shard.dic.erase(instanceKey());
+        }
     }
+    MMKVInfo("close [%s] by its last handle", m_mmapID.c_str());
+    stopWriteBehind();
+    m_lock->lock();
     delete this;
 }
 
+// g_instanceLock must be held, instances with handles alive are unregistered now, and closed by the last handle
+void MMKV::detachOrClose() {
+    int32_t handleCount = 0;
+    {
+        auto &shard = instanceShard(instanceKey());
+        lock_guard<mutex> lock(shard.lock);
+        handleCount = m_handleCount;
+        if (handleCount > 0) {
+            shard.dic.erase(instanceKey());
+            m_detached = true;
+            m_closePending = true;
+        }
+    }
+    if (handleCount > 0) {
+        MMKVInfo("detach [%s] with %d handles alive", m_mmapID.c_str(), handleCount);
+        return;
+    }
+    close();
+}
+
 #ifndef MMKV_DISABLE_CRYPT
 
 string MMKV::cryptKey() const {
@@ -611,6 +1026,38 @@ bool MMKV::set(double value, MMKVKey_t key, uint32_t expireDuration) {
 #ifndef MMKV_APPLE
 
 bool MMKV::setDataForKey(mmkv::MMBuffer &&data, MMKV::MMKVKey_t key, uint32_t expireDuration) {
+    // stored as is instead of as a data holder
+    auto setValueAsIs = [&](MMBuffer &&value) {
+        if (mmkv_likely(!m_enableKeyExpire)) {
+            return setDataForKey(std::move(value), key, false);
+        }
+        auto tmp = MMBuffer(value.length() + Fixed32Size);
+        auto ptr = (uint8_t *) tmp.getPtr();
+        memcpy(ptr, value.getPtr(), value.length());
+        auto time = (expireDuration != ExpireNever) ? getCurrentTimeInSecond() + expireDuration : ExpireNever;
+        memcpy(ptr + value.length(), &time, Fixed32Size);
+        return setDataForKey(std::move(tmp), key);
+    };
+    if (mmkv_unlikely(m_blobThreshold > 0) && data.length() >= m_blobThreshold && !isKeyEmpty(key)) {
+        // no sweeping in between writing the blob & appending its reference
+        SCOPED_LOCK(m_lock);
+        SCOPED_LOCK(m_exclusiveProcessLock);
+        checkLoadData();
+        auto reference = writeBlob(data);
+        if (reference.length() > 0) {
+            if (setValueAsIs(MMBuffer(reference.getPtr(), reference.length()))) {
+                return true;
+            }
+            removeBlob(reference);
+            return false;
+        }
+    }
+    if (mmkv_unlikely(m_compressionThreshold > 0) && data.length() >= m_compressionThreshold) {
+        auto compressed = compressValue(data, m_minCompressionRatio);
+        if (compressed.length() > 0) {
+            return setValueAsIs(std::move(compressed));
+        }
+    }
     if (mmkv_likely(!m_enableKeyExpire)) {
         assert(expireDuration == ExpireNever && "setting expire duration without calling enableAutoKeyExpire() first");
         return setDataForKey(std::move(data), key, true);
@@ -678,11 +1125,19 @@ bool MMKV::set(const vector<string> &v, MMKVKey_t key, uint32_t expireDuration)
         return false;
     }
 #ifdef MMKV_HAS_CPP20
-    auto data = MiniPBCoder::encodeDataWithObject(std::span(v));
+    auto container = std::span(v);
 #else
-    auto data = MiniPBCoder::encodeDataWithObject(v);
+    const auto &container = v;
 #endif
-    if (mmkv_unlikely(m_enableKeyExpire) && data.length() > 0) {
+    if (mmkv_likely(!m_enableKeyExpire)) {
+        return setEncodedDataForKey(
+            [&container](const MiniPBCoder::EncodeReserver &reserve) {
+                return MiniPBCoder::encodeDataWithObject(container, reserve);
+            },
+            key);
+    }
+    auto data = MiniPBCoder::encodeDataWithObject(container);
+    if (data.length() > 0) {
         auto tmp = MMBuffer(data.length() + Fixed32Size);
         auto ptr = (uint8_t *) tmp.getPtr();
         memcpy(ptr, data.getPtr(), data.length());
@@ -693,6 +1148,23 @@ bool MMKV::set(const vector<string> &v, MMKVKey_t key, uint32_t expireDuration)
     return setDataForKey(std::move(data), key);
 }
 
+bool MMKV::decompressString(const MMBuffer &data, string &result, bool inplaceModification, MMKVCompressionStats *stats) {
+    size_t length = 0, headerSize = 0;
+    if (!compressedValueLength(data, length, headerSize)) {
+        return false;
+    }
+    if (inplaceModification) {
+        result.resize(length);
+        return decompressValue(data, result.data(), length, stats);
+    }
+    string value(length, '\0');
+    if (!decompressValue(data, value.data(), length, stats)) {
+        return false;
+    }
+    result = std::move(value);
+    return true;
+}
+
 bool MMKV::getString(MMKVKey_t key, string &result, bool inplaceModification) {
     if (isKeyEmpty(key)) {
         return false;
@@ -700,20 +1172,23 @@ bool MMKV::getString(MMKVKey_t key, string &result, bool inplaceModification) {
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        return decompressString(data, result, inplaceModification, &m_compressionStats);
+    }
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
-            if (inplaceModification) {
-                input.readString(result);
-            } else {
-                result = input.readString();
+        CodedInputData input(data.getPtr(), data.length());
+        if (inplaceModification) {
+            if (input.tryReadString(result)) {
+                return true;
+            }
+        } else {
+            string value;
+            if (input.tryReadString(value)) {
+                result = std::move(value);
+                return true;
             }
-            return true;
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
         }
+        MMKVError("%s", input.lastError());
     }
     return false;
 }
@@ -725,16 +1200,15 @@ bool MMKV::getBytes(MMKVKey_t key, mmkv::MMBuffer &result) {
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        return decompressValue(data, result, &m_compressionStats);
+    }
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
-            result = input.readData();
+        CodedInputData input(data.getPtr(), data.length());
+        if (input.tryReadData(result)) {
             return true;
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
         }
+        MMKVError("%s", input.lastError());
     }
     return false;
 }
@@ -746,15 +1220,18 @@ MMBuffer MMKV::getBytes(MMKVKey_t key) {
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        MMBuffer result;
+        decompressValue(data, result, &m_compressionStats);
+        return result;
+    }
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
-            return input.readData();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+        CodedInputData input(data.getPtr(), data.length());
+        MMBuffer result;
+        if (input.tryReadData(result)) {
+            return result;
         }
+        MMKVError("%s", input.lastError());
     }
     return MMBuffer();
 }
@@ -767,13 +1244,10 @@ bool MMKV::getVector(MMKVKey_t key, vector<string> &result) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            result = MiniPBCoder::decodeVector(data);
+        vector<string> value;
+        if (MiniPBCoder::decodeVector(data, value)) {
+            result.swap(value);
             return true;
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
         }
     }
     return false;
@@ -785,10 +1259,104 @@ void MMKV::shared_lock() {
 }
 
 void MMKV::shared_unlock() {
-    m_sharedProcessLock->lock();
-    m_lock->lock();
+    m_sharedProcessLock->unlock();
+    m_lock->unlock();
+}
+
+template <typename T>
+bool MMKV::getValueForAtomicOp(MMKVKey_t key, T &value) {
+    checkLoadData();
+    auto data = getDataForKey(key);
+    if (!decodeValue(data, value)) {
+        return false;
+    }
+    if constexpr (std::is_same_v<T, MMBuffer>) {
+        // decoded as a view of data
+        value = MMBuffer(value.getPtr(), value.length());
+    }
+    return true;
+}
+
+template <typename T>
+bool MMKV::compareAndSet(MMKVKey_t key, const T &expected, const T &desired, T *observed, bool *hasObserved) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+
+    bool ret = false;
+    T current{};
+    bool hasValue = getValueForAtomicOp(key, current);
+    if (hasValue && current == expected) {
+        ret = set(desired, key);
+    } else if (observed && hasValue) {
+        *observed = std::move(current);
+    }
+    if (hasObserved) {
+        *hasObserved = hasValue;
+    }
+    return ret;
+}
+
+template <typename T>
+bool MMKV::setIfAbsent(MMKVKey_t key, const T &value, T *observed) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    // a key of another type is not absent either
+    if (getDataForKey(key).length() > 0) {
+        T current{};
+        if (observed && getValueForAtomicOp(key, current)) {
+            *observed = std::move(current);
+        }
+        return false;
+    }
+    return set(value, key);
+}
+
+template <typename T>
+bool MMKV::exchange(MMKVKey_t key, const T &value, T *oldValue, bool *hasOldValue) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+
+    T current{};
+    bool hasValue = getValueForAtomicOp(key, current);
+    bool ret = set(value, key);
+    if (oldValue && hasValue) {
+        *oldValue = std::move(current);
+    }
+    if (hasOldValue) {
+        *hasOldValue = hasValue;
+    }
+    return ret;
 }
 
+#define MMKV_INSTANTIATE_ATOMIC_OPS(T)                                                                                 \
+    template bool MMKV::compareAndSet(MMKVKey_t, const T &, const T &, T *, bool *);                                   \
+    template bool MMKV::setIfAbsent(MMKVKey_t, const T &, T *);                                                        \
+    template bool MMKV::exchange(MMKVKey_t, const T &, T *, bool *);
+
+MMKV_INSTANTIATE_ATOMIC_OPS(bool)
+MMKV_INSTANTIATE_ATOMIC_OPS(int32_t)
+MMKV_INSTANTIATE_ATOMIC_OPS(uint32_t)
+MMKV_INSTANTIATE_ATOMIC_OPS(int64_t)
+MMKV_INSTANTIATE_ATOMIC_OPS(uint64_t)
+MMKV_INSTANTIATE_ATOMIC_OPS(float)
+MMKV_INSTANTIATE_ATOMIC_OPS(double)
+MMKV_INSTANTIATE_ATOMIC_OPS(string)
+MMKV_INSTANTIATE_ATOMIC_OPS(MMBuffer)
+MMKV_INSTANTIATE_ATOMIC_OPS(vector<string>)
+
+#undef MMKV_INSTANTIATE_ATOMIC_OPS
+
 #endif // MMKV_APPLE
 
 bool MMKV::getBool(MMKVKey_t key, bool defaultValue, bool *hasValue) {
@@ -802,17 +1370,15 @@ bool MMKV::getBool(MMKVKey_t key, bool defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        bool value;
+        if (input.tryReadBool(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readBool();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -831,17 +1397,15 @@ int32_t MMKV::getInt32(MMKVKey_t key, int32_t defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        int32_t value;
+        if (input.tryReadInt32(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readInt32();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -860,17 +1424,15 @@ uint32_t MMKV::getUInt32(MMKVKey_t key, uint32_t defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        uint32_t value;
+        if (input.tryReadUInt32(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readUInt32();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -889,17 +1451,15 @@ int64_t MMKV::getInt64(MMKVKey_t key, int64_t defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        int64_t value;
+        if (input.tryReadInt64(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readInt64();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -918,17 +1478,15 @@ uint64_t MMKV::getUInt64(MMKVKey_t key, uint64_t defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        uint64_t value;
+        if (input.tryReadUInt64(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readUInt64();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -947,17 +1505,15 @@ float MMKV::getFloat(MMKVKey_t key, float defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        float value;
+        if (input.tryReadFloat(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readFloat();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -976,17 +1532,15 @@ double MMKV::getDouble(MMKVKey_t key, double defaultValue, bool *hasValue) {
     SCOPED_LOCK(m_sharedProcessLock);
     auto data = getDataForKey(key);
     if (data.length() > 0) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
+        CodedInputData input(data.getPtr(), data.length());
+        double value;
+        if (input.tryReadDouble(value)) {
             if (hasValue != nullptr) {
                 *hasValue = true;
             }
-            return input.readDouble();
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
+            return value;
         }
+        MMKVError("%s", input.lastError());
     }
     if (hasValue != nullptr) {
         *hasValue = false;
@@ -1000,21 +1554,36 @@ size_t MMKV::getValueSize(MMKVKey_t key, bool actualSize) {
     }
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_sharedProcessLock);
-    auto data = getDataForKey(key);
+    auto data = getStoredDataForKey(key);
+#ifndef MMKV_APPLE
+    if (mmkv_unlikely(m_hasBlobs) && isBlobReference(data)) {
+        // the blob isn't read, it's stored as a data holder
+        size_t length = 0;
+        uint64_t blobID = 0;
+        uint32_t crcDigest = 0;
+        if (!parseBlobReference(data, length, blobID, crcDigest)) {
+            return 0;
+        }
+        return actualSize ? length : pbRawVarint32Size(static_cast<uint32_t>(length)) + length;
+    }
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        size_t length = 0, headerSize = 0;
+        if (actualSize && compressedValueLength(data, length, headerSize)) {
+            return length;
+        }
+        return data.length();
+    }
+#endif
     if (actualSize) {
-        try {
-            CodedInputData input(data.getPtr(), data.length());
-            auto length = input.readInt32();
-            if (length >= 0) {
-                auto s_length = static_cast<size_t>(length);
-                if (pbRawVarint32Size(length) + s_length == data.length()) {
-                    return s_length;
-                }
+        CodedInputData input(data.getPtr(), data.length());
+        int32_t length;
+        if (!input.tryReadInt32(length)) {
+            MMKVError("%s", input.lastError());
+        } else if (length >= 0) {
+            auto s_length = static_cast<size_t>(length);
+            if (pbRawVarint32Size(length) + s_length == data.length()) {
+                return s_length;
             }
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("decode fail");
         }
     }
     return data.length();
@@ -1028,29 +1597,48 @@ int32_t MMKV::writeValueToBuffer(MMKVKey_t key, void *ptr, int32_t size) {
 
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_sharedProcessLock);
-    auto data = getDataForKey(key);
-    try {
-        CodedInputData input(data.getPtr(), data.length());
-        auto length = input.readInt32();
-        auto offset = pbRawVarint32Size(length);
-        if (length >= 0) {
-            auto s_length = static_cast<size_t>(length);
-            if (offset + s_length == data.length()) {
-                if (s_length <= s_size) {
-                    memcpy(ptr, (uint8_t *) data.getPtr() + offset, s_length);
-                    return length;
-                }
-            } else {
-                if (data.length() <= s_size) {
-                    memcpy(ptr, data.getPtr(), data.length());
-                    return static_cast<int32_t>(data.length());
-                }
+    auto data = getStoredDataForKey(key);
+#ifndef MMKV_APPLE
+    if (mmkv_unlikely(m_hasBlobs) && isBlobReference(data)) {
+        // straight from the blob file into the caller's buffer
+        size_t length = 0;
+        uint64_t blobID = 0;
+        uint32_t crcDigest = 0;
+        if (parseBlobReference(data, length, blobID, crcDigest) && length <= s_size && readBlob(data, ptr, length)) {
+            return static_cast<int32_t>(length);
+        }
+        return -1;
+    }
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        // straight into the caller's buffer
+        size_t length = 0, headerSize = 0;
+        if (compressedValueLength(data, length, headerSize) && length <= s_size &&
+            decompressValue(data, ptr, length, &m_compressionStats)) {
+            return static_cast<int32_t>(length);
+        }
+        return -1;
+    }
+#endif
+    CodedInputData input(data.getPtr(), data.length());
+    int32_t length;
+    if (!input.tryReadInt32(length)) {
+        MMKVError("%s", input.lastError());
+        return -1;
+    }
+    auto offset = pbRawVarint32Size(length);
+    if (length >= 0) {
+        auto s_length = static_cast<size_t>(length);
+        if (offset + s_length == data.length()) {
+            if (s_length <= s_size) {
+                memcpy(ptr, (uint8_t *) data.getPtr() + offset, s_length);
+                return length;
+            }
+        } else {
+            if (data.length() <= s_size) {
+                memcpy(ptr, data.getPtr(), data.length());
+                return static_cast<int32_t>(data.length());
             }
         }
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("encode fail");
     }
     return -1;
 }
@@ -1061,6 +1649,16 @@ bool MMKV::containsKey(MMKVKey_t key) {
     SCOPED_LOCK(m_lock);
     checkLoadData();
 
+    MMBuffer pending;
+    if (mmkv_unlikely(pendingDataForKey(key, pending))) {
+        return pending.length() != 0;
+    }
+#ifndef MMKV_APPLE
+    if (m_frozen) {
+        return m_frozen->find(key).length() != 0;
+    }
+#endif
+
     if (mmkv_likely(!m_enableKeyExpire)) {
         if (m_crypter) {
             return m_dicCrypt->find(key) != m_dicCrypt->end();
@@ -1074,18 +1672,26 @@ bool MMKV::containsKey(MMKVKey_t key) {
 
 size_t MMKV::count(bool filterExpire) {
     SCOPED_LOCK(m_lock);
+    applyPendingWrites();
     checkLoadData();
 
     if (mmkv_unlikely(filterExpire && m_enableKeyExpire)) {
         SCOPED_LOCK(m_exclusiveProcessLock);
         fullWriteback(nullptr, true);
     }
-
+#ifndef MMKV_APPLE
+    // elements of lists are not counted
+    if (m_frozen) {
+        return m_frozen->count() - hiddenKeyCount();
+    }
+    return (m_crypter ? m_dicCrypt->size() : m_dic->size()) - hiddenKeyCount();
+#else
     if (m_crypter) {
         return m_dicCrypt->size();
     } else {
         return m_dic->size();
     }
+#endif
 }
 
 size_t MMKV::totalSize() {
@@ -1100,6 +1706,181 @@ size_t MMKV::actualSize() {
     return m_actualSize;
 }
 
+// a node holds the next pointer, the key-value and the cached hash
+template <typename Map>
+static size_t hashMapHeapSize(const Map &map) {
+    auto nodeSize = sizeof(void *) + sizeof(typename Map::value_type) + sizeof(size_t);
+    return map.size() * nodeSize + map.bucket_count() * sizeof(void *);
+}
+
+// a node holds the color, parent, left & right pointers and the value
+template <typename Set>
+static size_t treeSetHeapSize(const Set &set) {
+    return set.size() * (sizeof(void *) * 4 + sizeof(typename Set::value_type));
+}
+
+#ifndef MMKV_APPLE
+static size_t keyLength(const string &key) {
+    return key.length();
+}
+
+// short strings are stored inside the object
+static size_t keyHeapSize(const string &key) {
+    auto objectPtr = (const char *) &key;
+    if (key.data() >= objectPtr && key.data() < objectPtr + sizeof(key)) {
+        return 0;
+    }
+    return key.capacity() + 1;
+}
+#else
+static size_t keyLength(NSString *key) {
+    return key.length;
+}
+
+static size_t keyHeapSize(NSString *key) {
+    return key.length * sizeof(unichar);
+}
+#endif
+
+MMKVMemoryStats MMKV::memoryStats() {
+    SCOPED_LOCK(m_lock);
+    MMKVMemoryStats stats;
+    stats.evictionCount = m_evictionCount;
+    if (m_needLoadFromFile) {
+        return stats;
+    }
+    stats.mappedBytes = m_file->getFileSize() + m_metaFile->getFileSize();
+    stats.residentBytes = m_file->getResidentSize() + m_metaFile->getResidentSize();
+
+    size_t liveBytes = 0;
+#ifndef MMKV_DISABLE_CRYPT
+    if (m_crypter) {
+        stats.dictionaryBytes = hashMapHeapSize(*m_dicCrypt);
+        for (const auto &itr : *m_dicCrypt) {
+            auto keySize = keyLength(itr.first);
+            stats.keyBytes += keySize;
+            stats.dictionaryBytes += keyHeapSize(itr.first);
+            auto &kvHolder = itr.second;
+            if (kvHolder.type == KeyValueHolderType_Offset) {
+                liveBytes += kvHolder.pbKeyValueSize + kvHolder.keySize + kvHolder.valueSize;
+            } else {
+                if (kvHolder.type == KeyValueHolderType_Memory) {
+                    stats.cryptValueBytes += kvHolder.memSize;
+                }
+                auto valueSize = kvHolder.realValueSize();
+                liveBytes += pbRawVarint32Size((uint32_t) keySize) + keySize + pbRawVarint32Size(valueSize) + valueSize;
+            }
+        }
+    } else
+#endif
+    {
+        stats.dictionaryBytes = hashMapHeapSize(*m_dic);
+        for (const auto &itr : *m_dic) {
+            stats.keyBytes += keyLength(itr.first);
+            stats.dictionaryBytes += keyHeapSize(itr.first);
+            liveBytes += itr.second.computedKVSize + itr.second.valueSize;
+        }
+    }
+    // what a full write back would reclaim, the leading item size holder takes 4 bytes
+    liveBytes += (m_actualSize > 0) ? Fixed32Size : 0;
+    stats.deadBytes = (m_actualSize > liveBytes) ? m_actualSize - liveBytes : 0;
+
+#ifndef MMKV_APPLE
+    if (m_keyIndex) {
+        stats.dictionaryBytes += treeSetHeapSize(*m_keyIndex);
+    }
+    if (m_expireDates) {
+        stats.dictionaryBytes += hashMapHeapSize(*m_expireDates) + treeSetHeapSize(*m_expireQueue);
+    }
+#endif
+    return stats;
+}
+
+MMKVMemoryStats MMKV::globalMemoryStats() {
+    MMKVMemoryStats stats;
+    if (!g_instanceLock) {
+        return stats;
+    }
+    SCOPED_LOCK(g_instanceLock);
+    for (auto kv : allInstances()) {
+        stats += kv->memoryStats();
+    }
+    return stats;
+}
+
+void MMKV::setMemoryBudget(size_t maxLoadedInstances, size_t maxMappedBytes) {
+    if (!g_instanceLock) {
+        return;
+    }
+    MMKVInfo("set memory budget, max loaded instances: %zu, max mapped bytes: %zu", maxLoadedInstances, maxMappedBytes);
+    SCOPED_LOCK(g_instanceLock);
+    g_maxLoadedInstances = maxLoadedInstances;
+    g_maxMappedBytes = maxMappedBytes;
+    g_memoryBudgetEnabled = (maxLoadedInstances != 0 || maxMappedBytes != 0);
+    if (g_memoryBudgetEnabled) {
+        evictIdleInstances(nullptr);
+    }
+}
+
+// instances busy with other threads are never waited for, they are counted as loaded and left alone
+void MMKV::evictIdleInstances(MMKV *current) {
+    struct Candidate {
+        uint64_t lastAccessTick;
+        size_t mappedBytes;
+        MMKV *kv;
+    };
+    vector<Candidate> candidates;
+    size_t loadedCount = 0, mappedBytes = 0;
+    for (auto kv : allInstances()) {
+        if (kv == current) {
+            loadedCount++;
+            mappedBytes += kv->m_file->getFileSize();
+            continue;
+        }
+        if (!kv->m_lock->try_lock()) {
+            loadedCount++;
+            continue;
+        }
+        if (!kv->m_needLoadFromFile) {
+            auto size = kv->m_file->getFileSize();
+            loadedCount++;
+            mappedBytes += size;
+            // not in use by this thread, e.g. opening instances inside a callback of enumerate()
+            if (!kv->m_lock->isHeldRecursively()) {
+                candidates.push_back({kv->m_lastAccessTick, size, kv});
+            }
+        }
+        kv->m_lock->unlock();
+    }
+
+    auto isOverBudget = [&] {
+        return (g_maxLoadedInstances && loadedCount > g_maxLoadedInstances) ||
+               (g_maxMappedBytes && mappedBytes > g_maxMappedBytes);
+    };
+    if (!isOverBudget()) {
+        return;
+    }
+    sort(candidates.begin(), candidates.end(),
+         [](const Candidate &a, const Candidate &b) { return a.lastAccessTick < b.lastAccessTick; });
+    for (auto &candidate : candidates) {
+        if (!isOverBudget()) {
+            break;
+        }
+        auto kv = candidate.kv;
+        if (!kv->m_lock->try_lock()) {
+            continue;
+        }
+        if (!kv->m_needLoadFromFile && !kv->m_lock->isHeldRecursively()) {
+            MMKVInfo("evict [%s] for the memory budget", kv->m_mmapID.c_str());
+            kv->clearMemoryCache();
+            kv->m_evictionCount++;
+            loadedCount--;
+            mappedBytes -= candidate.mappedBytes;
+        }
+        kv->m_lock->unlock();
+    }
+}
+
 bool MMKV::removeValueForKey(MMKVKey_t key) {
     if (isKeyEmpty(key)) {
         return false;
@@ -1119,6 +1900,7 @@ bool MMKV::removeValueForKey(MMKVKey_t key) {
 
 vector<string> MMKV::allKeys(bool filterExpire) {
     SCOPED_LOCK(m_lock);
+    applyPendingWrites();
     checkLoadData();
 
     if (mmkv_unlikely(filterExpire && m_enableKeyExpire)) {
@@ -1127,13 +1909,25 @@ vector<string> MMKV::allKeys(bool filterExpire) {
     }
 
     vector<string> keys;
-    if (m_crypter) {
+    if (m_frozen) {
+        keys.reserve(m_frozen->count());
+        for (size_t index = 0; index < m_frozen->count(); index++) {
+            auto key = m_frozen->keyAt(index);
+            if (!isHiddenKey(key)) {
+                keys.emplace_back(key);
+            }
+        }
+    } else if (m_crypter) {
         for (const auto &itr : *m_dicCrypt) {
-            keys.push_back(itr.first);
+            if (!isHiddenKey(itr.first)) {
+                keys.push_back(itr.first);
+            }
         }
     } else {
         for (const auto &itr : *m_dic) {
-            keys.push_back(itr.first);
+            if (!isHiddenKey(itr.first)) {
+                keys.push_back(itr.first);
+            }
         }
     }
     return keys;
@@ -1152,35 +1946,647 @@ bool MMKV::removeValuesForKeys(const vector<string> &arrKeys) {
     }
 
     SCOPED_LOCK(m_lock);
+    applyPendingWrites();
     SCOPED_LOCK(m_exclusiveProcessLock);
     checkLoadData();
 
+    auto eraseKey = [this](auto &dic, const string &key) {
+        auto itr = dic.find(key);
+        if (itr == dic.end()) {
+            return false;
+        }
+        // the elements go with the list
+        auto itemKeys = listItemKeys(key, itr->second);
+        eraseKeyFromIndexes(key);
+        dic.erase(itr);
+        for (const auto &itemKey : itemKeys) {
+            auto itemItr = dic.find(itemKey);
+            if (itemItr != dic.end()) {
+                eraseKeyFromIndexes(itemKey);
+                dic.erase(itemItr);
+            }
+        }
+        return true;
+    };
     size_t deleteCount = 0;
+    for (const auto &key : arrKeys) {
+        if (m_crypter ? eraseKey(*m_dicCrypt, key) : eraseKey(*m_dic, key)) {
+            deleteCount++;
+        }
+    }
+    if (deleteCount > 0) {
+        m_hasFullWriteback = false;
+
+        return fullWriteback();
+    }
+    return true;
+}
+
+bool MMKV::visitKeyValue(string_view key, const MMBuffer &raw, uint32_t now, const EnumerateCallback &callback, size_t &count) {
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        if (raw.length() < Fixed32Size) {
+            return true;
+        }
+        auto newLength = raw.length() - Fixed32Size;
+        uint32_t time = 0;
+        memcpy(&time, (const uint8_t *) raw.getPtr() + newLength, Fixed32Size);
+        if (time != ExpireNever && time <= now) {
+            return true;
+        }
+        MMBuffer value(raw.getPtr(), newLength, MMBufferNoCopy);
+        if (mmkv_unlikely(m_hasBlobs) && isBlobReference(value)) {
+            value = readBlob(value);
+        }
+        count++;
+        return callback(key, value);
+    }
+    if (mmkv_unlikely(m_hasBlobs) && isBlobReference(raw)) {
+        count++;
+        return callback(key, readBlob(raw));
+    }
+    count++;
+    return callback(key, raw);
+}
+
+size_t MMKV::enumerate(const EnumerateCallback &callback) {
+    return doEnumerate(callback, false);
+}
+
+size_t MMKV::doEnumerate(const EnumerateCallback &callback, bool includeHiddenKeys) {
+    if (!callback) {
+        return 0;
+    }
+    SCOPED_LOCK(m_lock);
+    applyPendingWrites();
+    SCOPED_LOCK(m_sharedProcessLock);
+    checkLoadData();
+
+    size_t count = 0;
+    auto now = m_enableKeyExpire ? getCurrentTimeInSecond() : 0;
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    if (m_frozen) {
+        // in the order of keys
+        for (size_t index = 0; index < m_frozen->count(); index++) {
+            auto key = m_frozen->keyAt(index);
+            if (!includeHiddenKeys && isHiddenKey(key)) {
+                continue;
+            }
+            if (!visitKeyValue(key, m_frozen->valueAt(index), now, callback, count)) {
+                break;
+            }
+        }
+        return count;
+    }
+#ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
-        for (const auto &key : arrKeys) {
-            auto itr = m_dicCrypt->find(key);
-            if (itr != m_dicCrypt->end()) {
-                m_dicCrypt->erase(itr);
-                deleteCount++;
+        for (const auto &itr : *m_dicCrypt) {
+            if (!includeHiddenKeys && isHiddenKey(itr.first)) {
+                continue;
+            }
+            // values stored in the file have to be decrypted first
+            auto raw = itr.second.toMMBuffer(basePtr, m_crypter);
+            if (!visitKeyValue(itr.first, raw, now, callback, count)) {
+                break;
+            }
+        }
+    } else
+#endif
+    {
+        for (const auto &itr : *m_dic) {
+            if (!includeHiddenKeys && isHiddenKey(itr.first)) {
+                continue;
+            }
+            if (!visitKeyValue(itr.first, itr.second.toMMBuffer(basePtr), now, callback, count)) {
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+template <typename T, typename Reader>
+static bool decodeValueWithReader(const MMBuffer &data, T &value, Reader reader) {
+    if (data.length() == 0) {
+        return false;
+    }
+    CodedInputData input(data.getPtr(), data.length());
+    if (reader(input, value)) {
+        return true;
+    }
+    MMKVError("%s", input.lastError());
+    return false;
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, bool &value) {
+    return decodeValueWithReader(data, value, [](CodedInputData &input, bool &result) { return input.tryReadBool(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, int32_t &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, int32_t &result) { return input.tryReadInt32(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, uint32_t &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, uint32_t &result) { return input.tryReadUInt32(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, int64_t &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, int64_t &result) { return input.tryReadInt64(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, uint64_t &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, uint64_t &result) { return input.tryReadUInt64(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, float &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, float &result) { return input.tryReadFloat(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, double &value) {
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, double &result) { return input.tryReadDouble(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, string &value) {
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        return decompressString(data, value, false, nullptr);
+    }
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, string &result) { return input.tryReadString(result); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, MMBuffer &value) {
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        return decompressValue(data, value);
+    }
+    // a view of data, no copying
+    return decodeValueWithReader(data, value,
+                                 [](CodedInputData &input, MMBuffer &result) { return input.tryReadData(result, false); });
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, vector<string> &value) {
+    if (data.length() == 0) {
+        return false;
+    }
+    vector<string> result;
+    if (MiniPBCoder::decodeVector(data, result)) {
+        value.swap(result);
+        return true;
+    }
+    return false;
+}
+
+bool MMKV::decodeValue(const MMBuffer &data, string_view &value) {
+    if (mmkv_unlikely(isCompressedValue(data))) {
+        MMKVWarning("a compressed value can't be viewed, decode it as std::string or mmkv::MMBuffer");
+        return false;
+    }
+    MMBuffer buffer;
+    if (!decodeValue(data, buffer)) {
+        return false;
+    }
+    value = string_view((const char *) buffer.getPtr(), buffer.length());
+    return true;
+}
+
+// ---- key index ----
+
+static bool startsWith(string_view str, string_view prefix) {
+    return str.substr(0, prefix.length()) == prefix;
+}
+
+// elements of all lists, see listPushBack()
+// namespace prefixes are '\0' + varint(id > 0), & namespace ids in the registry never start with '\0'
+static const string ListItemPrefix("\0\0\0", 3);
+
+
+void MMKV::enableKeyIndex() {
+    SCOPED_LOCK(m_lock);
+    if (!m_keyIndex) {
+        m_keyIndex = new std::set<string_view>();
+        m_keyIndexValid = false;
+    }
+}
+
+void MMKV::disableKeyIndex() {
+    SCOPED_LOCK(m_lock);
+    delete m_keyIndex;
+    m_keyIndex = nullptr;
+    m_keyIndexValid = false;
+}
+
+void MMKV::keyIndexInsert(const string &key) {
+    if (m_keyIndex && m_keyIndexValid) {
+        m_keyIndex->emplace(key);
+    }
+    if (m_hiddenKeyCountValid && isHiddenKey(key)) {
+        m_hiddenKeyCount++;
+    }
+}
+
+void MMKV::eraseKeyFromIndexes(string_view key) {
+    if (m_keyIndex && m_keyIndexValid) {
+        m_keyIndex->erase(key);
+    }
+    if (m_hiddenKeyCountValid && isHiddenKey(key)) {
+        m_hiddenKeyCount--;
+    }
+    eraseFromExpireIndex(key);
+}
+
+void MMKV::invalidateIndexes() {
+    // don't keep any view of the keys that are about to be destroyed
+    if (m_keyIndex) {
+        m_keyIndex->clear();
+        m_keyIndexValid = false;
+    }
+    m_hiddenKeyCountValid = false;
+    if (m_expireIndexValid) {
+        m_expireDates->clear();
+        m_expireQueue->clear();
+        m_expireIndexValid = false;
+    }
+}
+
+bool MMKV::isHiddenKey(string_view key) {
+    return startsWith(key, ListItemPrefix);
+}
+
+// counted lazily after the dictionary is (re)loaded, like the key index
+size_t MMKV::hiddenKeyCount() {
+    if (m_frozen) {
+        // keys are sorted, the hidden ones are all in ["\0\0\0", "\0\0\1")
+        static const string HiddenKeyEnd("\0\0\1", 3);
+        return m_frozen->lowerBound(HiddenKeyEnd) - m_frozen->lowerBound(ListItemPrefix);
+    }
+    if (!m_hiddenKeyCountValid) {
+        size_t count = 0;
+        if (m_crypter) {
+            for (const auto &itr : *m_dicCrypt) {
+                count += isHiddenKey(itr.first);
+            }
+        } else {
+            for (const auto &itr : *m_dic) {
+                count += isHiddenKey(itr.first);
+            }
+        }
+        m_hiddenKeyCount = count;
+        m_hiddenKeyCountValid = true;
+    }
+    return m_hiddenKeyCount;
+}
+
+void MMKV::ensureKeyIndex() {
+    if (!m_keyIndex || m_keyIndexValid) {
+        return;
+    }
+    vector<string_view> keys;
+    if (m_crypter) {
+        keys.reserve(m_dicCrypt->size());
+        for (const auto &itr : *m_dicCrypt) {
+            keys.emplace_back(itr.first);
+        }
+    } else {
+        keys.reserve(m_dic->size());
+        for (const auto &itr : *m_dic) {
+            keys.emplace_back(itr.first);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    m_keyIndex->clear();
+    for (auto key : keys) {
+        m_keyIndex->emplace_hint(m_keyIndex->end(), key);
+    }
+    m_keyIndexValid = true;
+    MMKVInfo("build key index of [%s] with %zu keys", m_mmapID.c_str(), keys.size());
+}
+
+vector<string_view> MMKV::keysInRange(string_view lowerKey, const function<bool(string_view)> &isInRange) {
+    vector<string_view> keys;
+    if (m_frozen) {
+        // already sorted
+        for (auto index = m_frozen->lowerBound(lowerKey); index < m_frozen->count(); index++) {
+            auto key = m_frozen->keyAt(index);
+            if (!isInRange(key)) {
+                break;
+            }
+            if (!isHiddenKey(key)) {
+                keys.push_back(key);
+            }
+        }
+        return keys;
+    }
+    if (m_keyIndex) {
+        ensureKeyIndex();
+        for (auto itr = m_keyIndex->lower_bound(lowerKey); itr != m_keyIndex->end() && isInRange(*itr); itr++) {
+            if (!isHiddenKey(*itr)) {
+                keys.push_back(*itr);
             }
         }
+        return keys;
+    }
+    // no index, walk through all keys
+    auto filter = [&](string_view key) {
+        if (key >= lowerKey && isInRange(key) && !isHiddenKey(key)) {
+            keys.push_back(key);
+        }
+    };
+    if (m_crypter) {
+        for (const auto &itr : *m_dicCrypt) {
+            filter(itr.first);
+        }
     } else {
-        for (const auto &key : arrKeys) {
+        for (const auto &itr : *m_dic) {
+            filter(itr.first);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    return keys;
+}
+
+size_t MMKV::enumerateKeys(const vector<string_view> &keys, const EnumerateCallback &callback) {
+    size_t count = 0;
+    auto now = m_enableKeyExpire ? getCurrentTimeInSecond() : 0;
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    for (auto key : keys) {
+        MMBuffer raw;
+        if (m_frozen) {
+            raw = m_frozen->find(key);
+        } else
+#ifndef MMKV_DISABLE_CRYPT
+        if (m_crypter) {
+            auto itr = m_dicCrypt->find(key);
+            if (itr != m_dicCrypt->end()) {
+                raw = itr->second.toMMBuffer(basePtr, m_crypter);
+            }
+        } else
+#endif
+        {
             auto itr = m_dic->find(key);
             if (itr != m_dic->end()) {
-                m_dic->erase(itr);
-                deleteCount++;
+                raw = itr->second.toMMBuffer(basePtr);
             }
         }
+        if (!visitKeyValue(key, raw, now, callback, count)) {
+            break;
+        }
     }
-    if (deleteCount > 0) {
-        m_hasFullWriteback = false;
+    return count;
+}
 
-        return fullWriteback();
+size_t MMKV::scanPrefix(string_view prefix, const EnumerateCallback &callback) {
+    if (!callback) {
+        return 0;
+    }
+    SCOPED_LOCK(m_lock);
+    applyPendingWrites();
+    SCOPED_LOCK(m_sharedProcessLock);
+    checkLoadData();
+
+    auto keys = keysInRange(prefix, [prefix](string_view key) { return startsWith(key, prefix); });
+    return enumerateKeys(keys, callback);
+}
+
+size_t MMKV::scanRange(string_view lowerKey, string_view upperKey, const EnumerateCallback &callback) {
+    if (!callback || lowerKey >= upperKey) {
+        return 0;
+    }
+    SCOPED_LOCK(m_lock);
+    applyPendingWrites();
+    SCOPED_LOCK(m_sharedProcessLock);
+    checkLoadData();
+
+    auto keys = keysInRange(lowerKey, [upperKey](string_view key) { return key < upperKey; });
+    return enumerateKeys(keys, callback);
+}
+
+size_t MMKV::removeValuesWithPrefix(string_view prefix) {
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return 0;
+    }
+    SCOPED_LOCK(m_lock);
+    applyPendingWrites();
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    // the views won't survive the removing
+    vector<string> keys;
+    for (auto key : keysInRange(prefix, [prefix](string_view key) { return startsWith(key, prefix); })) {
+        keys.emplace_back(key);
+    }
+    size_t count = 0;
+    for (const auto &key : keys) {
+        // the elements go with a list
+        if (removeDataForKey(key)) {
+            count++;
+        }
+    }
+    MMKVInfo("removed %zu keys with prefix [%.*s] from [%s]", count, (int) prefix.length(), prefix.data(), m_mmapID.c_str());
+    return count;
+}
+
+// ---- list ----
+
+// the list key holds a tagged header of the [head, tail) range of element indexes
+constexpr uint32_t ListMagic = 0x4C564B4D; // "MKVL"
+constexpr size_t ListHeaderSize = sizeof(uint32_t) + sizeof(uint64_t) * 2;
+
+static string listItemKey(string_view key, uint64_t index) {
+    string itemKey = ListItemPrefix + to_string(index);
+    itemKey.push_back('\0');
+    itemKey += key;
+    return itemKey;
+}
+
+// return false if data isn't a list header
+static bool decodeListHeader(const MMBuffer &data, uint64_t &head, uint64_t &tail) {
+    // the header encoded as bytes, checked before decoding
+    if (data.length() != pbRawVarint32Size((uint32_t) ListHeaderSize) + ListHeaderSize) {
+        return false;
+    }
+    CodedInputData input(data.getPtr(), data.length());
+    MMBuffer header;
+    if (!input.tryReadData(header, false) || header.length() != ListHeaderSize) {
+        return false;
+    }
+    auto ptr = (const uint8_t *) header.getPtr();
+    uint32_t magic = 0;
+    memcpy(&magic, ptr, sizeof(magic));
+    if (magic != ListMagic) {
+        return false;
+    }
+    memcpy(&head, ptr + sizeof(magic), sizeof(uint64_t));
+    memcpy(&tail, ptr + sizeof(magic) + sizeof(uint64_t), sizeof(uint64_t));
+    return head <= tail;
+}
+
+// return false if key doesn't hold a list
+bool MMKV::getListRange(string_view key, uint64_t &head, uint64_t &tail) {
+    head = tail = 0;
+    if (!decodeListHeader(getStoredDataForKey(key), head, tail)) {
+        head = tail = 0;
+        return false;
+    }
+    return true;
+}
+
+bool MMKV::setListRange(string_view key, uint64_t head, uint64_t tail) {
+    uint8_t header[ListHeaderSize];
+    memcpy(header, &ListMagic, sizeof(ListMagic));
+    memcpy(header + sizeof(ListMagic), &head, sizeof(head));
+    memcpy(header + sizeof(ListMagic) + sizeof(head), &tail, sizeof(tail));
+    return set(MMBuffer(header, sizeof(header), MMBufferNoCopy), key);
+}
+
+// the stored size of a list header, only values of this size are decoded by listItemKeys()
+size_t MMKV::listHeaderValueSize() const {
+    return pbRawVarint32Size((uint32_t) ListHeaderSize) + ListHeaderSize + (m_enableKeyExpire ? Fixed32Size : 0);
+}
+
+static vector<string> decodeListItemKeys(string_view key, const MMBuffer &raw, bool hasExpireDate) {
+    vector<string> keys;
+    auto data = MMBuffer(raw.getPtr(), raw.length() - (hasExpireDate ? Fixed32Size : 0), MMBufferNoCopy);
+    uint64_t head = 0, tail = 0;
+    if (decodeListHeader(data, head, tail)) {
+        keys.reserve(static_cast<size_t>(tail - head));
+        for (auto index = head; index < tail; index++) {
+            keys.push_back(listItemKey(key, index));
+        }
+    }
+    return keys;
+}
+
+// keys of the elements if kvHolder holds a list header, expired or not
+vector<string> MMKV::listItemKeys(string_view key, const KeyValueHolder &kvHolder) {
+    if (mmkv_likely(kvHolder.valueSize != listHeaderValueSize()) || isHiddenKey(key)) {
+        return {};
+    }
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    return decodeListItemKeys(key, kvHolder.toMMBuffer(basePtr), m_enableKeyExpire);
+}
+
+#ifndef MMKV_DISABLE_CRYPT
+vector<string> MMKV::listItemKeys(string_view key, const KeyValueHolderCrypt &kvHolder) {
+    if (mmkv_likely(kvHolder.realValueSize() != listHeaderValueSize()) || isHiddenKey(key)) {
+        return {};
+    }
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    return decodeListItemKeys(key, kvHolder.toMMBuffer(basePtr, m_crypter), m_enableKeyExpire);
+}
+#endif
+
+bool MMKV::listPushBack(string_view key, string_view item) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    uint64_t head = 0, tail = 0;
+    if (!getListRange(key, head, tail)) {
+        if (containsKey(key)) {
+            MMKVError("[%.*s] of [%s] is not a list", (int) key.length(), key.data(), m_mmapID.c_str());
+            return false;
+        }
+        // an expired list not filtered yet, its elements go with it
+        removeDataForKey(key);
+    }
+    // the element goes first, an orphan one is just overwritten next time
+    // elements never expire by themselves, they go with the list, whose expire date is refreshed on each change
+    if (!set(item, listItemKey(key, tail), ExpireNever)) {
+        return false;
+    }
+    return setListRange(key, head, tail + 1);
+}
+
+bool MMKV::listPopFront(string_view key, string *item) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    uint64_t head = 0, tail = 0;
+    if (!getListRange(key, head, tail) || head >= tail) {
+        return false;
+    }
+    auto itemKey = listItemKey(key, head);
+    string value;
+    if (!getString(itemKey, item ? *item : value)) {
+        MMKVError("element %llu of list [%.*s] of [%s] is missing", (unsigned long long) head, (int) key.length(),
+                  key.data(), m_mmapID.c_str());
+        return false;
+    }
+    removeDataForKey(itemKey);
+    if (head + 1 == tail) {
+        return removeDataForKey(key);
+    }
+    return setListRange(key, head + 1, tail);
+}
+
+size_t MMKV::listSize(string_view key) {
+    if (isKeyEmpty(key)) {
+        return 0;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_sharedProcessLock);
+    checkLoadData();
+
+    uint64_t head = 0, tail = 0;
+    getListRange(key, head, tail);
+    return static_cast<size_t>(tail - head);
+}
+
+bool MMKV::listRange(string_view key, size_t start, size_t count, vector<string> &result) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_sharedProcessLock);
+    checkLoadData();
+
+    uint64_t head = 0, tail = 0;
+    if (!getListRange(key, head, tail)) {
+        return false;
+    }
+    result.clear();
+    auto begin = min(head + start, tail);
+    auto end = (count < tail - begin) ? begin + count : tail;
+    for (auto index = begin; index < end; index++) {
+        string item;
+        if (!getString(listItemKey(key, index), item)) {
+            MMKVError("element %llu of list [%.*s] of [%s] is missing", (unsigned long long) index, (int) key.length(),
+                      key.data(), m_mmapID.c_str());
+            result.clear();
+            return false;
+        }
+        result.push_back(std::move(item));
     }
     return true;
 }
 
+bool MMKV::removeList(string_view key) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    uint64_t head = 0, tail = 0;
+    if (!getListRange(key, head, tail)) {
+        return false;
+    }
+    return removeValueForKey(key);
+}
+
 #endif // MMKV_APPLE
 
 // file
@@ -1188,6 +2594,7 @@ bool MMKV::removeValuesForKeys(const vector<string> &arrKeys) {
 void MMKV::sync(SyncFlag flag) {
     MMKVInfo("MMKV::sync, SyncFlag = %d", flag);
     SCOPED_LOCK(m_lock);
+    applyPendingWrites();
     if (m_needLoadFromFile || !isFileValid()) {
         return;
     }
@@ -1224,6 +2631,34 @@ bool MMKV::try_lock_thread() {
 
 // backup
 
+// make the blob directory of dstKVPath a copy of srcKVPath's
+static bool copyBlobDirectory(const MMKVPath_t &srcKVPath, const MMKVPath_t &dstKVPath) {
+    auto srcDir = blobDirWithKVPath(srcKVPath);
+    auto dstDir = blobDirWithKVPath(dstKVPath);
+    unordered_set<MMKVPath_t> names;
+    bool ret = true;
+    if (isFileExist(srcDir)) {
+        mkPath(dstDir);
+        walkInDir(srcDir, WalkFile, [&](const MMKVPath_t &filePath, WalkType) {
+            auto name = filename(filePath);
+            auto dstPath = dstDir + MMKV_PATH_SLASH + name;
+            // blobs are never modified & named by random ids, one of the same name is a copy already
+            if (!isFileExist(dstPath) && !copyFile(filePath, dstPath)) {
+                ret = false;
+            }
+            names.insert(std::move(name));
+        });
+    }
+    if (isFileExist(dstDir)) {
+        walkInDir(dstDir, WalkFile, [&](const MMKVPath_t &filePath, WalkType) {
+            if (names.find(filename(filePath)) == names.end()) {
+                removeFile(filePath);
+            }
+        });
+    }
+    return ret;
+}
+
 static bool backupOneToDirectoryByFilePath(const string &mmapKey, const MMKVPath_t &srcPath, const MMKVPath_t &dstPath) {
     File crcFile(srcPath, OpenFlag::ReadOnly);
     if (!crcFile.isFileValid()) {
@@ -1247,6 +2682,9 @@ static bool backupOneToDirectoryByFilePath(const string &mmapKey, const MMKVPath
             auto dstCRCPath = dstPath + CRC_SUFFIX;
             ret = copyFile(srcCRCPath, dstCRCPath);
         }
+        if (ret) {
+            ret = copyBlobDirectory(srcPath, dstPath);
+        }
         MMKVInfo("finish backup one mmkv[%s]", mmapKey.c_str());
     }
     return ret;
@@ -1256,45 +2694,37 @@ bool MMKV::backupOneToDirectory(const string &mmapKey, const MMKVPath_t &dstPath
     if (!g_instanceLock) {
         return false;
     }
-    // we have to lock the creation of MMKV instance, regardless of in cache or not
-    SCOPED_LOCK(g_instanceLock);
-    MMKV *kv = nullptr;
-    if (!compareFullPath) {
-        auto itr = g_instanceDic->find(mmapKey);
-        if (itr != g_instanceDic->end()) {
-            kv = itr->second;
-        }
-    } else {
-        // mmapKey is actually filename, we can't simply call find()
-        for (auto &pair : *g_instanceDic) {
-            if (pair.second->m_path == srcPath) {
-                kv = pair.second;
-                break;
-            }
+    // mmapKey is actually filename if compareFullPath, we can't simply look it up
+    auto cachePath = compareFullPath ? &srcPath : nullptr;
+    auto kv = retainCachedInstance(mmapKey, cachePath);
+    if (!kv) {
+        // we have to lock the creation of MMKV instance when it's not in cache
+        SCOPED_LOCK(g_instanceLock);
+        kv = retainCachedInstance(mmapKey, cachePath);
+        if (!kv) {
+            // no luck with cache, do it the hard way
+            return backupOneToDirectoryByFilePath(mmapKey, srcPath, dstPath);
         }
     }
-    // get one in cache, do it the easy way
-    if (kv) {
+    // get one in cache, do it the easy way, lookups & creation of other instances are not blocked meanwhile
 #ifdef MMKV_WIN32
-        MMKVInfo("backup one cached mmkv[%s] from [%ls] to [%ls]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
+    MMKVInfo("backup one cached mmkv[%s] from [%ls] to [%ls]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
 #else
-        MMKVInfo("backup one cached mmkv[%s] from [%s] to [%s]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
+    MMKVInfo("backup one cached mmkv[%s] from [%s] to [%s]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
 #endif
-        SCOPED_LOCK(kv->m_lock);
-        SCOPED_LOCK(kv->m_sharedProcessLock);
+    SCOPED_LOCK(kv->m_lock);
+    SCOPED_LOCK(kv->m_sharedProcessLock);
 
-        kv->sync();
-        auto ret = copyFile(kv->m_path, dstPath);
-        if (ret) {
-            auto dstCRCPath = dstPath + CRC_SUFFIX;
-            ret = copyFile(kv->m_crcPath, dstCRCPath);
-        }
-        MMKVInfo("finish backup one mmkv[%s], ret: %d", mmapKey.c_str(), ret);
-        return ret;
+    kv->sync();
+    auto ret = copyFile(kv->m_path, dstPath);
+    if (ret) {
+        auto dstCRCPath = dstPath + CRC_SUFFIX;
+        ret = copyFile(kv->m_crcPath, dstCRCPath);
     }
-
-    // no luck with cache, do it the hard way
-    bool ret = backupOneToDirectoryByFilePath(mmapKey, srcPath, dstPath);
+    if (ret) {
+        ret = copyBlobDirectory(kv->m_path, dstPath);
+    }
+    MMKVInfo("finish backup one mmkv[%s], ret: %d", mmapKey.c_str(), ret);
     return ret;
 }
 
@@ -1337,7 +2767,8 @@ size_t MMKV::backupAllToDirectory(const MMKVPath_t &dstDir, const MMKVPath_t &sr
     walkInDir(srcDir, WalkFile, [&](const MMKVPath_t &filePath, WalkType) {
         if (endsWith(filePath, CRC_SUFFIX)) {
             mmapIDCRCSet.insert(filePath);
-        } else {
+        } else if (!endsWith(filePath, SNAPSHOT_SUFFIX)) {
+            // the snapshot is just a loading cache, it will be rebuilt on next full write back
             mmapIDSet.insert(filePath);
         }
     });
@@ -1409,6 +2840,9 @@ static bool restoreOneFromDirectoryByFilePath(const string &mmapKey, const MMKVP
             auto srcCRCPath = srcPath + CRC_SUFFIX;
             ret = copyFileContent(srcCRCPath, dstCRCFile.getFd());
         }
+        if (ret) {
+            ret = copyBlobDirectory(srcPath, dstPath);
+        }
         MMKVInfo("finish restore one mmkv[%s]", mmapKey.c_str());
     }
     return ret;
@@ -1421,63 +2855,55 @@ bool MMKV::restoreOneFromDirectory(const string &mmapKey, const MMKVPath_t &srcP
     if (!g_instanceLock) {
         return false;
     }
-    // we have to lock the creation of MMKV instance, regardless of in cache or not
-    SCOPED_LOCK(g_instanceLock);
-    MMKV *kv = nullptr;
-    if (!compareFullPath) {
-        auto itr = g_instanceDic->find(mmapKey);
-        if (itr != g_instanceDic->end()) {
-            kv = itr->second;
-        }
-    } else {
-        // mmapKey is actually filename, we can't simply call find()
-        for (auto &pair : *g_instanceDic) {
-            if (pair.second->m_path == dstPath) {
-                kv = pair.second;
-                break;
-            }
+    // mmapKey is actually filename if compareFullPath, we can't simply look it up
+    auto cachePath = compareFullPath ? &dstPath : nullptr;
+    auto kv = retainCachedInstance(mmapKey, cachePath);
+    if (!kv) {
+        // we have to lock the creation of MMKV instance when it's not in cache
+        SCOPED_LOCK(g_instanceLock);
+        kv = retainCachedInstance(mmapKey, cachePath);
+        if (!kv) {
+            // no luck with cache, do it the hard way
+            return restoreOneFromDirectoryByFilePath(mmapKey, srcPath, dstPath);
         }
     }
-    // get one in cache, do it the easy way
-    if (kv) {
+    // get one in cache, do it the easy way, lookups & creation of other instances are not blocked meanwhile
 #ifdef MMKV_WIN32
-        MMKVInfo("restore one cached mmkv[%s] from [%ls] to [%ls]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
+    MMKVInfo("restore one cached mmkv[%s] from [%ls] to [%ls]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
 #else
-        MMKVInfo("restore one cached mmkv[%s] from [%s] to [%s]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
+    MMKVInfo("restore one cached mmkv[%s] from [%s] to [%s]", mmapKey.c_str(), srcPath.c_str(), dstPath.c_str());
 #endif
-        SCOPED_LOCK(kv->m_lock);
-        SCOPED_LOCK(kv->m_exclusiveProcessLock);
-
-        kv->sync();
-        auto ret = copyFileContent(srcPath, kv->m_file->getFd());
-        if (ret) {
-            auto srcCRCPath = srcPath + CRC_SUFFIX;
-            // ret = copyFileContent(srcCRCPath, kv->m_metaFile->getFd());
+    SCOPED_LOCK(kv->m_lock);
+    SCOPED_LOCK(kv->m_exclusiveProcessLock);
+
+    kv->sync();
+    auto ret = copyFileContent(srcPath, kv->m_file->getFd());
+    if (ret) {
+        auto srcCRCPath = srcPath + CRC_SUFFIX;
+        // ret = copyFileContent(srcCRCPath, kv->m_metaFile->getFd());
 #ifndef MMKV_ANDROID
-            MemoryFile srcCRCFile(srcCRCPath);
+        MemoryFile srcCRCFile(srcCRCPath);
 #else
-            MemoryFile srcCRCFile(srcCRCPath, DEFAULT_MMAP_SIZE, MMFILE_TYPE_FILE);
+        MemoryFile srcCRCFile(srcCRCPath, DEFAULT_MMAP_SIZE, MMFILE_TYPE_FILE);
 #endif
-            if (srcCRCFile.isFileValid()) {
-                memcpy(kv->m_metaFile->getMemory(), srcCRCFile.getMemory(), sizeof(MMKVMetaInfo));
-            } else {
-                ret = false;
-            }
-        }
-
-        // reload data after restore
-        kv->clearMemoryCache();
-        kv->loadFromFile();
-        if (kv->isMultiProcess()) {
-            kv->notifyContentChanged();
+        if (srcCRCFile.isFileValid()) {
+            memcpy(kv->m_metaFile->getMemory(), srcCRCFile.getMemory(), sizeof(MMKVMetaInfo));
+        } else {
+            ret = false;
         }
+    }
+    if (ret) {
+        ret = copyBlobDirectory(srcPath, kv->m_path);
+    }
 
-        MMKVInfo("finish restore one mmkv[%s], ret: %d", mmapKey.c_str(), ret);
-        return ret;
+    // reload data after restore
+    kv->clearMemoryCache();
+    kv->loadFromFile();
+    if (kv->isMultiProcess()) {
+        kv->notifyContentChanged();
     }
 
-    // no luck with cache, do it the hard way
-    bool ret = restoreOneFromDirectoryByFilePath(mmapKey, srcPath, dstPath);
+    MMKVInfo("finish restore one mmkv[%s], ret: %d", mmapKey.c_str(), ret);
     return ret;
 }
 
@@ -1505,7 +2931,8 @@ size_t MMKV::restoreAllFromDirectory(const MMKVPath_t &srcDir, const MMKVPath_t
     walkInDir(srcDir, WalkFile, [&](const MMKVPath_t &filePath, WalkType) {
         if (endsWith(filePath, CRC_SUFFIX)) {
             mmapIDCRCSet.insert(filePath);
-        } else {
+        } else if (!endsWith(filePath, SNAPSHOT_SUFFIX)) {
+            // the snapshot is just a loading cache, it will be rebuilt on next full write back
             mmapIDSet.insert(filePath);
         }
     });
@@ -1685,6 +3112,14 @@ MMKVPath_t crcPathWithID(const string &mmapID, MMKVMode mode, const MMKVPath_t *
     return g_rootDir + MMKV_PATH_SLASH + encodeFilePath(mmapID) + CRC_SUFFIX;
 }
 
+MMKVPath_t snapshotPathWithKVPath(const MMKVPath_t &kvPath) {
+    return kvPath + SNAPSHOT_SUFFIX;
+}
+
+MMKVPath_t blobDirWithKVPath(const MMKVPath_t &kvPath) {
+    return kvPath + BLOB_SUFFIX;
+}
+
 MMKVRecoverStrategic onMMKVCRCCheckFail(const string &mmapID) {
     if (g_errorHandler) {
         return g_errorHandler(mmapID, MMKVErrorType::MMKVCRCCheckFail);
@@ -37,6 +37,15 @@
 #include <cstdint>
 #include <type_traits>
 #include <cstring>
+#include <functional>
+#include <set>
+#ifndef MMKV_APPLE
+#  include <atomic>
+#  include <future>
+#  include <memory>
+#  include <unordered_set>
+#endif
+#include <unordered_map>
 
 namespace mmkv {
 class CodedOutputData;
@@ -46,10 +55,18 @@ struct MMKVMetaInfo;
 class FileLock;
 class InterProcessLock;
 class ThreadLock;
+#ifndef MMKV_APPLE
+class FrozenIndex;
+#endif
 } // namespace mmkv
 
 MMKV_NAMESPACE_BEGIN
 
+class MMKVHandle;
+#ifndef MMKV_APPLE
+class MMKVNamespace;
+#endif
+
 enum MMKVMode : uint32_t {
     MMKV_SINGLE_PROCESS = 1 << 0,
     MMKV_MULTI_PROCESS = 1 << 1,
@@ -59,12 +76,62 @@ enum MMKVMode : uint32_t {
     MMKV_BACKUP = 1 << 4,
 #endif
     MMKV_READ_ONLY = 1 << 5,
+#ifndef MMKV_APPLE
+    // an immutable file written by MMKV::exportFrozen(), mapped read-only without loading
+    MMKV_FROZEN = 1 << 6,
+#endif
 };
 
 static inline MMKVMode operator | (MMKVMode one, MMKVMode other) {
     return static_cast<MMKVMode>(static_cast<uint32_t>(one) | static_cast<uint32_t>(other));
 }
 
+// heap & mapped memory held by MMKV instances, see MMKV::memoryStats()
+struct MMKVMemoryStats {
+    // nodes & buckets of the dictionary and the key indexes, including keys stored on the heap
+    size_t dictionaryBytes = 0;
+    // length of all keys (characters on Apple)
+    size_t keyBytes = 0;
+    // values of encrypted instances cached on the heap
+    size_t cryptValueBytes = 0;
+    // mmapped size of the data file & the meta file
+    size_t mappedBytes = 0;
+    // the part of mappedBytes currently resident in memory
+    size_t residentBytes = 0;
+    // log space of overwritten or deleted key-values, reclaimed by trim() or the next full write back
+    size_t deadBytes = 0;
+    // times of being evicted by the memory budget, see MMKV::setMemoryBudget()
+    size_t evictionCount = 0;
+
+    MMKVMemoryStats &operator+=(const MMKVMemoryStats &other) {
+        dictionaryBytes += other.dictionaryBytes;
+        keyBytes += other.keyBytes;
+        cryptValueBytes += other.cryptValueBytes;
+        mappedBytes += other.mappedBytes;
+        residentBytes += other.residentBytes;
+        deadBytes += other.deadBytes;
+        evictionCount += other.evictionCount;
+        return *this;
+    }
+};
+
+// strings & bytes stored compressed by an instance since it's opened, see MMKV::enableCompression()
+struct MMKVCompressionStats {
+    // values written compressed, and the ones over the threshold stored as is because they don't reach the min ratio
+    size_t compressedCount = 0;
+    size_t skippedCount = 0;
+    // logical & stored length of the values written compressed
+    size_t rawBytes = 0;
+    size_t compressedBytes = 0;
+    // values decompressed by reading
+    size_t decompressedCount = 0;
+    // time spent, in nanoseconds
+    uint64_t compressTime = 0;
+    uint64_t decompressTime = 0;
+
+    double compressionRatio() const { return compressedBytes ? static_cast<double>(rawBytes) / compressedBytes : 0; }
+};
+
 #define MMKV_OUT
 
 #ifdef MMKV_HAS_CPP20
@@ -88,6 +155,10 @@ template <class T>
 concept MMKV_SUPPORTED_VECTOR_VALUE_TYPE = mmkv_is_vector_v<T> &&
     (MMKV_SUPPORTED_PRIMITIVE_VALUE_TYPE<typename T::value_type> || MMKV_SUPPORTED_POD_VALUE_TYPE<typename T::value_type>);
 
+template <class T>
+concept MMKV_FIXED_WIDTH_VALUE_TYPE = std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+    std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t>;
+
 template <class T>
 concept MMKV_SUPPORTED_VALUE_TYPE = MMKV_SUPPORTED_PRIMITIVE_VALUE_TYPE<T> || MMKV_SUPPORTED_POD_VALUE_TYPE<T> ||
     MMKV_SUPPORTED_VECTOR_VALUE_TYPE<T>;
@@ -141,6 +212,65 @@ class MMKV {
 
     bool m_enableCompareBeforeSet = false;
 
+    // LRU bookkeeping of the memory budget, see setMemoryBudget()
+    uint64_t m_lastAccessTick = 0;
+    size_t m_evictionCount = 0;
+
+    // guarded by the registry shard of the instance, see MMKVHandle
+    int32_t m_handleCount = 0;
+    // close() called with handles alive
+    bool m_closePending = false;
+    bool m_closingByHandle = false;
+    // removed from the registry by removeStorage() with handles alive
+    bool m_detached = false;
+
+#ifndef MMKV_APPLE
+    // ordered views of the keys in m_dic / m_dicCrypt, see enableKeyIndex()
+    std::set<std::string_view> *m_keyIndex = nullptr;
+    // rebuilt lazily after the dictionary is (re)loaded
+    bool m_keyIndexValid = false;
+    // the number of list elements in the dictionary, recounted lazily like the key index
+    size_t m_hiddenKeyCount = 0;
+    bool m_hiddenKeyCountValid = false;
+
+    // expire date of every key that will expire, see filterExpiredKeys()
+    std::unordered_map<std::string_view, uint32_t> *m_expireDates = nullptr;
+    // (expire date, key), soonest first
+    std::set<std::pair<uint32_t, std::string_view>> *m_expireQueue = nullptr;
+    bool m_expireIndexValid = false;
+
+    // logical maps hosted by this instance, see namespaceWithID()
+    std::unordered_map<std::string, MMKVNamespace *> *m_namespaces = nullptr;
+
+    // key-values queued by setAsync(), created on first use
+    struct WriteBehindQueue;
+    std::atomic<WriteBehindQueue *> m_writeBehind{nullptr};
+    // tasks on the writer pool hold it as well, they can outlive the instance
+    std::shared_ptr<WriteBehindQueue> m_writeBehindOwner;
+    // the queued key-values are being appended, they must not drop newer queued ones
+    bool m_applyingPendingWrites = false;
+
+    // strings & bytes at least this long are compressed, 0 means off, see enableCompression()
+    size_t m_compressionThreshold = 0;
+    // raw length / compressed length a value must reach to be stored compressed
+    double m_minCompressionRatio = DefaultMinCompressionRatio;
+    // guarded by m_lock
+    MMKVCompressionStats m_compressionStats;
+
+    // strings & bytes at least this long are stored in blob files, 0 means off, see enableBlobStorage()
+    size_t m_blobThreshold = 0;
+    // the blob directory exists, checked on each load, no blob reference needs resolving otherwise
+    bool m_hasBlobs = false;
+    // length of the blobs of overwritten or removed values since the last sweep, see supersedeBlob()
+    size_t m_supersededBlobBytes = 0;
+
+    // write a reference to the previous record of a key instead of the key, see enableKeyReference()
+    bool m_enableKeyReference = false;
+
+    // lookups of MMKV_FROZEN instances, straight into the mapped file
+    mmkv::FrozenIndex *m_frozen = nullptr;
+#endif
+
 #ifdef MMKV_APPLE
     using MMKVKey_t = NSString *__unsafe_unretained;
     static bool isKeyEmpty(MMKVKey_t key) { return key.length <= 0; }
@@ -155,8 +285,25 @@ class MMKV {
 #  define mmkv_release_key(key) ((void) 0)
 #endif // !MMKV_APPLE
 
+    // evict the least recently used instances other than current, g_instanceLock must be held
+    static void evictIdleInstances(MMKV *current);
+
+    static MMKV *findInstance(const std::string &mmapKey);
+    static void registerInstance(const std::string &mmapKey, MMKV *kv);
+    static std::vector<MMKV *> allInstances();
+    static MMKVHandle retainCachedInstance(const std::string &mmapKey, const MMKVPath_t *path);
+    const std::string &instanceKey() const;
+    void retainHandle();
+    void releaseHandle();
+    void detachOrClose();
+    friend class MMKVHandle;
+
     void loadFromFile();
 
+#ifndef MMKV_APPLE
+    void loadFrozenFile();
+#endif
+
     void partialLoadFromFile();
 
     void loadMetaInfoAndCheck();
@@ -190,14 +337,70 @@ class MMKV {
 
     bool doFullWriteBack(mmkv::MMKVVector &&vec);
 
+#ifndef MMKV_APPLE
+    // snapshot of the dictionary's key offsets, saves the parsing of the whole file on next load
+    void writeSnapshot();
+
+    // return the data size covered by the snapshot, 0 if no valid snapshot is loaded
+    size_t loadFromSnapshot();
+
+    // replace the file with records encoded by BulkBuilder, whose offsets are in dic
+    bool writeBulkData(const std::vector<uint8_t> &data, mmkv::MMKVMap &dic, bool hasExpireDate);
+#endif
+
     mmkv::MMBuffer getRawDataForKey(MMKVKey_t key);
 
     mmkv::MMBuffer getDataForKey(MMKVKey_t key);
 
+    // without resolving blob references
+    mmkv::MMBuffer getStoredDataForKey(MMKVKey_t key);
+
     // isDataHolder: avoid memory copying
     bool setDataForKey(mmkv::MMBuffer &&data, MMKVKey_t key, bool isDataHolder = false);
+
+    template <typename T>
+    bool incrementValue(MMKVKey_t key, T delta, T *newValue);
 #ifndef MMKV_APPLE
     bool setDataForKey(mmkv::MMBuffer &&data, MMKVKey_t key, uint32_t expireDuration);
+
+    // a compressed value: 0x00 (an empty data holder never has trailing bytes), codec tag, varint length, compressed bytes
+    static bool isCompressedValue(const mmkv::MMBuffer &data);
+    // the logical length of a compressed value, false if it's malformed
+    static bool compressedValueLength(const mmkv::MMBuffer &data, size_t &length, size_t &headerSize);
+    // decompress into exactly length bytes of dst, stats is updated if not null
+    static bool decompressValue(const mmkv::MMBuffer &data, void *dst, size_t length, MMKVCompressionStats *stats = nullptr);
+    // decompressed into an owning MMBuffer, without the data holder header
+    static bool decompressValue(const mmkv::MMBuffer &data, mmkv::MMBuffer &result, MMKVCompressionStats *stats = nullptr);
+    static bool decompressString(const mmkv::MMBuffer &data, std::string &result, bool inplaceModification,
+                                 MMKVCompressionStats *stats = nullptr);
+    // return an empty buffer if it doesn't shrink by at least minRatio
+    mmkv::MMBuffer compressValue(const mmkv::MMBuffer &raw, double minRatio);
+
+    // a blob reference: 0x00, 'B', varint length, fixed64 blob id, fixed32 CRC of the blob
+    static bool isBlobReference(const mmkv::MMBuffer &data);
+    static bool parseBlobReference(const mmkv::MMBuffer &data, size_t &length, uint64_t &blobID, uint32_t &crcDigest);
+    MMKVPath_t blobPath(uint64_t blobID) const;
+    // write raw into a new blob file, return its reference, an empty buffer on error
+    mmkv::MMBuffer writeBlob(const mmkv::MMBuffer &raw);
+    // the blob referenced, as a data holder
+    mmkv::MMBuffer readBlob(const mmkv::MMBuffer &reference);
+    // read the blob referenced into exactly length bytes of dst
+    bool readBlob(const mmkv::MMBuffer &reference, void *dst, size_t length);
+    void removeBlob(const mmkv::MMBuffer &reference);
+    // the blob is no longer referenced by the latest data, it's removed by the sweep after the next full write back
+    void supersedeBlob(const mmkv::MMBuffer &reference);
+    // a copy of the blob reference in a value stored in the file, an empty buffer if it's not one
+    mmkv::MMBuffer copyBlobReference(const mmkv::MMBuffer &stored) const;
+    // the blob the current value of key refers to, to be superseded once it's overwritten or removed
+    mmkv::MMBuffer blobReferenceForKey(MMKVKey_t key) const;
+    void didSetDataForKey(const mmkv::MMBuffer &oldBlob);
+    // remove blob files no key refers to, left by overwriting, removing or crashing, only after the data is confirmed
+    void removeUnreferencedBlobs();
+
+    // serialize a value through reserve(), return its size, 0 on error
+    using ValueEncoder = std::function<size_t(const mmkv::MiniPBCoder::EncodeReserver &reserve)>;
+    // the value is encoded straight into the file when it's simply appended, otherwise into a MMBuffer first
+    bool setEncodedDataForKey(const ValueEncoder &encoder, MMKVKey_t key);
 #endif
 
     bool removeDataForKey(MMKVKey_t key);
@@ -207,6 +410,8 @@ class MMKV {
     KVHolderRet_t doAppendDataWithKey(const mmkv::MMBuffer &data, const mmkv::MMBuffer &key, bool isDataHolder, uint32_t keyLength);
     KVHolderRet_t appendDataWithKey(const mmkv::MMBuffer &data, MMKVKey_t key, bool isDataHolder = false);
     KVHolderRet_t appendDataWithKey(const mmkv::MMBuffer &data, const mmkv::KeyValueHolder &kvHolder, bool isDataHolder = false);
+    // the record of key is appended, the dictionary is searched again as appending might have rewritten it
+    void updateDictionary(MMKVKey_t key, mmkv::KeyValueHolder &&kvHolder);
 
     KVHolderRet_t doOverrideDataWithKey(const mmkv::MMBuffer &data, const mmkv::MMBuffer &key, bool isDataHolder, uint32_t keyLength);
     KVHolderRet_t overrideDataWithKey(const mmkv::MMBuffer &data, const mmkv::KeyValueHolder &kvHolder, bool isDataHolder = false);
@@ -221,6 +426,9 @@ class MMKV {
                                       MMKVKey_t key,
                                       const mmkv::KeyValueHolderCrypt &kvHolder,
                                       bool isDataHolder = false);
+#else
+    // the value is encoded straight into the file, not for encrypted instances
+    KVHolderRet_t doAppendDataWithKey(const ValueEncoder &encoder, MMKVKey_t key);
 #endif
 
     void notifyContentChanged();
@@ -242,6 +450,77 @@ class MMKV {
     static constexpr uint32_t ConstFixed32Size = 4;
     void shared_lock();
     void shared_unlock();
+
+    // used by the typed enumerate(), return false if data is not a valid T
+    static bool decodeValue(const mmkv::MMBuffer &data, bool &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, int32_t &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, uint32_t &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, int64_t &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, uint64_t &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, float &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, double &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, std::string &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, std::string_view &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, mmkv::MMBuffer &value);
+    static bool decodeValue(const mmkv::MMBuffer &data, std::vector<std::string> &value);
+
+    // the current value of key, copied out of the file, caller must hold the locks
+    template <typename T>
+    bool getValueForAtomicOp(MMKVKey_t key, T &value);
+
+    // key must be the one stored in the dictionary
+    void keyIndexInsert(const std::string &key);
+    // must be called before the key is erased from the dictionary
+    void eraseKeyFromIndexes(std::string_view key);
+    // must be called before the dictionary is cleared or reloaded
+    void invalidateIndexes();
+    void ensureKeyIndex();
+
+    // called after key is set with expireDate
+    void updateExpireIndex(std::string_view key, uint32_t expireDate);
+    void eraseFromExpireIndex(std::string_view key);
+    void buildExpireIndex();
+    static size_t reapExpiredKeys(size_t maxCount, uint32_t timeBudgetInMS);
+    static MMKV *openInstanceInBackground(const std::string &mmapID, MMKVMode mode, std::string *cryptKey,
+                                          MMKVPath_t *rootPath, size_t expectedCapacity);
+
+    // encode like set() does, strings & bytes are length-delimited
+    static mmkv::MMBuffer encodeValue(bool value);
+    static mmkv::MMBuffer encodeValue(int32_t value);
+    static mmkv::MMBuffer encodeValue(uint32_t value);
+    static mmkv::MMBuffer encodeValue(int64_t value);
+    static mmkv::MMBuffer encodeValue(uint64_t value);
+    static mmkv::MMBuffer encodeValue(float value);
+    static mmkv::MMBuffer encodeValue(double value);
+    static mmkv::MMBuffer encodeValue(const char *value);
+    static mmkv::MMBuffer encodeValue(const std::string &value);
+    static mmkv::MMBuffer encodeValue(std::string_view value);
+    static mmkv::MMBuffer encodeValue(const mmkv::MMBuffer &value);
+    static mmkv::MMBuffer encodeValue(const std::vector<std::string> &value);
+
+    bool enqueueWrite(mmkv::MMBuffer &&data, std::string_view key, uint32_t expireDuration);
+    WriteBehindQueue *writeBehindQueue();
+    // a task on the writer pool shared by all instances, kv is only touched if the queue is not stopped
+    static void runWriteBehind(MMKV *kv, std::shared_ptr<WriteBehindQueue> queue);
+    void applyPendingWrites(WriteBehindQueue *queue);
+    void applyPendingWrites();
+    // the queued value of key, with the expire date stripped
+    bool pendingDataForKey(std::string_view key, mmkv::MMBuffer &result);
+    // called before key is set or removed synchronously
+    void dropPendingWrite(std::string_view key);
+    void discardPendingWrites();
+    // the queue is drained before it's gone
+    void stopWriteBehind();
+#else
+    void keyIndexInsert(NSString *) {}
+    void eraseKeyFromIndexes(NSString *) {}
+    void invalidateIndexes() {}
+    void updateExpireIndex(NSString *, uint32_t) {}
+    void applyPendingWrites() {}
+    bool pendingDataForKey(NSString *, mmkv::MMBuffer &) { return false; }
+    void dropPendingWrite(NSString *) {}
+    void discardPendingWrites() {}
+    void stopWriteBehind() {}
 #endif
 
 public:
@@ -283,6 +562,37 @@ public:
     bool checkProcessMode();
 #endif // MMKV_ANDROID
 
+#ifndef MMKV_APPLE
+    // open & fully load instances on a background pool, the global instance lock is not held during the file I/O
+    // mmkvWithID() waits for an instance being opened in background, instead of opening it twice
+    static void prewarm(const std::vector<std::string> &mmapIDs, MMKVMode mode = MMKV_SINGLE_PROCESS, MMKVPath_t *rootPath = nullptr);
+
+    // callback runs on the pool thread, kv is nullptr on failure
+    // pending opens are dropped by onExit()
+    using OpenCallback = std::function<void(MMKV *kv)>;
+    static void mmkvWithIDAsync(const std::string &mmapID,
+                                OpenCallback callback,
+                                MMKVMode mode = MMKV_SINGLE_PROCESS,
+                                std::string *cryptKey = nullptr,
+                                MMKVPath_t *rootPath = nullptr,
+                                size_t expectedCapacity = 0);
+
+    static std::future<MMKV *> mmkvWithIDAsync(const std::string &mmapID,
+                                               MMKVMode mode = MMKV_SINGLE_PROCESS,
+                                               std::string *cryptKey = nullptr,
+                                               MMKVPath_t *rootPath = nullptr,
+                                               size_t expectedCapacity = 0);
+#endif
+
+    // a refcounted reference to the instance, which keeps it alive across concurrent close() & removeStorage()
+    // close() with handles alive is deferred to the release of the last handle
+    // the deferred close is canceled if the instance is looked up again before that, by mmkvWithID() or by taking another handle,
+    // because the pointer returned must stay valid, call close() again once it's no longer needed
+    static MMKVHandle mmkvHandleWithID(const std::string &mmapID,
+                                       MMKVMode mode = MMKV_SINGLE_PROCESS,
+                                       std::string *cryptKey = nullptr,
+                                       MMKVPath_t *rootPath = nullptr);
+
     // you can call this on application termination, it's totally fine if you don't call
     static void onExit();
 
@@ -296,13 +606,20 @@ public:
             || (m_mode & MMKV_ASHMEM) != 0; // ashmem is always multi-process
     }
 #endif
+#ifndef MMKV_APPLE
+    bool isReadOnly() const { return (m_mode & (MMKV_READ_ONLY | MMKV_FROZEN)) != 0; }
+    bool isFrozen() const { return (m_mode & MMKV_FROZEN) != 0; }
+#else
     bool isReadOnly() const { return (m_mode & MMKV_READ_ONLY) != 0; }
+    bool isFrozen() const { return false; }
+#endif
 
 #ifndef MMKV_DISABLE_CRYPT
     std::string cryptKey() const;
 
     // transform plain text into encrypted text, or vice versa with empty cryptKey
     // you can change existing crypt key with different cryptKey
+    // a plain instance with blob storage enabled or blobs referenced can't be encrypted, see enableBlobStorage()
     bool reKey(const std::string &cryptKey);
 
     // just reset cryptKey (will not encrypt or decrypt anything)
@@ -379,6 +696,18 @@ public:
 
     template<MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
     bool getVector(MMKVKey_t key, T &result);
+
+    // opt-in fixed-width format for vectors of int32_t, uint32_t, int64_t or uint64_t, read back by getVector()
+    // both encoding & decoding are a memcpy, but it takes more space than varints for small values
+    template<MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
+        requires MMKV_FIXED_WIDTH_VALUE_TYPE<typename T::value_type>
+    bool setFixedWidth(const T& value, MMKVKey_t key) {
+        return setFixedWidth<T>(value, key, m_expiredInSeconds);
+    }
+
+    template<MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
+        requires MMKV_FIXED_WIDTH_VALUE_TYPE<typename T::value_type>
+    bool setFixedWidth(const T& value, MMKVKey_t key, uint32_t expireDuration);
 #endif
 
     // inplaceModification is recommended for faster speed
@@ -405,6 +734,56 @@ public:
 
     double getDouble(MMKVKey_t key, double defaultValue = 0, MMKV_OUT bool *hasValue = nullptr);
 
+    // add delta to the value of key in one go, a missing key counts as 0
+    // the result is kept in fixed width, so that later increments are written in place instead of appended
+    bool incrementInt64(MMKVKey_t key, int64_t delta = 1, MMKV_OUT int64_t *newValue = nullptr);
+
+    bool incrementUInt64(MMKVKey_t key, uint64_t delta = 1, MMKV_OUT uint64_t *newValue = nullptr);
+
+    bool incrementDouble(MMKVKey_t key, double delta, MMKV_OUT double *newValue = nullptr);
+
+#ifndef MMKV_APPLE
+    // T of the atomic operations: bool, int32_t, uint32_t, int64_t, uint64_t, float, double,
+    // std::string, mmkv::MMBuffer or std::vector<std::string>
+
+    // set key to desired only if its current value equals expected, in one go across threads & processes
+    // on failure observed holds the current value, hasObserved tells whether the key exists as a T at all
+    // a missing key never equals expected, use setIfAbsent() to create it
+    template <typename T>
+    bool compareAndSet(MMKVKey_t key, const T &expected, const T &desired, MMKV_OUT T *observed = nullptr,
+                       MMKV_OUT bool *hasObserved = nullptr);
+
+    // set key to value only if it doesn't exist, in one go across threads & processes
+    // on failure observed holds the current value, if it's a T
+    template <typename T>
+    bool setIfAbsent(MMKVKey_t key, const T &value, MMKV_OUT T *observed = nullptr);
+
+    // set key to value in one go across threads & processes, returning the previous value in oldValue
+    template <typename T>
+    bool exchange(MMKVKey_t key, const T &value, MMKV_OUT T *oldValue = nullptr, MMKV_OUT bool *hasOldValue = nullptr);
+
+    // write-behind: the key-value is encoded & queued, then appended in batches by a writer pool shared by all instances
+    // later writes to the same key collapse, reads of this instance see the queued value right away
+    // other processes see it after it's appended, call flush() to wait for that
+    // T: bool, int32_t, uint32_t, int64_t, uint64_t, float, double, const char *, std::string, std::string_view,
+    // mmkv::MMBuffer or std::vector<std::string>
+    template <typename T>
+    bool setAsync(const T &value, std::string_view key) {
+        return enqueueWrite(encodeValue(value), key, m_expiredInSeconds);
+    }
+
+    template <typename T>
+    bool setAsync(const T &value, std::string_view key, uint32_t expireDuration) {
+        return enqueueWrite(encodeValue(value), key, expireDuration);
+    }
+
+    // when the queue is full, setAsync() appends the queued key-values on the calling thread
+    void setWriteBehindCapacity(size_t maxPendingKeys);
+
+    // append all key-values queued by setAsync() before this call
+    void flush() { applyPendingWrites(); }
+#endif
+
     // return the actual size consumption of the key's value
     // pass actualSize = true to get value's length
     size_t getValueSize(MMKVKey_t key, bool actualSize);
@@ -422,6 +801,16 @@ public:
 
     size_t actualSize();
 
+    // memory held by this instance, it walks through the dictionary, an unloaded instance holds nothing
+    MMKVMemoryStats memoryStats();
+
+    // the sum of memoryStats() of all instances
+    static MMKVMemoryStats globalMemoryStats();
+
+    // keep at most maxLoadedInstances instances loaded, with at most maxMappedBytes of their files mapped, 0 means no limit
+    // the least recently used ones are evicted by clearMemoryCache(), and reloaded transparently on next access
+    static void setMemoryBudget(size_t maxLoadedInstances, size_t maxMappedBytes = 0);
+
     static constexpr uint32_t ExpireNever = 0;
 
     // all keys created (or last modified) longer than expiredInSeconds will be deleted on next full-write-back
@@ -430,10 +819,67 @@ public:
 
     bool disableAutoKeyExpire();
 
+#ifndef MMKV_APPLE
+    // a background thread that removes expired keys of all instances with key expiration on, every intervalInSeconds
+    // each round removes at most maxKeysPerRound keys and stops after timeBudgetInMS
+    // while it's running, reading an expired key just returns nothing instead of removing it
+    static void startExpireReaper(uint32_t intervalInSeconds = 60, size_t maxKeysPerRound = 1000, uint32_t timeBudgetInMS = 20);
+    static void stopExpireReaper();
+    static bool isExpireReaperRunning();
+#endif
+
     // compare value for key before set, to reduce the possibility of file expanding
     bool enableCompareBeforeSet();
     bool disableCompareBeforeSet();
 
+#ifndef MMKV_APPLE
+    // strings & bytes of at least thresholdBytes are stored LZ4 compressed, if they shrink by at least minRatio
+    // they are decompressed transparently by reading, whether compression is still enabled or not
+    // every read pays for the decompression, about 20x the time of reading a 64KB value as is
+    // it runs through the built-in decoder of Core/lz4, about 0.9GB/s, a quarter of the reference LZ4 library
+    // so raise minRatio for values read far more often than written, values that don't reach it are stored as is
+    // minRatio must be at least 1, false otherwise
+    // it's not persisted, enable it each time the instance is opened
+    bool enableCompression(size_t thresholdBytes = DefaultCompressionThreshold, double minRatio = DefaultMinCompressionRatio);
+    bool disableCompression();
+    bool isCompressionEnabled() const { return m_compressionThreshold > 0; }
+    MMKVCompressionStats compressionStats();
+
+    static constexpr size_t DefaultCompressionThreshold = 1024;
+    // values shorter than this are never compressed
+    static constexpr size_t MinCompressionThreshold = 64;
+    // saving less than 1/3 of the space isn't worth decompressing on every read
+    static constexpr double DefaultMinCompressionRatio = 1.5;
+
+    // strings & bytes of at least thresholdBytes are stored in files of their own, in the "<mmapID>.blob" directory
+    // only a small reference is kept in the file, so that full write back, expanding & CRC never touch them again
+    // a blob is removed after its key is overwritten or removed, by the next full write back, which is forced
+    // once such blobs take over 1MB, it's backup & restored along with the file
+    // not for encrypted or ashmem instances, it's not persisted, blobs written are readable whether it's enabled or not
+    bool enableBlobStorage(size_t thresholdBytes = DefaultBlobThreshold);
+    bool disableBlobStorage();
+    bool isBlobStorageEnabled() const { return m_blobThreshold > 0; }
+
+    static constexpr size_t DefaultBlobThreshold = 256 * 1024;
+    // values shorter than this are never stored as blobs
+    static constexpr size_t MinBlobThreshold = 4096;
+
+    // an overwritten or removed key is written as the offset of its previous record, instead of the key itself
+    // it saves the key bytes of each update, frequently updated long keys benefit the most
+    // such files can't be read by versions without it, until a full write back replaces the offsets with the keys
+    // not for encrypted instances, it's not persisted, offsets written are readable whether it's enabled or not
+    bool enableKeyReference();
+    bool disableKeyReference();
+    bool isKeyReferenceEnabled() const { return m_enableKeyReference; }
+
+    // write all key-values into an immutable file, to be opened by mmkvWithID(dstMMapID, MMKV_FROZEN)
+    // keys are found by a minimal perfect hash, values are read in place, nothing is parsed or copied on loading
+    // expired keys are left out, blobs & encrypted values are stored as plain values, an existing file is replaced
+    bool exportFrozen(const std::string &dstMMapID, MMKVPath_t *dstRootPath = nullptr);
+
+    class BulkBuilder;
+#endif
+
     bool isExpirationEnabled() const { return m_enableKeyExpire; }
     bool isEncryptionEnabled() const { return m_dicCrypt; }
     bool isCompareBeforeSetEnabled() const { return m_enableCompareBeforeSet && !m_enableKeyExpire && !m_dicCrypt; }
@@ -456,6 +902,56 @@ public:
     std::vector<std::string> allKeys(bool filterExpire = false);
 
     bool removeValuesForKeys(const std::vector<std::string> &arrKeys);
+
+    // return false to stop the enumeration
+    // the key & value are views into MMKV's memory, they are only valid inside the callback
+    // value is the protobuf encoded data, decode it with mmkv::CodedInputData, or use the typed version below
+    using EnumerateCallback = std::function<bool(std::string_view key, const mmkv::MMBuffer &value)>;
+
+    // enumerate all key-values under one lock, without copying any of them
+    // expired keys are skipped, you should not modify this instance inside the callback
+    // return the count of key-values the callback is called for
+    size_t enumerate(const EnumerateCallback &callback);
+
+    // decode every value as T: bool, int32_t, uint32_t, int64_t, uint64_t, float, double,
+    // std::string_view (a view of the string in MMKV's memory), mmkv::MMBuffer (ditto) or std::string
+    // values failed to decode are skipped, so are compressed ones decoded as std::string_view
+    template <typename T>
+    size_t enumerate(const std::function<bool(std::string_view key, const T &value)> &callback);
+
+    // maintain an ordered index of all keys, to speed up scanPrefix(), scanRange() & removeValuesWithPrefix()
+    // it costs about 48 bytes per key, and a one-time O(n*log(n)) rebuild after each reload of the file
+    void enableKeyIndex();
+    void disableKeyIndex();
+    bool isKeyIndexEnabled() const { return m_keyIndex; }
+
+    // enumerate key-values whose key starts with prefix, in key order, see enumerate() for the callback
+    // it works without the key index too, by walking through all keys
+    size_t scanPrefix(std::string_view prefix, const EnumerateCallback &callback);
+
+    // enumerate key-values whose key is in [lowerKey, upperKey), in key order
+    size_t scanRange(std::string_view lowerKey, std::string_view upperKey, const EnumerateCallback &callback);
+
+    // return the count of key-values removed
+    size_t removeValuesWithPrefix(std::string_view prefix);
+
+    // a list of strings stored as one key-value per element, pushing appends only the new element
+    // the list key holds a tagged range of indexes, removing it removes the elements as well
+    // elements are kept under reserved keys, which allKeys(), count(), enumerate() & key scans skip
+    bool listPushBack(std::string_view key, std::string_view item);
+    bool listPopFront(std::string_view key, MMKV_OUT std::string *item = nullptr);
+    size_t listSize(std::string_view key);
+    // read at most count elements starting from the start-th one
+    bool listRange(std::string_view key, size_t start, size_t count, std::vector<std::string> &result);
+    bool removeList(std::string_view key);
+
+    // host a logical map inside this instance, sharing its files, locks & compaction with other namespaces
+    // the returned object is owned by this instance, it's valid until the instance is closed
+    // it enables the key index, keys starting with '\0' are reserved for namespaces & lists
+    MMKVNamespace *namespaceWithID(const std::string &namespaceID);
+
+    // all registered namespace IDs
+    std::vector<std::string> allNamespaces();
 #endif // MMKV_APPLE
 
     bool removeValueForKey(MMKVKey_t key);
@@ -470,6 +966,7 @@ public:
 
     // call this method if the instance is no longer needed in the near future
     // any subsequent call to the instance is undefined behavior
+    // with handles alive it's deferred to the release of the last handle, see mmkvHandleWithID()
     void close();
 
     // call this method if you are facing memory-warning
@@ -546,7 +1043,156 @@ public:
     // just forbid it for possibly misuse
     explicit MMKV(const MMKV &other) = delete;
     MMKV &operator=(const MMKV &other) = delete;
+
+private:
+#ifndef MMKV_APPLE
+    // strip the expire date & skip the expired one, return false to stop
+    bool visitKeyValue(std::string_view key, const mmkv::MMBuffer &raw, uint32_t now, const EnumerateCallback &callback, size_t &count);
+
+    // keys starting from lowerKey in order, until isInRange() returns false
+    // the views are only valid until the dictionary changes
+    std::vector<std::string_view> keysInRange(std::string_view lowerKey, const std::function<bool(std::string_view)> &isInRange);
+
+    size_t enumerateKeys(const std::vector<std::string_view> &keys, const EnumerateCallback &callback);
+
+    bool getListRange(std::string_view key, uint64_t &head, uint64_t &tail);
+    bool setListRange(std::string_view key, uint64_t head, uint64_t tail);
+    size_t listHeaderValueSize() const;
+    // keys of the elements if kvHolder holds a list header, whose value is of listHeaderValueSize()
+    std::vector<std::string> listItemKeys(std::string_view key, const mmkv::KeyValueHolder &kvHolder);
+#    ifndef MMKV_DISABLE_CRYPT
+    std::vector<std::string> listItemKeys(std::string_view key, const mmkv::KeyValueHolderCrypt &kvHolder);
+#    endif
+
+    // keys of list elements, hidden from the key APIs
+    static bool isHiddenKey(std::string_view key);
+    size_t hiddenKeyCount();
+    size_t doEnumerate(const EnumerateCallback &callback, bool includeHiddenKeys);
+#endif
+};
+
+// see MMKV::mmkvHandleWithID(), the instance is valid as long as any copy of the handle is alive
+class MMKVHandle {
+    MMKV *m_kv = nullptr;
+
+    enum RetainedTag { Retained };
+    MMKVHandle(MMKV *kv, RetainedTag) : m_kv(kv) {}
+
+    friend class MMKV;
+
+public:
+    MMKVHandle() = default;
+
+    MMKVHandle(const MMKVHandle &other) : m_kv(other.m_kv) {
+        if (m_kv) {
+            m_kv->retainHandle();
+        }
+    }
+
+    MMKVHandle(MMKVHandle &&other) noexcept : m_kv(other.m_kv) { other.m_kv = nullptr; }
+
+    MMKVHandle &operator=(const MMKVHandle &other) {
+        if (this != &other) {
+            MMKVHandle(other).swap(*this);
+        }
+        return *this;
+    }
+
+    MMKVHandle &operator=(MMKVHandle &&other) noexcept {
+        MMKVHandle(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~MMKVHandle() { reset(); }
+
+    void reset() {
+        if (m_kv) {
+            auto kv = m_kv;
+            m_kv = nullptr;
+            kv->releaseHandle();
+        }
+    }
+
+    void swap(MMKVHandle &other) noexcept { std::swap(m_kv, other.m_kv); }
+
+    MMKV *get() const { return m_kv; }
+    MMKV *operator->() const { return m_kv; }
+    MMKV &operator*() const { return *m_kv; }
+    explicit operator bool() const { return m_kv != nullptr; }
+};
+
+#ifndef MMKV_APPLE
+// builds all key-values of an instance from a stream
+// about 2x as fast as calling set() for each key: 2M small key-values took 2.0s instead of 4.1s in a release build
+// on Linux, see testBulkBuilderSpeed(), both build the same dictionary, which takes most of the time
+// records are encoded one after another into a buffer, which is written into the file on commit()
+// the file is sized once, the records are copied in one go & checked by one CRC pass, nothing is decoded
+// commit() replaces all existing key-values of the instance, encrypted & read-only instances are not supported
+// strings & bytes are compressed & moved into blobs as set() does, by the settings of the instance on construction
+// blobs are written on commit(), under its locks
+// the expire date set() would write is taken on commit(), key references are not used, as by a full write back
+class MMKV::BulkBuilder {
+    MMKVHandle m_kv;
+    // laid out as the file is, right after the actual size
+    std::vector<uint8_t> m_data;
+    mmkv::MMKVMap *m_dic;
+    // records of keys set again
+    size_t m_deadBytes = 0;
+    bool m_compactDuplicates = true;
+    bool m_hasExpireDate = false;
+    bool m_committed = false;
+    // the settings of the instance, taken under its lock on construction
+    size_t m_compressionThreshold = 0;
+    double m_minCompressionRatio = DefaultMinCompressionRatio;
+    size_t m_blobThreshold = 0;
+    // keys whose last value is large enough for a blob
+    std::unordered_set<std::string> m_blobKeys;
+
+    // the value part of a new record of key, whose expire date is left for commit(), nullptr on error
+    uint8_t *appendRecord(std::string_view key, size_t size);
+    // the same, without any check or bookkeeping, kvHolder is set to the record
+    uint8_t *writeRecord(std::string_view key, size_t size, mmkv::KeyValueHolder &kvHolder);
+    bool append(const mmkv::MMBuffer &value, std::string_view key);
+    bool appendBytes(const void *value, size_t length, std::string_view key);
+    // pointers to the key & the holder of each key's last record, in the order they're set
+    std::vector<std::pair<const std::string *, mmkv::KeyValueHolder *>> recordsInOrder();
+    void compact();
+    // re-encode the last record of each key, with the values of m_blobKeys moved into blobs, return their references
+    std::vector<mmkv::MMBuffer> writeBlobs();
+    void writeExpireDate(uint32_t expireDate);
+
+public:
+    explicit BulkBuilder(const std::string &mmapID, MMKVMode mode = MMKV_SINGLE_PROCESS, MMKVPath_t *rootPath = nullptr);
+    ~BulkBuilder();
+
+    BulkBuilder(const BulkBuilder &other) = delete;
+    BulkBuilder &operator=(const BulkBuilder &other) = delete;
+
+    // T: the same as setAsync(), a key set again overrides the earlier value
+    template <typename T>
+    bool set(const T &value, std::string_view key) {
+        return append(encodeValue(value), key);
+    }
+    bool set(std::string_view value, std::string_view key) { return appendBytes(value.data(), value.length(), key); }
+    bool set(const std::string &value, std::string_view key) { return appendBytes(value.data(), value.length(), key); }
+    bool set(const char *value, std::string_view key) { return set(std::string_view(value), key); }
+    bool set(const mmkv::MMBuffer &value, std::string_view key) {
+        return appendBytes(value.getPtr(), value.length(), key);
+    }
+
+    // the number of keys & the bytes of all keys & values expected, saves growing the dictionary & the buffer
+    void reserve(size_t keyCount, size_t size);
+
+    // whether only the last record of a key set more than once is written, true by default
+    // it's always the case when any value is moved into a blob
+    void setCompactDuplicates(bool compact) { m_compactDuplicates = compact; }
+
+    size_t count() const;
+
+    // write all key-values into the file & publish them, only once, nothing is written without it
+    bool commit();
 };
+#endif
 
 #if defined(MMKV_HAS_CPP20) && !defined(MMKV_APPLE)
 template<MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
@@ -554,12 +1200,41 @@ bool MMKV::set(const T& value, MMKVKey_t key, uint32_t expireDuration) {
     if (isKeyEmpty(key)) {
         return false;
     }
+    if (mmkv_likely(!m_enableKeyExpire)) {
+        return setEncodedDataForKey(
+            [&value](const mmkv::MiniPBCoder::EncodeReserver &reserve) {
+                if constexpr (std::is_same_v<T, std::vector<bool>>) {
+                    return mmkv::MiniPBCoder::encodeDataWithObject(value, reserve);
+                } else {
+                    return mmkv::MiniPBCoder::encodeDataWithObject(std::span(value), reserve);
+                }
+            },
+            key);
+    }
     mmkv::MMBuffer data;
     if constexpr (std::is_same_v<T, std::vector<bool>>) {
         data = mmkv::MiniPBCoder::encodeDataWithObject(value);
     } else {
         data = mmkv::MiniPBCoder::encodeDataWithObject(std::span(value));
     }
+    if (data.length() > 0) {
+        auto tmp = mmkv::MMBuffer(data.length() + ConstFixed32Size);
+        auto ptr = (uint8_t *) tmp.getPtr();
+        memcpy(ptr, data.getPtr(), data.length());
+        auto time = (expireDuration != ExpireNever) ? getCurrentTimeInSecond() + expireDuration : ExpireNever;
+        memcpy(ptr + data.length(), &time, ConstFixed32Size);
+        data = std::move(tmp);
+    }
+    return setDataForKey(std::move(data), key);
+}
+
+template<MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
+    requires MMKV_FIXED_WIDTH_VALUE_TYPE<typename T::value_type>
+bool MMKV::setFixedWidth(const T& value, MMKVKey_t key, uint32_t expireDuration) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    auto data = mmkv::MiniPBCoder::encodeFixedWidthVector(std::span(value));
     if (mmkv_unlikely(m_enableKeyExpire) && data.length() > 0) {
         auto tmp = mmkv::MMBuffer(data.length() + ConstFixed32Size);
         auto ptr = (uint8_t *) tmp.getPtr();
@@ -589,6 +1264,23 @@ bool MMKV::getVector(MMKVKey_t key, T &result) {
 }
 #endif // MMKV_HAS_CPP20 && !MMKV_APPLE
 
+#ifndef MMKV_APPLE
+template <typename T>
+size_t MMKV::enumerate(const std::function<bool(std::string_view key, const T &value)> &callback) {
+    if (!callback) {
+        return 0;
+    }
+    return enumerate([&callback](std::string_view key, const mmkv::MMBuffer &data) {
+        T value;
+        if (!decodeValue(data, value)) {
+            return true;
+        }
+        return callback(key, value);
+    });
+}
+
+#endif // !MMKV_APPLE
+
 MMKV_NAMESPACE_END
 
 #endif
@@ -0,0 +1,353 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2026 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MMKVFrozen.h"
+
+#ifndef MMKV_APPLE
+
+#    include "MMKVLog.h"
+#    include <algorithm>
+#    include <cstdint>
+#    include <cstring>
+#    include <vector>
+
+using namespace std;
+
+namespace mmkv {
+
+constexpr uint32_t FrozenVersion = 1;
+constexpr size_t HeaderSize = 32;
+constexpr size_t EntrySize = 16;
+constexpr size_t ValueAlignment = 8;
+// average keys of a bucket, more is smaller but slower to build
+constexpr size_t KeysPerBucket = 3;
+constexpr uint32_t MaxTriesPerBucket = 1 << 20;
+constexpr int MaxSeeds = 16;
+
+// the file is shared across processes & architectures, so it's always little-endian
+static uint32_t load32(const uint8_t *ptr) {
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+static uint64_t load64(const uint8_t *ptr) {
+    return load32(ptr) | (static_cast<uint64_t>(load32(ptr + 4)) << 32);
+}
+
+static void store32(uint8_t *ptr, uint32_t value) {
+    ptr[0] = static_cast<uint8_t>(value);
+    ptr[1] = static_cast<uint8_t>(value >> 8);
+    ptr[2] = static_cast<uint8_t>(value >> 16);
+    ptr[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static void store64(uint8_t *ptr, uint64_t value) {
+    store32(ptr, static_cast<uint32_t>(value));
+    store32(ptr + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static size_t alignUp(size_t size) {
+    return (size + ValueAlignment - 1) & ~(ValueAlignment - 1);
+}
+
+// the finalizer of splitmix64
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hashKey(string_view key, uint64_t seed) {
+    auto ptr = reinterpret_cast<const uint8_t *>(key.data());
+    auto size = key.size();
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+    for (; size >= 8; ptr += 8, size -= 8) {
+        h = mix64(h ^ load64(ptr));
+    }
+    if (size > 0) {
+        uint64_t tail = 0;
+        for (size_t i = 0; i < size; i++) {
+            tail |= static_cast<uint64_t>(ptr[i]) << (i * 8);
+        }
+        h = mix64(h ^ tail);
+    }
+    return mix64(h);
+}
+
+// the slot of a key in its bucket's try, each try is a pair of (d0, d1) packed as d0 * count + d1
+struct SlotHash {
+    uint32_t f1;
+    uint32_t f2;
+
+    SlotHash(uint64_t h, uint32_t count)
+        : f1(static_cast<uint32_t>(h) % count), f2(static_cast<uint32_t>(mix64(h)) % count) {}
+
+    uint32_t slot(uint32_t displacement, uint32_t count) const {
+        uint64_t d0 = displacement / count, d1 = displacement % count;
+        return static_cast<uint32_t>((f1 + d0 * f2 + d1) % count);
+    }
+};
+
+static uint32_t bucketOf(uint64_t h, uint32_t bucketCount) {
+    return static_cast<uint32_t>(h >> 32) % bucketCount;
+}
+
+// slotToEntry[slot] is the index of the key in that slot, false if some bucket can't be placed with this seed
+static bool placeKeys(const MMKVVector &items, uint64_t seed, uint32_t bucketCount, vector<uint32_t> &displacements,
+                      vector<uint32_t> &slotToEntry) {
+    auto count = static_cast<uint32_t>(items.size());
+    vector<uint32_t> bucketStart(bucketCount + 1, 0);
+    vector<uint64_t> hashes(count);
+    for (uint32_t index = 0; index < count; index++) {
+        hashes[index] = hashKey(items[index].first, seed);
+        bucketStart[bucketOf(hashes[index], bucketCount) + 1]++;
+    }
+    for (uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStart[bucket + 1] += bucketStart[bucket];
+    }
+    vector<uint32_t> bucketKeys(count);
+    {
+        auto fill = bucketStart;
+        for (uint32_t index = 0; index < count; index++) {
+            bucketKeys[fill[bucketOf(hashes[index], bucketCount)]++] = index;
+        }
+    }
+    // the biggest buckets first, while most slots are free
+    vector<uint32_t> order(bucketCount);
+    for (uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+        order[bucket] = bucket;
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b];
+    });
+
+    displacements.assign(bucketCount, 0);
+    slotToEntry.assign(count, UINT32_MAX);
+    vector<uint32_t> slots;
+    uint32_t freeSlot = 0;
+    for (auto bucket : order) {
+        auto begin = bucketStart[bucket], end = bucketStart[bucket + 1];
+        if (begin == end) {
+            break;
+        }
+        // a single key goes straight into the next free slot, searching for it would be linear probing
+        if (end - begin == 1) {
+            while (slotToEntry[freeSlot] != UINT32_MAX) {
+                freeSlot++;
+            }
+            displacements[bucket] = (freeSlot + count - SlotHash(hashes[bucketKeys[begin]], count).f1) % count;
+            slotToEntry[freeSlot] = bucketKeys[begin];
+            continue;
+        }
+        bool placed = false;
+        for (uint32_t displacement = 0; displacement < MaxTriesPerBucket && !placed; displacement++) {
+            slots.clear();
+            for (auto pos = begin; pos < end; pos++) {
+                auto slot = SlotHash(hashes[bucketKeys[pos]], count).slot(displacement, count);
+                if (slotToEntry[slot] != UINT32_MAX) {
+                    break;
+                }
+                // taken temporarily, so that keys of the same bucket don't collide
+                slotToEntry[slot] = bucketKeys[pos];
+                slots.push_back(slot);
+            }
+            if (slots.size() == end - begin) {
+                displacements[bucket] = displacement;
+                placed = true;
+            } else {
+                for (auto slot : slots) {
+                    slotToEntry[slot] = UINT32_MAX;
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MMBuffer FrozenIndex::build(const MMKVVector &items) {
+    if (items.size() >= UINT32_MAX) {
+        MMKVError("too many keys for a frozen file: %zu", items.size());
+        return MMBuffer();
+    }
+    for (size_t index = 1; index < items.size(); index++) {
+        if (!(items[index - 1].first < items[index].first)) {
+            MMKVError("keys of a frozen file must be sorted & unique: [%s]", items[index].first.c_str());
+            return MMBuffer();
+        }
+    }
+    auto count = static_cast<uint32_t>(items.size());
+    auto bucketCount = static_cast<uint32_t>((count + KeysPerBucket - 1) / KeysPerBucket);
+
+    uint64_t seed = 0x4d4d4b5646524f5aULL;
+    vector<uint32_t> displacements, slotToEntry;
+    if (count > 0) {
+        int tries = 0;
+        while (!placeKeys(items, seed, bucketCount, displacements, slotToEntry)) {
+            if (++tries >= MaxSeeds) {
+                MMKVError("fail to build the perfect hash of %u keys", count);
+                return MMBuffer();
+            }
+            seed = mix64(seed + tries);
+        }
+    }
+
+    size_t entriesOffset = alignUp(HeaderSize + (static_cast<size_t>(bucketCount) + count) * sizeof(uint32_t));
+    size_t fileSize = entriesOffset + static_cast<size_t>(count) * EntrySize;
+    for (const auto &item : items) {
+        fileSize = alignUp(fileSize + item.first.size()) + item.second.length();
+    }
+    if (fileSize > UINT32_MAX) {
+        MMKVError("frozen file too large: %zu", fileSize);
+        return MMBuffer();
+    }
+
+    MMBuffer result(fileSize);
+    auto ptr = static_cast<uint8_t *>(result.getPtr());
+    memset(ptr, 0, fileSize);
+    store32(ptr, Magic);
+    store32(ptr + 4, FrozenVersion);
+    store32(ptr + 8, count);
+    store32(ptr + 12, bucketCount);
+    store64(ptr + 16, seed);
+    store32(ptr + 24, static_cast<uint32_t>(fileSize));
+
+    auto cursor = ptr + HeaderSize;
+    for (auto displacement : displacements) {
+        store32(cursor, displacement);
+        cursor += sizeof(uint32_t);
+    }
+    for (auto entry : slotToEntry) {
+        store32(cursor, entry);
+        cursor += sizeof(uint32_t);
+    }
+    auto entry = ptr + entriesOffset;
+    size_t offset = entriesOffset + static_cast<size_t>(count) * EntrySize;
+    for (const auto &item : items) {
+        auto keySize = item.first.size(), valueSize = item.second.length();
+        memcpy(ptr + offset, item.first.data(), keySize);
+        store32(entry, static_cast<uint32_t>(offset));
+        store32(entry + 4, static_cast<uint32_t>(keySize));
+        offset = alignUp(offset + keySize);
+        if (valueSize > 0) {
+            memcpy(ptr + offset, item.second.getPtr(), valueSize);
+        }
+        store32(entry + 8, static_cast<uint32_t>(offset));
+        store32(entry + 12, static_cast<uint32_t>(valueSize));
+        offset += valueSize;
+        entry += EntrySize;
+    }
+    return result;
+}
+
+bool FrozenIndex::open(const void *ptr, size_t size) {
+    *this = FrozenIndex();
+    auto bytes = static_cast<const uint8_t *>(ptr);
+    if (!bytes || size < HeaderSize || load32(bytes) != Magic) {
+        return false;
+    }
+    auto version = load32(bytes + 4);
+    if (version != FrozenVersion) {
+        MMKVError("unsupported frozen file version %u", version);
+        return false;
+    }
+    auto count = load32(bytes + 8);
+    auto bucketCount = load32(bytes + 12);
+    size_t fileSize = load32(bytes + 24);
+    size_t entriesOffset = alignUp(HeaderSize + (static_cast<size_t>(bucketCount) + count) * sizeof(uint32_t));
+    if (fileSize > size || entriesOffset + static_cast<size_t>(count) * EntrySize > fileSize ||
+        (count > 0) != (bucketCount > 0)) {
+        MMKVError("malformed frozen file, count %u, bucket count %u, size %zu of %zu", count, bucketCount, fileSize, size);
+        return false;
+    }
+    m_ptr = bytes;
+    m_size = fileSize;
+    m_count = count;
+    m_bucketCount = bucketCount;
+    m_seed = load64(bytes + 16);
+    m_displacements = bytes + HeaderSize;
+    m_slots = m_displacements + static_cast<size_t>(bucketCount) * sizeof(uint32_t);
+    m_entries = bytes + entriesOffset;
+    return true;
+}
+
+uint32_t FrozenIndex::slotEntry(string_view key) const {
+    auto h = hashKey(key, m_seed);
+    auto displacement = load32(m_displacements + bucketOf(h, m_bucketCount) * sizeof(uint32_t));
+    auto slot = SlotHash(h, m_count).slot(displacement, m_count);
+    return load32(m_slots + static_cast<size_t>(slot) * sizeof(uint32_t));
+}
+
+MMBuffer FrozenIndex::find(string_view key) const {
+    if (m_count == 0) {
+        return MMBuffer();
+    }
+    auto index = slotEntry(key);
+    if (index >= m_count || keyAt(index) != key) {
+        return MMBuffer();
+    }
+    return valueAt(index);
+}
+
+string_view FrozenIndex::keyAt(size_t index) const {
+    if (index >= m_count) {
+        return {};
+    }
+    auto entry = m_entries + index * EntrySize;
+    size_t offset = load32(entry), size = load32(entry + 4);
+    if (offset + size > m_size) {
+        return {};
+    }
+    return {reinterpret_cast<const char *>(m_ptr + offset), size};
+}
+
+MMBuffer FrozenIndex::valueAt(size_t index) const {
+    if (index >= m_count) {
+        return MMBuffer();
+    }
+    auto entry = m_entries + index * EntrySize;
+    size_t offset = load32(entry + 8), size = load32(entry + 12);
+    if (offset + size > m_size) {
+        return MMBuffer();
+    }
+    // the file is mapped read-only, the buffer is never written
+    return MMBuffer(const_cast<uint8_t *>(m_ptr + offset), size, MMBufferNoCopy);
+}
+
+size_t FrozenIndex::lowerBound(string_view key) const {
+    size_t low = 0, high = m_count;
+    while (low < high) {
+        auto mid = low + (high - low) / 2;
+        if (keyAt(mid) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+} // namespace mmkv
+
+#endif // !MMKV_APPLE
@@ -0,0 +1,78 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2026 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MMKV_MMKVFROZEN_H
+#define MMKV_MMKVFROZEN_H
+#ifdef __cplusplus
+
+#include "MMBuffer.h"
+
+#ifndef MMKV_APPLE
+
+#    include <string_view>
+
+namespace mmkv {
+
+// an immutable file of key-values, see MMKV::exportFrozen() & MMKV_FROZEN
+// header | displacement of each bucket | entry index of each slot | entries sorted by key | keys & values
+// each value starts 8-byte aligned, right after its key
+// a key's slot comes from a minimal perfect hash (CHD without the compression): keys are hashed into buckets,
+// each bucket has a displacement that moves its keys into slots of their own, one slot for each key
+class FrozenIndex {
+    const uint8_t *m_ptr = nullptr;
+    size_t m_size = 0;
+    uint32_t m_count = 0;
+    uint32_t m_bucketCount = 0;
+    uint64_t m_seed = 0;
+    const uint8_t *m_displacements = nullptr;
+    const uint8_t *m_slots = nullptr;
+    const uint8_t *m_entries = nullptr;
+
+    // the index of the entry key would be in, not necessarily holding key
+    uint32_t slotEntry(std::string_view key) const;
+
+public:
+    // the file content of items, which must be sorted by key without duplicates, an empty buffer on error
+    static MMBuffer build(const MMKVVector &items);
+
+    // no parsing, only the header is checked, entries are checked on access
+    // false if it's not a frozen file, the index is empty then
+    bool open(const void *ptr, size_t size);
+
+    size_t count() const { return m_count; }
+
+    // the value of key, an empty buffer if there's no such key
+    MMBuffer find(std::string_view key) const;
+
+    // in the order of keys, an empty key & value if the entry is malformed
+    std::string_view keyAt(size_t index) const;
+    MMBuffer valueAt(size_t index) const;
+
+    // the index of the first key not less than key
+    size_t lowerBound(std::string_view key) const;
+
+    static constexpr uint32_t Magic = 0x46564B4D; // "MKVF"
+};
+
+} // namespace mmkv
+
+#endif // !MMKV_APPLE
+#endif // __cplusplus
+#endif // MMKV_MMKVFROZEN_H
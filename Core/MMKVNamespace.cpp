@@ -0,0 +1,155 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2025 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MMKVNamespace.h"
+
+#ifndef MMKV_APPLE
+
+#    include "InterProcessLock.h"
+#    include "MMKVLog.h"
+#    include "ScopedLock.hpp"
+#    include "ThreadLock.h"
+#    include <algorithm>
+
+using namespace std;
+using namespace mmkv;
+
+// "\0\0" holds the last assigned namespace id, "\0\0" + namespaceID holds the id of each namespace
+// ids start from 1, so no namespace prefix ('\0' + varint(id)) collides with the registry
+static const string NamespaceRegistryPrefix("\0\0", 2);
+
+MMKVNamespace::MMKVNamespace(MMKV *container, string namespaceID, uint32_t compactID)
+    : m_container(container), m_namespaceID(std::move(namespaceID)), m_compactID(compactID) {
+    m_prefix.push_back('\0');
+    while (compactID > 0x7f) {
+        m_prefix.push_back(static_cast<char>((compactID & 0x7f) | 0x80));
+        compactID >>= 7;
+    }
+    m_prefix.push_back(static_cast<char>(compactID));
+}
+
+bool MMKVNamespace::removeValuesForKeys(const vector<string> &arrKeys) {
+    vector<string> realKeys;
+    realKeys.reserve(arrKeys.size());
+    for (const auto &key : arrKeys) {
+        realKeys.push_back(realKey(key));
+    }
+    return m_container->removeValuesForKeys(realKeys);
+}
+
+vector<string> MMKVNamespace::allKeys() {
+    vector<string> keys;
+    auto prefixLength = m_prefix.length();
+    m_container->scanPrefix(m_prefix, [&](string_view key, const MMBuffer &) {
+        keys.emplace_back(key.substr(prefixLength));
+        return true;
+    });
+    return keys;
+}
+
+size_t MMKVNamespace::count() {
+    return m_container->scanPrefix(m_prefix, [](string_view, const MMBuffer &) { return true; });
+}
+
+void MMKVNamespace::clearAll() {
+    m_container->removeValuesWithPrefix(m_prefix);
+}
+
+size_t MMKVNamespace::enumerate(const MMKV::EnumerateCallback &callback) {
+    if (!callback) {
+        return 0;
+    }
+    auto prefixLength = m_prefix.length();
+    return m_container->scanPrefix(m_prefix, [&](string_view key, const MMBuffer &value) {
+        return callback(key.substr(prefixLength), value);
+    });
+}
+
+MMKVNamespace *MMKV::namespaceWithID(const string &namespaceID) {
+    // "\0\0\0" is reserved for elements of lists
+    if (namespaceID.empty() || namespaceID[0] == '\0') {
+        return nullptr;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    if (!m_namespaces) {
+        m_namespaces = new unordered_map<string, MMKVNamespace *>();
+    }
+    auto registryKey = NamespaceRegistryPrefix + namespaceID;
+    bool hasValue = false;
+    auto compactID = getUInt32(registryKey, 0, &hasValue);
+
+    auto itr = m_namespaces->find(namespaceID);
+    if (itr != m_namespaces->end()) {
+        auto ns = itr->second;
+        if (!hasValue && !isReadOnly()) {
+            // the registry has been cleared (e.g. by clearAll()), register the id again
+            auto lastID = getUInt32(NamespaceRegistryPrefix);
+            if (lastID < ns->m_compactID) {
+                set(ns->m_compactID, NamespaceRegistryPrefix, ExpireNever);
+            }
+            set(ns->m_compactID, registryKey, ExpireNever);
+        } else if (hasValue && compactID != ns->m_compactID) {
+            MMKVWarning("namespace [%s] of [%s] has been registered as %u by others, keep using %u", namespaceID.c_str(),
+                        m_mmapID.c_str(), compactID, ns->m_compactID);
+        }
+        return ns;
+    }
+
+    if (!hasValue || compactID == 0) {
+        if (isReadOnly()) {
+            MMKVWarning("[%s] is read-only, can't register namespace [%s]", m_mmapID.c_str(), namespaceID.c_str());
+            return nullptr;
+        }
+        // ids held by cached namespaces are never reused, even if the registry has been cleared
+        uint32_t lastID = getUInt32(NamespaceRegistryPrefix);
+        for (auto &pair : *m_namespaces) {
+            lastID = std::max(lastID, pair.second->m_compactID);
+        }
+        compactID = lastID + 1;
+        if (!set(compactID, NamespaceRegistryPrefix, ExpireNever) || !set(compactID, registryKey, ExpireNever)) {
+            MMKVError("fail to register namespace [%s] of [%s]", namespaceID.c_str(), m_mmapID.c_str());
+            return nullptr;
+        }
+        MMKVInfo("register namespace [%s] of [%s] as %u", namespaceID.c_str(), m_mmapID.c_str(), compactID);
+    }
+
+    // namespace operations are prefix scans, keep them proportional to the namespace's size
+    enableKeyIndex();
+
+    auto ns = new MMKVNamespace(this, namespaceID, compactID);
+    (*m_namespaces)[namespaceID] = ns;
+    return ns;
+}
+
+vector<string> MMKV::allNamespaces() {
+    vector<string> result;
+    scanPrefix(NamespaceRegistryPrefix, [&](string_view key, const MMBuffer &) {
+        if (key.length() > NamespaceRegistryPrefix.length()) {
+            result.emplace_back(key.substr(NamespaceRegistryPrefix.length()));
+        }
+        return true;
+    });
+    return result;
+}
+
+#endif // !MMKV_APPLE
@@ -0,0 +1,177 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2025 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MMKV_MMKVNAMESPACE_H
+#define MMKV_MMKVNAMESPACE_H
+#ifdef __cplusplus
+
+#include "MMKV.h"
+
+#ifndef MMKV_APPLE
+
+MMKV_NAMESPACE_BEGIN
+
+// a logical map hosted by a container MMKV instance, see MMKV::namespaceWithID()
+// all namespaces of a container share its data file & meta file, and are compacted together
+// keys are stored as '\0' + varint(namespace id) + key, container keys starting with '\0' are reserved
+class MMKVNamespace {
+    MMKV *m_container;
+    std::string m_namespaceID;
+    uint32_t m_compactID;
+    std::string m_prefix;
+
+    MMKVNamespace(MMKV *container, std::string namespaceID, uint32_t compactID);
+
+    std::string realKey(std::string_view key) const {
+        std::string result;
+        result.reserve(m_prefix.length() + key.length());
+        result.append(m_prefix).append(key);
+        return result;
+    }
+
+    friend class MMKV;
+
+public:
+    const std::string &namespaceID() const { return m_namespaceID; }
+
+    MMKV *container() const { return m_container; }
+
+    template <typename T>
+    bool set(T &&value, std::string_view key) {
+        return m_container->set(std::forward<T>(value), realKey(key));
+    }
+
+    template <typename T>
+    bool set(T &&value, std::string_view key, uint32_t expireDuration) {
+        return m_container->set(std::forward<T>(value), realKey(key), expireDuration);
+    }
+
+    bool getBool(std::string_view key, bool defaultValue = false, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getBool(realKey(key), defaultValue, hasValue);
+    }
+
+    int32_t getInt32(std::string_view key, int32_t defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getInt32(realKey(key), defaultValue, hasValue);
+    }
+
+    uint32_t getUInt32(std::string_view key, uint32_t defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getUInt32(realKey(key), defaultValue, hasValue);
+    }
+
+    int64_t getInt64(std::string_view key, int64_t defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getInt64(realKey(key), defaultValue, hasValue);
+    }
+
+    uint64_t getUInt64(std::string_view key, uint64_t defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getUInt64(realKey(key), defaultValue, hasValue);
+    }
+
+    float getFloat(std::string_view key, float defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getFloat(realKey(key), defaultValue, hasValue);
+    }
+
+    double getDouble(std::string_view key, double defaultValue = 0, MMKV_OUT bool *hasValue = nullptr) {
+        return m_container->getDouble(realKey(key), defaultValue, hasValue);
+    }
+
+    bool getString(std::string_view key, std::string &result, bool inplaceModification = true) {
+        return m_container->getString(realKey(key), result, inplaceModification);
+    }
+
+    mmkv::MMBuffer getBytes(std::string_view key) { return m_container->getBytes(realKey(key)); }
+
+    bool getBytes(std::string_view key, mmkv::MMBuffer &result) { return m_container->getBytes(realKey(key), result); }
+
+    bool getVector(std::string_view key, std::vector<std::string> &result) {
+        return m_container->getVector(realKey(key), result);
+    }
+
+#ifdef MMKV_HAS_CPP20
+    template <MMKV_SUPPORTED_VECTOR_VALUE_TYPE T>
+    bool getVector(std::string_view key, T &result) {
+        return m_container->getVector(realKey(key), result);
+    }
+#endif
+
+    size_t getValueSize(std::string_view key, bool actualSize) {
+        return m_container->getValueSize(realKey(key), actualSize);
+    }
+
+    int32_t writeValueToBuffer(std::string_view key, void *ptr, int32_t size) {
+        return m_container->writeValueToBuffer(realKey(key), ptr, size);
+    }
+
+    bool incrementInt64(std::string_view key, int64_t delta = 1, MMKV_OUT int64_t *newValue = nullptr) {
+        return m_container->incrementInt64(realKey(key), delta, newValue);
+    }
+
+    bool incrementUInt64(std::string_view key, uint64_t delta = 1, MMKV_OUT uint64_t *newValue = nullptr) {
+        return m_container->incrementUInt64(realKey(key), delta, newValue);
+    }
+
+    bool incrementDouble(std::string_view key, double delta, MMKV_OUT double *newValue = nullptr) {
+        return m_container->incrementDouble(realKey(key), delta, newValue);
+    }
+
+    template <typename T>
+    bool compareAndSet(std::string_view key, const T &expected, const T &desired, MMKV_OUT T *observed = nullptr,
+                       MMKV_OUT bool *hasObserved = nullptr) {
+        return m_container->compareAndSet(realKey(key), expected, desired, observed, hasObserved);
+    }
+
+    template <typename T>
+    bool setIfAbsent(std::string_view key, const T &value, MMKV_OUT T *observed = nullptr) {
+        return m_container->setIfAbsent(realKey(key), value, observed);
+    }
+
+    template <typename T>
+    bool exchange(std::string_view key, const T &value, MMKV_OUT T *oldValue = nullptr, MMKV_OUT bool *hasOldValue = nullptr) {
+        return m_container->exchange(realKey(key), value, oldValue, hasOldValue);
+    }
+
+    bool containsKey(std::string_view key) { return m_container->containsKey(realKey(key)); }
+
+    bool removeValueForKey(std::string_view key) { return m_container->removeValueForKey(realKey(key)); }
+
+    bool removeValuesForKeys(const std::vector<std::string> &arrKeys);
+
+    // the keys are walked through in order, fast with the container's key index
+    std::vector<std::string> allKeys();
+
+    size_t count();
+
+    // remove all keys of the namespace, the container file is not trimmed
+    void clearAll();
+
+    // see MMKV::enumerate(), keys are passed without the namespace prefix
+    size_t enumerate(const MMKV::EnumerateCallback &callback);
+
+    void sync(SyncFlag flag = MMKV_SYNC) { m_container->sync(flag); }
+
+    // just forbid it for possibly misuse
+    explicit MMKVNamespace(const MMKVNamespace &other) = delete;
+    MMKVNamespace &operator=(const MMKVNamespace &other) = delete;
+};
+
+MMKV_NAMESPACE_END
+
+#endif // !MMKV_APPLE
+#endif // __cplusplus
+#endif // MMKV_MMKVNAMESPACE_H
@@ -30,20 +30,25 @@
 #    include "MemoryFile.h"
 #    include "ScopedLock.hpp"
 #    include "ThreadLock.h"
+#    include <atomic>
 #    include <unistd.h>
 #    include "MMKV_IO.h"
 
 using namespace std;
 using namespace mmkv;
 
-extern unordered_map<string, MMKV *> *g_instanceDic;
 extern ThreadLock *g_instanceLock;
+extern atomic<bool> g_memoryBudgetEnabled;
+extern atomic<uint64_t> g_accessTick;
+extern bool isOpeningAsync(const string &mmapKey);
+extern bool waitForOpeningAsync(const string &mmapKey);
 
 MMKV::MMKV(const string &mmapID, int size, MMKVMode mode, string *cryptKey, string *rootPath, size_t expectedCapacity)
     : m_mmapID((mode & MMKV_BACKUP) ? mmapID : mmapedKVKey(mmapID, rootPath)) // historically Android mistakenly use mmapKey as mmapID
     , m_mode(mode)
     , m_path(mappedKVPathWithID(m_mmapID, mode, rootPath))
-    , m_crcPath(crcPathWithID(m_mmapID, mode, rootPath))
+    // a frozen file has no meta file, the lock is taken on the file itself
+    , m_crcPath(isFrozen() ? m_path : crcPathWithID(m_mmapID, mode, rootPath))
     , m_dic(nullptr)
     , m_dicCrypt(nullptr)
     , m_expectedCapacity(std::max<size_t>(DEFAULT_MMAP_SIZE, roundUp<size_t>(expectedCapacity, DEFAULT_MMAP_SIZE)))
@@ -141,12 +146,20 @@ MMKV *MMKV::mmkvWithID(const string &mmapID, int size, MMKVMode mode, string *cr
     if (mmapID.empty() || !g_instanceLock) {
         return nullptr;
     }
+    auto mmapKey = mmapedKVKey(mmapID, rootPath);
+    if (auto kv = findInstance(mmapKey)) {
+        return kv;
+    }
     SCOPED_LOCK(g_instanceLock);
 
-    auto mmapKey = mmapedKVKey(mmapID, rootPath);
-    auto itr = g_instanceDic->find(mmapKey);
-    if (itr != g_instanceDic->end()) {
-        MMKV *kv = itr->second;
+    auto kv = findInstance(mmapKey);
+    while (!kv && isOpeningAsync(mmapKey)) {
+        if (!waitForOpeningAsync(mmapKey)) {
+            return nullptr;
+        }
+        kv = findInstance(mmapKey);
+    }
+    if (kv) {
         return kv;
     }
     if (rootPath) {
@@ -157,8 +170,12 @@ MMKV *MMKV::mmkvWithID(const string &mmapID, int size, MMKVMode mode, string *cr
         }
         MMKVInfo("prepare to load %s (id %s) from rootPath %zu", mmapID.c_str(), mmapKey.c_str(), rootPath->c_str());
     }
-    auto kv = new MMKV(mmapID, size, mode, cryptKey, rootPath, expectedCapacity);
-    (*g_instanceDic)[mmapKey] = kv;
+    kv = new MMKV(mmapID, size, mode, cryptKey, rootPath, expectedCapacity);
+    registerInstance(mmapKey, kv);
+    kv->m_lastAccessTick = ++g_accessTick;
+    if (g_memoryBudgetEnabled) {
+        evictIdleInstances(kv);
+    }
     return kv;
 }
 
@@ -169,16 +186,18 @@ MMKV *MMKV::mmkvWithAshmemFD(const string &mmapID, int fd, int metaFD, string *c
     }
     SCOPED_LOCK(g_instanceLock);
 
-    auto itr = g_instanceDic->find(mmapID);
-    if (itr != g_instanceDic->end()) {
-        MMKV *kv = itr->second;
+    if (auto kv = findInstance(mmapID)) {
 #    ifndef MMKV_DISABLE_CRYPT
         kv->checkReSetCryptKey(fd, metaFD, cryptKey);
 #    endif
         return kv;
     }
     auto kv = new MMKV(mmapID, fd, metaFD, cryptKey);
-    (*g_instanceDic)[mmapID] = kv;
+    registerInstance(mmapID, kv);
+    kv->m_lastAccessTick = ++g_accessTick;
+    if (g_memoryBudgetEnabled) {
+        evictIdleInstances(kv);
+    }
     return kv;
 }
 
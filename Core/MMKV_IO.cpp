@@ -23,6 +23,7 @@
 #include "CodedOutputData.h"
 #include "InterProcessLock.h"
 #include "MMBuffer.h"
+#include "MMKVFrozen.h"
 #include "MMKVLog.h"
 #include "MMKVMetaInfo.hpp"
 #include "MemoryFile.h"
@@ -34,10 +35,21 @@
 #include "aes/openssl/openssl_aes.h"
 #include "aes/openssl/openssl_md5.h"
 #include "crc32/Checksum.h"
+#include "lz4/LZ4Block.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_set>
 
 #ifdef MMKV_IOS
 #    include "MMKV_OSX.h"
@@ -57,12 +69,31 @@ using namespace std;
 using namespace mmkv;
 using KVHolderRet_t = std::pair<bool, KeyValueHolder>;
 extern ThreadLock *g_instanceLock;
-extern unordered_map<string, MMKV *> *g_instanceDic;
+extern atomic<bool> g_memoryBudgetEnabled;
+extern atomic<uint64_t> g_accessTick;
+
+#ifndef MMKV_APPLE
+// the expire reaper, see MMKV::startExpireReaper()
+static thread *g_reaperThread = nullptr;
+static mutex g_reaperMutex;
+static condition_variable g_reaperCondition;
+static bool g_reaperStopping = false;
+static atomic<bool> g_reaperRunning(false);
+#endif
 
 MMKV_NAMESPACE_BEGIN
 
 void MMKV::loadFromFile() {
+#ifndef MMKV_APPLE
+    if (isFrozen()) {
+        loadFrozenFile();
+        return;
+    }
+#endif
     loadMetaInfoAndCheck();
+#ifndef MMKV_APPLE
+    m_hasBlobs = !m_crypter && isFileExist(blobDirWithKVPath(m_path));
+#endif
 #ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
         if (m_metaInfo->m_version >= MMKVVersionRandomIV) {
@@ -88,6 +119,7 @@ void MMKV::loadFromFile() {
             MMKVInfo("loading [%s] with crc %u sequence %u version %u", m_mmapID.c_str(), m_metaInfo->m_crcDigest,
                      m_metaInfo->m_sequence, m_metaInfo->m_version);
             MMBuffer inputBuffer(ptr + Fixed32Size, m_actualSize, MMBufferNoCopy);
+            invalidateIndexes();
             if (m_crypter) {
                 clearDictionary(m_dicCrypt);
             } else {
@@ -109,7 +141,18 @@ void MMKV::loadFromFile() {
                 } else
 #endif
                 {
-                    MiniPBCoder::decodeMap(*m_dic, inputBuffer);
+#ifndef MMKV_APPLE
+                    // only decode what's appended after the snapshot
+                    auto position = loadFromSnapshot();
+                    if (position > 0) {
+                        if (position < m_actualSize) {
+                            MiniPBCoder::decodeMap(*m_dic, inputBuffer, position);
+                        }
+                    } else
+#endif
+                    {
+                        MiniPBCoder::decodeMap(*m_dic, inputBuffer);
+                    }
                 }
             }
             m_output = new CodedOutputData(ptr + Fixed32Size, m_file->getFileSize() - Fixed32Size);
@@ -146,6 +189,12 @@ void MMKV::partialLoadFromFile() {
         return;
     }
     m_metaInfo->read(m_metaFile->getMemory());
+#ifndef MMKV_APPLE
+    // another process may have written the first blob
+    if (!m_hasBlobs && !m_crypter) {
+        m_hasBlobs = isFileExist(blobDirWithKVPath(m_path));
+    }
+#endif
 
     size_t oldActualSize = m_actualSize;
     m_actualSize = readActualSize();
@@ -163,6 +212,7 @@ void MMKV::partialLoadFromFile() {
                 m_crcDigest = (uint32_t) CRC32(m_crcDigest, basePtr + position, (z_size_t) addedSize);
                 if (m_crcDigest == m_metaInfo->m_crcDigest) {
                     MMBuffer inputBuffer(basePtr, m_actualSize, MMBufferNoCopy);
+                    invalidateIndexes();
 #ifndef MMKV_DISABLE_CRYPT
                     if (m_crypter) {
                         MiniPBCoder::greedyDecodeMap(*m_dicCrypt, inputBuffer, m_crypter, position);
@@ -300,14 +350,23 @@ void MMKV::checkDataValid(bool &loadFromFile, bool &needFullWriteback) {
 }
 
 void MMKV::checkLoadData() {
+    if (mmkv_unlikely(g_memoryBudgetEnabled)) {
+        m_lastAccessTick = ++g_accessTick;
+    }
     if (m_needLoadFromFile) {
         SCOPED_LOCK(m_sharedProcessLock);
 
         m_needLoadFromFile = false;
         loadFromFile();
+        // never wait for g_instanceLock while holding m_lock
+        if (mmkv_unlikely(g_memoryBudgetEnabled) && g_instanceLock->try_lock()) {
+            evictIdleInstances(this);
+            g_instanceLock->unlock();
+        }
         return;
     }
-    if (!isMultiProcess()) {
+    // a frozen file never changes
+    if (!isMultiProcess() || isFrozen()) {
         return;
     }
 
@@ -344,12 +403,23 @@ void MMKV::checkLoadData() {
 
 constexpr uint32_t ItemSizeHolderSize = 4;
 
+// the size of the record after full write back, where a key reference is replaced by the key itself
+static uint32_t writeBackKVSize(const MMKVMap::value_type &itr) {
+    auto &kvHolder = itr.second;
+#ifndef MMKV_APPLE
+    if (mmkv_unlikely(kvHolder.isKeyReference())) {
+        auto keyLength = static_cast<uint32_t>(itr.first.length());
+        return keyLength + pbRawVarint32Size(keyLength) + pbRawVarint32Size(kvHolder.valueSize) + kvHolder.valueSize;
+    }
+#endif
+    return kvHolder.computedKVSize + kvHolder.valueSize;
+}
+
 static pair<MMBuffer, size_t> prepareEncode(const MMKVMap &dic) {
     // make some room for placeholder
     size_t totalSize = ItemSizeHolderSize;
     for (auto &itr : dic) {
-        auto &kvHolder = itr.second;
-        totalSize += kvHolder.computedKVSize + kvHolder.valueSize;
+        totalSize += writeBackKVSize(itr);
     }
     return make_pair(MMBuffer(), totalSize);
 }
@@ -543,6 +613,11 @@ bool MMKV::writeActualSize(size_t size, uint32_t crcDigest, const void *iv, bool
 
 MMBuffer MMKV::getRawDataForKey(MMKVKey_t key) {
     checkLoadData();
+#ifndef MMKV_APPLE
+    if (m_frozen) {
+        return m_frozen->find(key);
+    }
+#endif
 #ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
         auto itr = m_dicCrypt->find(key);
@@ -564,6 +639,20 @@ MMBuffer MMKV::getRawDataForKey(MMKVKey_t key) {
 }
 
 mmkv::MMBuffer MMKV::getDataForKey(MMKVKey_t key) {
+    auto data = getStoredDataForKey(key);
+#ifndef MMKV_APPLE
+    if (mmkv_unlikely(m_hasBlobs) && isBlobReference(data)) {
+        return readBlob(data);
+    }
+#endif
+    return data;
+}
+
+mmkv::MMBuffer MMKV::getStoredDataForKey(MMKVKey_t key) {
+    MMBuffer pending;
+    if (mmkv_unlikely(pendingDataForKey(key, pending))) {
+        return pending;
+    }
     if (mmkv_unlikely(m_enableKeyExpire)) {
         return getDataWithoutMTimeForKey(key);
     }
@@ -583,9 +672,24 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
     if ((!isDataHolder && data.length() == 0) || isKeyEmpty(key)) {
         return false;
     }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_exclusiveProcessLock);
     checkLoadData();
+    dropPendingWrite(key);
+
+    // data might be moved later
+    uint32_t expireDate = ExpireNever;
+    if (mmkv_unlikely(m_enableKeyExpire) && data.length() >= Fixed32Size) {
+        memcpy(&expireDate, (const uint8_t *) data.getPtr() + data.length() - Fixed32Size, Fixed32Size);
+    }
+#ifndef MMKV_APPLE
+    // the blob of the old value, superseded once the new one is in place
+    MMBuffer oldBlob;
+#endif
 
 #ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
@@ -632,7 +736,8 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
                     itr->second = std::move(kvHolder);
                 } else {
                     // in case filterExpiredKeys() is triggered
-                    m_dicCrypt->emplace(key, std::move(kvHolder));
+                    auto r = m_dicCrypt->emplace(key, std::move(kvHolder));
+                    keyIndexInsert(r.first->first);
                     mmkv_retain_key(key);
                 }
             }
@@ -653,8 +758,10 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
                 if (r.second) {
                     memcpy(&(r.first->second.cryptStatus), &t_status, sizeof(t_status));
                 }
+                keyIndexInsert(r.first->first);
             } else {
-                m_dicCrypt->emplace(key, KeyValueHolderCrypt(std::move(data)));
+                auto r = m_dicCrypt->emplace(key, KeyValueHolderCrypt(std::move(data)));
+                keyIndexInsert(r.first->first);
             }
             mmkv_retain_key(key);
         }
@@ -663,23 +770,24 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
     {
         auto itr = m_dic->find(key);
         if (itr != m_dic->end()) {
+#ifndef MMKV_APPLE
+            oldBlob = blobReferenceForKey(key);
+#endif
             // compare data before appending to file
             if (isCompareBeforeSetEnabled()) {
                 auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
                 MMBuffer oldValueData = itr->second.toMMBuffer(basePtr);
                 if (isDataHolder) {
                     CodedInputData inputData(oldValueData.getPtr(), oldValueData.length());
-                    try {
-                        // read extra holder header bytes and to real MMBuffer
-                        oldValueData = CodedInputData::readRealData(oldValueData);
-                        if (oldValueData == data) {
+                    // read extra holder header bytes and to real MMBuffer
+                    MMBuffer realData;
+                    if (inputData.tryReadData(realData, false, true)) {
+                        if (realData == data) {
                             // MMKVInfo("[key] %s, set the same data", key.c_str());
                             return true;
                         }
-                    } catch (std::exception &exception) {
-                        MMKVWarning("compareBeforeSet exception: %s", exception.what());
-                    } catch (...) {
-                        MMKVWarning("compareBeforeSet fail");
+                    } else {
+                        MMKVWarning("compareBeforeSet fail: %s", inputData.lastError());
                     }
                 } else {
                     if (oldValueData == data) {
@@ -711,14 +819,8 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
                 if (!ret.first) {
                     return false;
                 }
-                itr = m_dic->find(key);
-                if (itr != m_dic->end()) {
-                    itr->second = std::move(ret.second);
-                } else {
-                    // in case filterExpiredKeys() is triggered
-                    m_dic->emplace(key, std::move(ret.second));
-                    mmkv_retain_key(key);
-                }
+                // in case filterExpiredKeys() is triggered
+                updateDictionary(key, std::move(ret.second));
             }
         } else {
             bool needOverride = !isMultiProcess() && m_dic->empty() && m_actualSize > 0;
@@ -731,14 +833,190 @@ bool MMKV::setDataForKey(MMBuffer &&data, MMKVKey_t key, bool isDataHolder) {
             if (!ret.first) {
                 return false;
             }
-            m_dic->emplace(key, std::move(ret.second));
+            auto r = m_dic->emplace(key, std::move(ret.second));
+            keyIndexInsert(r.first->first);
             mmkv_retain_key(key);
         }
     }
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        updateExpireIndex(key, expireDate);
+    }
+#ifndef MMKV_APPLE
+    didSetDataForKey(oldBlob);
+#else
     m_hasFullWriteback = false;
+#endif
     return true;
 }
 
+// the record of key is appended, the dictionary is searched again as appending might have rewritten it
+void MMKV::updateDictionary(MMKVKey_t key, KeyValueHolder &&kvHolder) {
+    auto itr = m_dic->find(key);
+    if (itr != m_dic->end()) {
+        itr->second = std::move(kvHolder);
+    } else {
+        auto r = m_dic->emplace(key, std::move(kvHolder));
+        keyIndexInsert(r.first->first);
+        mmkv_retain_key(key);
+    }
+}
+
+#ifndef MMKV_APPLE
+
+constexpr size_t MaxKeyReferenceSize = 5;
+
+// the key length field of a record referring to the key of kvHolder, 0 if it's no shorter than the key
+static size_t encodeKeyReference(const KeyValueHolder &kvHolder, uint8_t *ptr) {
+    // decoders read it as an int32
+    if (kvHolder.offset > static_cast<uint32_t>(INT32_MAX) - KeyValueHolder::KeyReferenceBase) {
+        return 0;
+    }
+    auto keyReference = KeyValueHolder::KeyReferenceBase + kvHolder.offset;
+    size_t size = pbRawVarint32Size(keyReference);
+    if (size >= kvHolder.keyFieldSize()) {
+        return 0;
+    }
+    CodedOutputData output(ptr, size);
+    output.writeRawVarint32(static_cast<int32_t>(keyReference));
+    return size;
+}
+
+// turn the key field copied from kvHolder into a reference to it when that's shorter, a key reference is kept as is
+static void referToKey(const KeyValueHolder &kvHolder, uint8_t *keyReference, MMBuffer &keyData, uint32_t &keyLength) {
+    if (kvHolder.isKeyReference()) {
+        return;
+    }
+    auto referenceSize = encodeKeyReference(kvHolder, keyReference);
+    if (referenceSize > 0) {
+        keyData = MMBuffer(keyReference, referenceSize, MMBufferNoCopy);
+        keyLength = 0;
+    }
+}
+
+// the file is rewritten from the beginning instead of appended to, see setDataForKey()
+template <typename T>
+static bool needsOverride(const T &dic, std::string_view key, bool multiProcess, size_t actualSize) {
+    if (multiProcess) {
+        return false;
+    }
+    if (dic.find(key) != dic.end()) {
+        return dic.size() == 1;
+    }
+    return dic.empty() && actualSize > 0;
+}
+
+bool MMKV::setEncodedDataForKey(const ValueEncoder &encoder, MMKVKey_t key) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    // overriding, expiring & comparing are done on a MMBuffer
+    // so is encrypting, no plaintext is ever written into the file, not even for a moment
+    bool inPlace = !m_enableKeyExpire && !isCompareBeforeSetEnabled() && !m_crypter &&
+                   !needsOverride(*m_dic, key, isMultiProcess(), m_actualSize);
+    if (inPlace) {
+        // the same bookkeeping as setDataForKey()
+        dropPendingWrite(key);
+        auto oldBlob = blobReferenceForKey(key);
+        auto ret = doAppendDataWithKey(encoder, key);
+        if (!ret.first) {
+            return false;
+        }
+        // ensureMemorySize() might have rewritten the dictionary
+        updateDictionary(key, std::move(ret.second));
+        didSetDataForKey(oldBlob);
+        return true;
+    }
+
+    MMBuffer data;
+    auto size = encoder([&data](size_t compiledSize) -> void * {
+        data = MMBuffer(compiledSize);
+        return data.getPtr();
+    });
+    if (size == 0) {
+        return false;
+    }
+    return setDataForKey(std::move(data), key);
+}
+
+KVHolderRet_t MMKV::doAppendDataWithKey(const ValueEncoder &encoder, MMKVKey_t key) {
+    auto keyData = MMBuffer((void *) key.data(), key.size(), MMBufferNoCopy);
+    auto keyLength = static_cast<uint32_t>(keyData.length());
+    size_t keyFieldSize = keyLength + pbRawVarint32Size(keyLength);
+    uint8_t keyReference[MaxKeyReferenceSize];
+    uint32_t valueLength = 0;
+    size_t size = 0;
+    bool headerWritten = false;
+
+    SCOPED_LOCK(m_exclusiveProcessLock);
+
+    auto reserve = [&](size_t encodedSize) -> void * {
+        valueLength = static_cast<uint32_t>(encodedSize);
+        // refer to the key of the record being overwritten like appendDataWithKey() does
+        // ensureMemorySize() might move that record & replace a key reference with the key, check again in that case
+        const KeyValueHolder *kvHolder = nullptr;
+        size_t maxKeyFieldSize;
+        do {
+            if (m_enableKeyReference) {
+                auto itr = m_dic->find(key);
+                kvHolder = (itr != m_dic->end()) ? &itr->second : nullptr;
+            }
+            maxKeyFieldSize = kvHolder ? kvHolder->keyFieldSize() : keyFieldSize;
+            size = maxKeyFieldSize + valueLength + pbRawVarint32Size(valueLength);
+            if (!ensureMemorySize(size) || !isFileValid()) {
+                return nullptr;
+            }
+        } while (kvHolder && maxKeyFieldSize != kvHolder->keyFieldSize());
+        if (kvHolder) {
+            auto basePtr = (uint8_t *) m_file->getMemory() + Fixed32Size;
+            keyData = MMBuffer(basePtr + kvHolder->offset, maxKeyFieldSize, MMBufferNoCopy);
+            keyLength = kvHolder->keySize;
+            referToKey(*kvHolder, keyReference, keyData, keyLength);
+            keyFieldSize = keyData.length();
+            size = keyFieldSize + valueLength + pbRawVarint32Size(valueLength);
+        }
+        if (kvHolder) {
+            m_output->writeRawData(keyData);
+        } else {
+            m_output->writeData(keyData);
+        }
+        m_output->writeRawVarint32((int32_t) valueLength);
+        headerWritten = true;
+        return m_output->curWritePointer();
+    };
+    size_t written = 0;
+    try {
+        written = encoder(reserve);
+    } catch (std::exception &e) {
+        MMKVError("%s", e.what());
+    } catch (...) {
+        MMKVError("append fail");
+    }
+    if (written == 0 || written != valueLength) {
+        if (headerWritten) {
+            m_output->setPosition(m_actualSize);
+        }
+        return make_pair(false, KeyValueHolder());
+    }
+    m_output->seek(valueLength);
+
+    auto offset = static_cast<uint32_t>(m_actualSize);
+    auto ptr = (uint8_t *) m_file->getMemory() + Fixed32Size + m_actualSize;
+    m_actualSize += size;
+    updateCRCDigest(ptr, size);
+
+    return make_pair(true, KeyValueHolder(keyLength, static_cast<uint32_t>(keyFieldSize), valueLength, offset));
+}
+
+#endif // !MMKV_APPLE
+
 template <typename T>
 static void eraseHelper(T& container, std::string_view key) {
     auto itr = container.find(key);
@@ -751,6 +1029,7 @@ bool MMKV::removeDataForKey(MMKVKey_t key) {
     if (isKeyEmpty(key)) {
         return false;
     }
+    dropPendingWrite(key);
 #ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
         auto itr = m_dicCrypt->find(key);
@@ -772,13 +1051,19 @@ bool MMKV::removeDataForKey(MMKVKey_t key) {
                 [oldKey release];
             }
 #    else
+            // the elements go with the list
+            auto itemKeys = listItemKeys(key, itr->second);
             auto ret = appendDataWithKey(nan, key);
             if (ret.first) {
+                eraseKeyFromIndexes(key);
                 if (mmkv_unlikely(m_enableKeyExpire)) {
                     eraseHelper(*m_dicCrypt, key);
                 } else {
                     m_dicCrypt->erase(itr);
                 }
+                for (const auto &itemKey : itemKeys) {
+                    removeDataForKey(itemKey);
+                }
             }
 #    endif
             return ret.first;
@@ -789,6 +1074,11 @@ bool MMKV::removeDataForKey(MMKVKey_t key) {
         auto itr = m_dic->find(key);
         if (itr != m_dic->end()) {
             m_hasFullWriteback = false;
+#ifndef MMKV_APPLE
+            auto oldBlob = blobReferenceForKey(key);
+            // the elements go with the list
+            auto itemKeys = listItemKeys(key, itr->second);
+#endif
             static MMBuffer nan;
             auto ret = mmkv_likely(!m_enableKeyExpire) ? appendDataWithKey(nan, itr->second) : appendDataWithKey(nan, key);
             if (ret.first) {
@@ -804,12 +1094,19 @@ bool MMKV::removeDataForKey(MMKVKey_t key) {
                 m_dic->erase(itr);
                 [oldKey release];
 #else
+                eraseKeyFromIndexes(key);
                 if (mmkv_unlikely(m_enableKeyExpire)) {
                     // filterExpiredKeys() may invalid itr
                     eraseHelper(*m_dic, key);
                 } else {
                     m_dic->erase(itr);
                 }
+                if (mmkv_unlikely(oldBlob.length() > 0)) {
+                    supersedeBlob(oldBlob);
+                }
+                for (const auto &itemKey : itemKeys) {
+                    removeDataForKey(itemKey);
+                }
 #endif
             }
             return ret.first;
@@ -819,6 +1116,192 @@ bool MMKV::removeDataForKey(MMKVKey_t key) {
     return false;
 }
 
+// ---- counters ----
+
+// a varint64 padded to its max length, so any value can be rewritten in place
+constexpr size_t FixedWidthVarint64Size = 10;
+
+// still readable by CodedInputData::readInt64()
+static void writeFixedWidthVarint64(uint8_t *ptr, uint64_t value) {
+    for (size_t i = 0; i < FixedWidthVarint64Size - 1; i++) {
+        ptr[i] = static_cast<uint8_t>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    ptr[FixedWidthVarint64Size - 1] = static_cast<uint8_t>(value & 0x7f);
+}
+
+static size_t counterSize(int64_t) {
+    return FixedWidthVarint64Size;
+}
+static size_t counterSize(uint64_t) {
+    return FixedWidthVarint64Size;
+}
+static size_t counterSize(double) {
+    return pbDoubleSize();
+}
+
+static bool readCounter(CodedInputData &input, int64_t &value) {
+    return input.tryReadInt64(value);
+}
+static bool readCounter(CodedInputData &input, uint64_t &value) {
+    return input.tryReadUInt64(value);
+}
+static bool readCounter(CodedInputData &input, double &value) {
+    return input.tryReadDouble(value);
+}
+
+static void writeCounter(uint8_t *ptr, int64_t value) {
+    writeFixedWidthVarint64(ptr, static_cast<uint64_t>(value));
+}
+static void writeCounter(uint8_t *ptr, uint64_t value) {
+    writeFixedWidthVarint64(ptr, value);
+}
+static void writeCounter(uint8_t *ptr, double value) {
+    CodedOutputData output(ptr, pbDoubleSize());
+    output.writeDouble(value);
+}
+
+// wrap around on overflow instead of UB
+static int64_t addCounter(int64_t value, int64_t delta) {
+    return static_cast<int64_t>(static_cast<uint64_t>(value) + static_cast<uint64_t>(delta));
+}
+static uint64_t addCounter(uint64_t value, uint64_t delta) {
+    return value + delta;
+}
+static double addCounter(double value, double delta) {
+    return value + delta;
+}
+
+constexpr uint32_t CRC32Polynomial = 0xedb88320;
+
+// a * b modulo the crc32 polynomial, in crc32's reflected bit order
+static uint32_t crc32MultiplyModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32Polynomial : b >> 1;
+    }
+    return p;
+}
+
+// the crc register after feeding it count zero bytes, in O(log(count))
+static uint32_t crc32FeedZeros(uint32_t crc, size_t count) {
+    // x^(8 * 2^k) mod P
+    static const auto powers = [] {
+        array<uint32_t, 64> table{};
+        uint32_t p = 1u << 23; // x^8
+        for (auto &item : table) {
+            item = p;
+            p = crc32MultiplyModP(p, p);
+        }
+        return table;
+    }();
+    for (size_t k = 0; count; count >>= 1, k++) {
+        if (count & 1) {
+            crc = crc32MultiplyModP(powers[k], crc);
+        }
+    }
+    return crc;
+}
+
+// crc32 is linear: patching len bytes followed by tailSize bytes flips the digest by the crc of the xor-ed bytes
+static uint32_t crc32Patch(uint32_t crc, const uint8_t *oldBytes, const uint8_t *newBytes, size_t len, size_t tailSize) {
+    uint32_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff ^= static_cast<uint8_t>(oldBytes[i] ^ newBytes[i]);
+        for (int bit = 0; bit < 8; bit++) {
+            diff = (diff & 1) ? (diff >> 1) ^ CRC32Polynomial : diff >> 1;
+        }
+    }
+    return crc ^ crc32FeedZeros(diff, tailSize);
+}
+
+template <typename T>
+bool MMKV::incrementValue(MMKVKey_t key, T delta, T *newValue) {
+    if (isKeyEmpty(key)) {
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+
+    T value = 0;
+    auto data = getDataForKey(key);
+    // the in place rewrite below doesn't go through setDataForKey()
+    dropPendingWrite(key);
+    if (data.length() > 0) {
+        CodedInputData input(data.getPtr(), data.length());
+        if (!readCounter(input, value)) {
+            MMKVError("%s", input.lastError());
+            value = 0;
+        }
+    }
+    value = addCounter(value, delta);
+    if (newValue) {
+        *newValue = value;
+    }
+
+    auto size = counterSize(value);
+    uint8_t bytes[FixedWidthVarint64Size + Fixed32Size];
+    writeCounter(bytes, value);
+    uint32_t expireDate = ExpireNever;
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        // same as set(value, key)
+        expireDate = (m_expiredInSeconds != ExpireNever) ? getCurrentTimeInSecond() + m_expiredInSeconds : ExpireNever;
+        memcpy(bytes + size, &expireDate, Fixed32Size);
+        size += Fixed32Size;
+    }
+
+    // rewrite the value in place if it has the same width, other processes won't notice an unchanged file size
+    // never inside the last confirmed data, which crash recovery checks against its crc digest
+    bool canRewriteInPlace = !isMultiProcess();
+#ifndef MMKV_DISABLE_CRYPT
+    canRewriteInPlace = canRewriteInPlace && !m_crypter;
+#endif
+    if (canRewriteInPlace) {
+        auto itr = m_dic->find(key);
+        if (itr != m_dic->end() && itr->second.valueSize == size &&
+            itr->second.offset >= m_metaInfo->m_lastConfirmedMetaInfo.lastActualSize) {
+            auto &kvHolder = itr->second;
+            auto valueOffset = kvHolder.offset + kvHolder.computedKVSize;
+            auto ptr = (uint8_t *) m_file->getMemory() + Fixed32Size + valueOffset;
+            auto tailSize = m_actualSize - (valueOffset + size);
+            auto crcDigest = crc32Patch(m_crcDigest, ptr, bytes, size, tailSize);
+            memcpy(ptr, bytes, size);
+            writeActualSize(m_actualSize, crcDigest, nullptr, KeepSequence);
+            if (mmkv_unlikely(m_enableKeyExpire)) {
+                updateExpireIndex(key, expireDate);
+            }
+            return true;
+        }
+    }
+
+    MMBuffer buffer(bytes, size);
+    return setDataForKey(std::move(buffer), key);
+}
+
+bool MMKV::incrementInt64(MMKVKey_t key, int64_t delta, int64_t *newValue) {
+    return incrementValue(key, delta, newValue);
+}
+
+bool MMKV::incrementUInt64(MMKVKey_t key, uint64_t delta, uint64_t *newValue) {
+    return incrementValue(key, delta, newValue);
+}
+
+bool MMKV::incrementDouble(MMKVKey_t key, double delta, double *newValue) {
+    return incrementValue(key, delta, newValue);
+}
+
 KVHolderRet_t
 MMKV::doAppendDataWithKey(const MMBuffer &data, const MMBuffer &keyData, bool isDataHolder, uint32_t originKeyLength) {
     auto isKeyEncoded = (originKeyLength < keyData.length());
@@ -828,9 +1311,9 @@ MMKV::doAppendDataWithKey(const MMBuffer &data, const MMBuffer &keyData, bool is
         valueLength += pbRawVarint32Size(valueLength);
     }
     // size needed to encode the key
-    size_t size = isKeyEncoded ? keyLength : (keyLength + pbRawVarint32Size(keyLength));
+    auto keyFieldSize = isKeyEncoded ? keyLength : (keyLength + pbRawVarint32Size(keyLength));
     // size needed to encode the value
-    size += valueLength + pbRawVarint32Size(valueLength);
+    size_t size = keyFieldSize + valueLength + pbRawVarint32Size(valueLength);
 
     SCOPED_LOCK(m_exclusiveProcessLock);
 
@@ -880,7 +1363,7 @@ MMKV::doAppendDataWithKey(const MMBuffer &data, const MMBuffer &keyData, bool is
     m_actualSize += size;
     updateCRCDigest(ptr, size);
 
-    return make_pair(true, KeyValueHolder(originKeyLength, valueLength, offset));
+    return make_pair(true, KeyValueHolder(originKeyLength, keyFieldSize, valueLength, offset));
 }
 
 KVHolderRet_t MMKV::doOverrideDataWithKey(const MMBuffer &data,
@@ -894,9 +1377,9 @@ KVHolderRet_t MMKV::doOverrideDataWithKey(const MMBuffer &data,
         valueLength += pbRawVarint32Size(valueLength);
     }
     // size needed to encode the key
-    size_t size = isKeyEncoded ? keyLength : (keyLength + pbRawVarint32Size(keyLength));
+    auto keyFieldSize = isKeyEncoded ? keyLength : (keyLength + pbRawVarint32Size(keyLength));
     // size needed to encode the value
-    size += valueLength + pbRawVarint32Size(valueLength);
+    size_t size = keyFieldSize + valueLength + pbRawVarint32Size(valueLength);
 
     if (!checkSizeForOverride(size)) {
         return doAppendDataWithKey(data, keyData, isDataHolder, originKeyLength);
@@ -961,7 +1444,7 @@ KVHolderRet_t MMKV::doOverrideDataWithKey(const MMBuffer &data,
 #endif
     recalculateCRCDigestOnly();
 
-    return make_pair(true, KeyValueHolder(originKeyLength, valueLength, offset));
+    return make_pair(true, KeyValueHolder(originKeyLength, keyFieldSize, valueLength, offset));
 }
 
 bool MMKV::checkSizeForOverride(size_t size) {
@@ -999,15 +1482,17 @@ KVHolderRet_t MMKV::overrideDataWithKey(const MMBuffer &data, MMKVKey_t key, boo
     return doOverrideDataWithKey(data, keyData, isDataHolder, static_cast<uint32_t>(keyData.length()));
 }
 
+
 KVHolderRet_t MMKV::appendDataWithKey(const MMBuffer &data, const KeyValueHolder &kvHolder, bool isDataHolder) {
     SCOPED_LOCK(m_exclusiveProcessLock);
 
-    uint32_t keyLength = kvHolder.keySize;
-    // size needed to encode the key
-    size_t rawKeySize = keyLength + pbRawVarint32Size(keyLength);
+    // size needed to encode the key, or the key reference
+    size_t rawKeySize;
 
     // ensureMemorySize() might change kvHolder.offset, so have to do it early
-    {
+    // a full write back also replaces a key reference with the key, check again in that case
+    do {
+        rawKeySize = kvHolder.keyFieldSize();
         auto valueLength = static_cast<uint32_t>(data.length());
         if (isDataHolder) {
             valueLength += pbRawVarint32Size(valueLength);
@@ -1017,9 +1502,17 @@ KVHolderRet_t MMKV::appendDataWithKey(const MMBuffer &data, const KeyValueHolder
         if (!hasEnoughSize) {
             return make_pair(false, KeyValueHolder());
         }
-    }
+    } while (rawKeySize != kvHolder.keyFieldSize());
+    uint32_t keyLength = kvHolder.keySize;
     auto basePtr = (uint8_t *) m_file->getMemory() + Fixed32Size;
     MMBuffer keyData(basePtr + kvHolder.offset, rawKeySize, MMBufferNoCopy);
+#ifndef MMKV_APPLE
+    // refer to the key of the record being overwritten, a key reference is copied as is
+    uint8_t keyReference[MaxKeyReferenceSize];
+    if (m_enableKeyReference) {
+        referToKey(kvHolder, keyReference, keyData, keyLength);
+    }
+#endif
 
     return doAppendDataWithKey(data, keyData, isDataHolder, keyLength);
 }
@@ -1029,6 +1522,11 @@ KVHolderRet_t MMKV::overrideDataWithKey(const MMBuffer &data, const KeyValueHold
     // we don't not support override in multi-process mode
     // SCOPED_LOCK(m_exclusiveProcessLock);
 
+    // the key it refers to is about to be overridden
+    if (kvHolder.isKeyReference()) {
+        return appendDataWithKey(data, kvHolder, isDataHolder);
+    }
+
     uint32_t keyLength = kvHolder.keySize;
     // size needed to encode the key
     size_t rawKeySize = keyLength + pbRawVarint32Size(keyLength);
@@ -1082,15 +1580,24 @@ bool MMKV::fullWriteback(AESCrypt *newCrypter, bool onlyWhileExpire) {
     auto sizeOfDic = preparedData.second;
     if (sizeOfDic > 0) {
         auto fileSize = m_file->getFileSize();
+        bool ret;
         if (sizeOfDic + Fixed32Size <= fileSize) {
-            return doFullWriteBack(std::move(preparedData), newCrypter);
+            ret = doFullWriteBack(std::move(preparedData), newCrypter);
         } else {
             assert(0);
             assert(newCrypter == nullptr);
             // expandAndWriteBack() will extend file & full rewrite, no need to write back again
             auto newSize = sizeOfDic + Fixed32Size - fileSize;
-            return expandAndWriteBack(newSize, std::move(preparedData));
+            ret = expandAndWriteBack(newSize, std::move(preparedData));
+        }
+#ifndef MMKV_APPLE
+        // not on expanding by appending, whose blob isn't referenced yet
+        // nor on encrypting, the values can't be parsed for blob references
+        if (ret && mmkv_unlikely(m_hasBlobs) && !newCrypter) {
+            removeUnreferencedBlobs();
         }
+#endif
+        return ret;
     }
     return false;
 }
@@ -1104,38 +1611,59 @@ memmoveDictionary(MMKVMap &dic, CodedOutputData *output, uint8_t *ptr, AESCrypt
     // reuse what's already in the file
     if (!dic.empty()) {
         // sort by offset
-        vector<KeyValueHolder *> vec;
+        vector<MMKVMap::value_type *> vec;
         vec.reserve(dic.size());
         for (auto &itr : dic) {
-            vec.push_back(&itr.second);
+            vec.push_back(&itr);
         }
-        sort(vec.begin(), vec.end(), [](const auto &left, const auto &right) { return left->offset < right->offset; });
+        sort(vec.begin(), vec.end(),
+             [](const auto &left, const auto &right) { return left->second.offset < right->second.offset; });
 
         // merge nearby items to make memmove quicker
-        vector<pair<uint32_t, uint32_t>> dataSections; // pair(offset, size)
-        dataSections.emplace_back(vec.front()->offset, vec.front()->computedKVSize + vec.front()->valueSize);
-        for (size_t index = 1, total = vec.size(); index < total; index++) {
-            auto kvHolder = vec[index];
-            auto &lastSection = dataSections.back();
-            if (kvHolder->offset == lastSection.first + lastSection.second) {
-                lastSection.second += kvHolder->computedKVSize + kvHolder->valueSize;
-            } else {
-                dataSections.emplace_back(kvHolder->offset, kvHolder->computedKVSize + kvHolder->valueSize);
-            }
-        }
-        // do the move
         auto basePtr = ptr + Fixed32Size;
-        for (auto &section : dataSections) {
+        pair<uint32_t, uint32_t> section(0, 0); // pair(offset, size)
+        auto moveSection = [&] {
             // memmove() should handle this well: src == dst
             memmove(writePtr, basePtr + section.first, section.second);
             writePtr += section.second;
+            section.second = 0;
+        };
+        for (auto itr : vec) {
+            auto &kvHolder = itr->second;
+#ifndef MMKV_APPLE
+            // write the key instead of its reference, the record it refers to is gone
+            // it's safe in place, that record is an older one of the same key, not smaller than what's added here
+            if (mmkv_unlikely(kvHolder.isKeyReference())) {
+                moveSection();
+                auto &key = itr->first;
+                auto keyLength = static_cast<uint32_t>(key.length());
+                auto keyFieldSize = keyLength + pbRawVarint32Size(keyLength);
+                auto valueFieldSize = pbRawVarint32Size(kvHolder.valueSize) + kvHolder.valueSize;
+                memmove(writePtr + keyFieldSize, basePtr + kvHolder.offset + kvHolder.keyFieldSize(), valueFieldSize);
+                CodedOutputData keyOutput(writePtr, keyFieldSize);
+                keyOutput.writeData(MMBuffer((void *) key.data(), keyLength, MMBufferNoCopy));
+                writePtr += keyFieldSize + valueFieldSize;
+                if (!encrypter) {
+                    kvHolder = KeyValueHolder(keyLength, kvHolder.valueSize, kvHolder.offset);
+                }
+                continue;
+            }
+#endif
+            if (section.second > 0 && kvHolder.offset == section.first + section.second) {
+                section.second += kvHolder.computedKVSize + kvHolder.valueSize;
+            } else {
+                moveSection();
+                section = make_pair(kvHolder.offset, kvHolder.computedKVSize + kvHolder.valueSize);
+            }
         }
+        moveSection();
         // update offset
         if (!encrypter) {
             auto offset = ItemSizeHolderSize;
-            for (auto kvHolder : vec) {
-                kvHolder->offset = offset;
-                offset += kvHolder->computedKVSize + kvHolder->valueSize;
+            for (auto itr : vec) {
+                auto &kvHolder = itr->second;
+                kvHolder.offset = offset;
+                offset += kvHolder.computedKVSize + kvHolder.valueSize;
             }
         }
     }
@@ -1277,6 +1805,7 @@ bool MMKV::doFullWriteBack(pair<MMBuffer, size_t> prepared, AESCrypt *newCrypter
 
     delete m_output;
     m_output = new CodedOutputData(ptr + Fixed32Size, m_file->getFileSize() - Fixed32Size);
+    bool isMemmovedDictionary = false;
     if (m_crypter) {
         auto decrypter = m_crypter;
         memmoveDictionary(*m_dicCrypt, m_output, ptr, decrypter, encrypter, prepared);
@@ -1288,6 +1817,7 @@ bool MMKV::doFullWriteBack(pair<MMBuffer, size_t> prepared, AESCrypt *newCrypter
         }
     } else {
         memmoveDictionary(*m_dic, m_output, ptr, encrypter, totalSize);
+        isMemmovedDictionary = true;
     }
 
     m_actualSize = totalSize;
@@ -1297,6 +1827,11 @@ bool MMKV::doFullWriteBack(pair<MMBuffer, size_t> prepared, AESCrypt *newCrypter
         recalculateCRCDigestWithIV(nullptr);
     }
     m_hasFullWriteback = true;
+#    ifndef MMKV_APPLE
+    if (isMemmovedDictionary && !encrypter) {
+        writeSnapshot();
+    }
+#    endif
     // make sure lastConfirmedMetaInfo is saved if needed
     if (needSync) {
         sync(MMKV_SYNC);
@@ -1318,17 +1853,24 @@ bool MMKV::doFullWriteBack(pair<MMBuffer, size_t> prepared, AESCrypt *, bool nee
 
     delete m_output;
     m_output = new CodedOutputData(ptr + Fixed32Size, m_file->getFileSize() - Fixed32Size);
+    bool isMemmovedDictionary = false;
     if (prepared.first.length() != 0) {
         auto &preparedData = prepared.first;
         fullWriteBackWholeData(std::move(preparedData), totalSize, m_output);
     } else {
         constexpr AESCrypt *encrypter = nullptr;
         memmoveDictionary(*m_dic, m_output, ptr, encrypter, totalSize);
+        isMemmovedDictionary = true;
     }
 
     m_actualSize = totalSize;
     recalculateCRCDigestWithIV(nullptr);
     m_hasFullWriteback = true;
+#    ifndef MMKV_APPLE
+    if (isMemmovedDictionary) {
+        writeSnapshot();
+    }
+#    endif
     // make sure lastConfirmedMetaInfo is saved if needed
     if (needSync) {
         sync(MMKV_SYNC);
@@ -1337,30 +1879,202 @@ bool MMKV::doFullWriteBack(pair<MMBuffer, size_t> prepared, AESCrypt *, bool nee
 }
 #endif // MMKV_DISABLE_CRYPT
 
-#ifndef MMKV_DISABLE_CRYPT
-bool MMKV::reKey(const string &cryptKey) {
-    SCOPED_LOCK(m_lock);
-    SCOPED_LOCK(m_exclusiveProcessLock);
-    checkLoadData();
-    if (!isFileValid()) {
-        MMKVWarning("[%s] file not valid", m_mmapID.c_str());
-        return false;
+#ifndef MMKV_APPLE
+
+// ---- dictionary snapshot ----
+
+constexpr uint32_t SnapshotMagic = 0x53564B4D; // "MKVS"
+constexpr uint32_t SnapshotVersion = 1;
+// small files decode fast enough, not worth an extra file
+constexpr size_t SnapshotMinKeyCount = 1024;
+
+struct MMKVSnapshotHeader {
+    uint32_t m_magic = SnapshotMagic;
+    uint32_t m_version = SnapshotVersion;
+    // the meta info's sequence when the snapshot is taken
+    uint32_t m_sequence = 0;
+    // the snapshot covers [0, m_actualSize) of the file's data
+    uint32_t m_actualSize = 0;
+    uint32_t m_crcDigest = 0;
+    // m_count of KeyValueHolder follows, sorted by offset
+    uint32_t m_count = 0;
+    uint32_t m_holderCRCDigest = 0;
+    uint32_t m_reserved = 0;
+};
+
+// called right after a plain full write back, when every offset in m_dic is fresh
+void MMKV::writeSnapshot() {
+    if (m_crypter || isReadOnly()) {
+        return;
     }
-    if (isReadOnly()) {
-        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
-        return false;
+#    ifdef MMKV_ANDROID
+    if (m_file->m_fileType == MMFILE_TYPE_ASHMEM) {
+        return;
+    }
+#    endif
+    auto snapshotPath = snapshotPathWithKVPath(m_path);
+    auto count = m_dic->size();
+    if (count < SnapshotMinKeyCount) {
+        // don't leave a stale one behind
+        if (isFileExist(snapshotPath)) {
+#    ifndef MMKV_WIN32
+            ::unlink(snapshotPath.c_str());
+#    else
+            DeleteFile(snapshotPath.c_str());
+#    endif
+        }
+        return;
     }
 
-    bool ret = false;
-    if (m_crypter) {
-        if (cryptKey.length() > 0) {
-            string oldKey = this->cryptKey();
-            if (cryptKey == oldKey) {
-                return true;
-            } else {
-                // change encryption key
-                MMKVInfo("reKey with new aes key");
-                auto newCrypt = new AESCrypt(cryptKey.data(), cryptKey.length());
+    vector<const KeyValueHolder *> vec;
+    vec.reserve(count);
+    for (auto &itr : *m_dic) {
+        vec.push_back(&itr.second);
+    }
+    sort(vec.begin(), vec.end(), [](const auto &left, const auto &right) { return left->offset < right->offset; });
+
+    auto holderSize = count * sizeof(KeyValueHolder);
+    auto snapshotSize = sizeof(MMKVSnapshotHeader) + holderSize;
+#    ifndef MMKV_ANDROID
+    MemoryFile file(snapshotPath, snapshotSize);
+#    else
+    MemoryFile file(snapshotPath, DEFAULT_MMAP_SIZE, MMFILE_TYPE_FILE, snapshotSize);
+#    endif
+    if (!file.isFileValid()) {
+        MMKVWarning("fail to open snapshot of [%s]", m_mmapID.c_str());
+        return;
+    }
+    auto roundSize = roundUp<size_t>(snapshotSize, DEFAULT_MMAP_SIZE);
+    if (file.getFileSize() != roundSize && !file.truncate(roundSize)) {
+        return;
+    }
+
+    auto ptr = (uint8_t *) file.getMemory();
+    // invalidate the header first, in case we crash halfway
+    memset(ptr, 0, sizeof(MMKVSnapshotHeader));
+    auto holderPtr = ptr + sizeof(MMKVSnapshotHeader);
+    for (auto kvHolder : vec) {
+        memcpy(holderPtr, kvHolder, sizeof(KeyValueHolder));
+        holderPtr += sizeof(KeyValueHolder);
+    }
+
+    MMKVSnapshotHeader header;
+    header.m_sequence = m_metaInfo->m_sequence;
+    header.m_actualSize = static_cast<uint32_t>(m_actualSize);
+    header.m_crcDigest = m_crcDigest;
+    header.m_count = static_cast<uint32_t>(count);
+    header.m_holderCRCDigest = static_cast<uint32_t>(CRC32(0, ptr + sizeof(MMKVSnapshotHeader), holderSize));
+    memcpy(ptr, &header, sizeof(header));
+    file.msync(MMKV_ASYNC);
+
+    MMKVInfo("write snapshot of [%s] with %zu keys, sequence %u", m_mmapID.c_str(), count, header.m_sequence);
+}
+
+size_t MMKV::loadFromSnapshot() {
+    if (m_crypter) {
+        return 0;
+    }
+    auto snapshotPath = snapshotPathWithKVPath(m_path);
+    if (!isFileExist(snapshotPath)) {
+        return 0;
+    }
+#    ifndef MMKV_ANDROID
+    MemoryFile file(snapshotPath, 0, true);
+#    else
+    MemoryFile file(snapshotPath, DEFAULT_MMAP_SIZE, MMFILE_TYPE_FILE, 0, true);
+#    endif
+    if (!file.isFileValid() || file.getFileSize() < sizeof(MMKVSnapshotHeader)) {
+        return 0;
+    }
+    auto ptr = (const uint8_t *) file.getMemory();
+    MMKVSnapshotHeader header;
+    memcpy(&header, ptr, sizeof(header));
+    if (header.m_magic != SnapshotMagic || header.m_version != SnapshotVersion) {
+        return 0;
+    }
+    // the file might have been overridden or restored since then
+    if (header.m_sequence != m_metaInfo->m_sequence || header.m_actualSize > m_actualSize ||
+        header.m_actualSize < ItemSizeHolderSize) {
+        MMKVInfo("snapshot of [%s] outdated, sequence %u, actual size %u", m_mmapID.c_str(), header.m_sequence,
+                 header.m_actualSize);
+        return 0;
+    }
+    auto holderSize = static_cast<size_t>(header.m_count) * sizeof(KeyValueHolder);
+    if (sizeof(MMKVSnapshotHeader) + holderSize > file.getFileSize()) {
+        return 0;
+    }
+    auto holderPtr = ptr + sizeof(MMKVSnapshotHeader);
+    if (CRC32(0, holderPtr, holderSize) != header.m_holderCRCDigest) {
+        MMKVWarning("snapshot of [%s] corrupted", m_mmapID.c_str());
+        return 0;
+    }
+    auto basePtr = (const uint8_t *) m_file->getMemory() + Fixed32Size;
+    if (header.m_actualSize == m_actualSize) {
+        // checkDataValid() has already verified the whole data against the meta info
+        if (header.m_crcDigest != m_metaInfo->m_crcDigest) {
+            return 0;
+        }
+    } else if (CRC32(0, basePtr, header.m_actualSize) != header.m_crcDigest) {
+        MMKVInfo("snapshot of [%s] outdated, crc mismatch", m_mmapID.c_str());
+        return 0;
+    }
+
+    m_dic->reserve(header.m_count);
+    for (uint32_t index = 0; index < header.m_count; index++, holderPtr += sizeof(KeyValueHolder)) {
+        KeyValueHolder kvHolder;
+        memcpy(&kvHolder, holderPtr, sizeof(kvHolder));
+        if (kvHolder.offset < ItemSizeHolderSize ||
+            kvHolder.offset + kvHolder.computedKVSize + kvHolder.valueSize > header.m_actualSize) {
+            MMKVWarning("snapshot of [%s] has invalid offset %u", m_mmapID.c_str(), kvHolder.offset);
+            clearDictionary(m_dic);
+            return 0;
+        }
+        if (mmkv_unlikely(kvHolder.isKeyReference())) {
+            CodedInputData input(basePtr, header.m_actualSize);
+            string key;
+            KeyValueHolder keyHolder;
+            if (!input.trySeek(kvHolder.offset) || !input.tryReadString(keyHolder, key) || !keyHolder.isKeyReference()) {
+                MMKVWarning("snapshot of [%s] has invalid key reference %u", m_mmapID.c_str(), kvHolder.offset);
+                clearDictionary(m_dic);
+                return 0;
+            }
+            m_dic->emplace(std::move(key), kvHolder);
+            continue;
+        }
+        auto keyPtr = basePtr + kvHolder.offset + pbRawVarint32Size((uint32_t) kvHolder.keySize);
+        m_dic->emplace(string((const char *) keyPtr, kvHolder.keySize), kvHolder);
+    }
+    MMKVInfo("loaded snapshot of [%s] with %u keys, covering %u of %zu bytes", m_mmapID.c_str(), header.m_count,
+             header.m_actualSize, m_actualSize);
+    return header.m_actualSize;
+}
+
+#endif // !MMKV_APPLE
+
+#ifndef MMKV_DISABLE_CRYPT
+bool MMKV::reKey(const string &cryptKey) {
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
+    if (!isFileValid()) {
+        MMKVWarning("[%s] file not valid", m_mmapID.c_str());
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
+
+    bool ret = false;
+    if (m_crypter) {
+        if (cryptKey.length() > 0) {
+            string oldKey = this->cryptKey();
+            if (cryptKey == oldKey) {
+                return true;
+            } else {
+                // change encryption key
+                MMKVInfo("reKey with new aes key");
+                auto newCrypt = new AESCrypt(cryptKey.data(), cryptKey.length());
                 m_hasFullWriteback = false;
                 ret = fullWriteback(newCrypt);
                 if (ret) {
@@ -1385,6 +2099,18 @@ bool MMKV::reKey(const string &cryptKey) {
         }
     } else {
         if (cryptKey.length() > 0) {
+#ifndef MMKV_APPLE
+            // blob references are only resolved & swept in plain text, sweep the superseded ones now
+            if (mmkv_unlikely(m_hasBlobs)) {
+                m_hasFullWriteback = false;
+                fullWriteback();
+            }
+            if (mmkv_unlikely(m_hasBlobs || m_blobThreshold > 0)) {
+                MMKVWarning("can't encrypt [%s] with blob storage, disable it and set the large values again first",
+                            m_mmapID.c_str());
+                return false;
+            }
+#endif
             // transform plain text to encrypted text
             MMKVInfo("reKey to a aes key");
             m_hasFullWriteback = false;
@@ -1412,6 +2138,7 @@ bool MMKV::reKey(const string &cryptKey) {
 
 void MMKV::trim() {
     SCOPED_LOCK(m_lock);
+    applyPendingWrites();
     MMKVInfo("prepare to trim %s", m_mmapID.c_str());
 
     SCOPED_LOCK(m_exclusiveProcessLock);
@@ -1462,6 +2189,7 @@ void MMKV::clearAll(bool keepSpace) {
     MMKVInfo("cleaning all key-values from [%s]", m_mmapID.c_str());
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_exclusiveProcessLock);
+    discardPendingWrites();
 
     checkLoadData();
     if (!isFileValid()) {
@@ -1497,6 +2225,11 @@ void MMKV::clearAll(bool keepSpace) {
 
     clearMemoryCache(keepSpace);
     loadFromFile();
+#ifndef MMKV_APPLE
+    if (mmkv_unlikely(m_hasBlobs)) {
+        removeUnreferencedBlobs();
+    }
+#endif
 }
 
 bool MMKV::isFileValid(const string &mmapID, MMKVPath_t *relatePath) {
@@ -1543,6 +2276,15 @@ bool MMKV::isFileValid(const string &mmapID, MMKVPath_t *relatePath) {
     }
 }
 
+static void removeBlobDirectory(const MMKVPath_t &kvPath) {
+    auto blobDir = blobDirWithKVPath(kvPath);
+    if (!isFileExist(blobDir)) {
+        return;
+    }
+    walkInDir(blobDir, WalkFile, [](const MMKVPath_t &filePath, WalkType) { removeFile(filePath); });
+    removeDirectory(blobDir);
+}
+
 bool MMKV::removeStorage(const std::string &mmapID, MMKVPath_t *relatePath) {
     if (!g_instanceLock) {
         return false;
@@ -1567,6 +2309,7 @@ bool MMKV::removeStorage(const std::string &mmapID, MMKVPath_t *relatePath) {
     }
 
     MMKVInfo("remove storage [%s]", mmapID.c_str());
+    // keeps it from being opened again before the files are gone, lookups of opened instances only lock their shards
     SCOPED_LOCK(g_instanceLock);
 
     File crcFile(crcPath, OpenFlag::ReadOnly);
@@ -1577,19 +2320,23 @@ bool MMKV::removeStorage(const std::string &mmapID, MMKVPath_t *relatePath) {
     InterProcessLock lock(&fileLock, ExclusiveLockType);
     SCOPED_LOCK(&lock);
 
-    auto itr = g_instanceDic->find(mmapKey);
-    if (itr != g_instanceDic->end()) {
-        itr->second->close();
-        // itr is not valid after this
+    if (auto kv = findInstance(mmapKey)) {
+        // instances with handles alive keep working on the removed files, until the last handle is gone
+        kv->detachOrClose();
+        // kv is not valid after this
     }
 
+    auto snapshotPath = snapshotPathWithKVPath(kvPath);
 #ifndef MMKV_WIN32
     ::unlink(kvPath.c_str());
     ::unlink(crcPath.c_str());
+    ::unlink(snapshotPath.c_str());
 #else
     DeleteFile(kvPath.c_str());
     DeleteFile(crcPath.c_str());
+    DeleteFile(snapshotPath.c_str());
 #endif
+    removeBlobDirectory(kvPath);
 
     return true;
 }
@@ -1605,6 +2352,7 @@ bool MMKV::doFullWriteBack(MMKVVector &&vec) {
     auto preparedData = prepareEncode(std::move(vec));
 
     // must clean before write-back and after prepareEncode()
+    invalidateIndexes();
     if (m_crypter) {
         clearDictionary(m_dicCrypt);
     } else {
@@ -1634,6 +2382,11 @@ bool MMKV::enableAutoKeyExpire(uint32_t expiredInSeconds) {
         MMKVWarning("[%s] file not valid", m_mmapID.c_str());
         return false;
     }
+    // values of a frozen file carry no expire date
+    if (isFrozen()) {
+        MMKVWarning("[%s] file frozen", m_mmapID.c_str());
+        return false;
+    }
 
     if (m_enableCompareBeforeSet) {
         MMKVError("enableCompareBeforeSet will be invalid when Expiration is on");
@@ -1793,6 +2546,12 @@ mmkv::MMBuffer MMKV::getDataWithoutMTimeForKey(MMKVKey_t key) {
         auto ptr = (const uint8_t *) raw.getPtr() + newLength;
         auto time = *(const uint32_t *) ptr;
         if (time != ExpireNever && time <= getCurrentTimeInSecond()) {
+#ifndef MMKV_APPLE
+            // leave it to the reaper, keep reading free of writing
+            if (g_reaperRunning) {
+                return MMBuffer();
+            }
+#endif
 #ifdef MMKV_APPLE
             MMKVInfo("deleting expired key [%@] in mmkv [%s], due date %u", key, m_mmapID.c_str(), time);
 #else
@@ -1805,101 +2564,1314 @@ mmkv::MMBuffer MMKV::getDataWithoutMTimeForKey(MMKVKey_t key) {
     return MMBuffer(std::move(raw), newLength);
 }
 
-#define NOOP ((void) 0)
+#ifndef MMKV_APPLE
 
-size_t MMKV::filterExpiredKeys() {
-    if (!m_enableKeyExpire || (m_crypter ? m_dicCrypt->empty() : m_dic->empty())) {
-        return 0;
+// read the expire date of every key, it only happens once after each loading of the file
+// values kept in memory need no decryption, only the big ones stored as file offsets do
+void MMKV::buildExpireIndex() {
+    if (!m_expireDates) {
+        m_expireDates = new unordered_map<string_view, uint32_t>();
+        m_expireQueue = new std::set<pair<uint32_t, string_view>>();
     }
-    SCOPED_LOCK(m_sharedProcessLock);
+    m_expireDates->clear();
+    m_expireQueue->clear();
 
-    auto now = getCurrentTimeInSecond();
-    MMKVInfo("filtering expired keys inside [%s] now: %u, m_expiredInSeconds: %u", m_mmapID.c_str(), now,
-             m_expiredInSeconds);
-
-    size_t count = 0;
+    auto addKey = [this](string_view key, const uint8_t *valueEnd) {
+        uint32_t time = 0;
+        memcpy(&time, valueEnd - Fixed32Size, Fixed32Size);
+        if (time != ExpireNever) {
+            m_expireDates->emplace(key, time);
+            m_expireQueue->emplace(time, key);
+        }
+    };
     auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
-#ifndef MMKV_DISABLE_CRYPT
+#    ifndef MMKV_DISABLE_CRYPT
     if (m_crypter) {
-        for (auto itr = m_dicCrypt->begin(); itr != m_dicCrypt->end(); NOOP) {
-            auto &kvHolder = itr->second;
-            assert(kvHolder.realValueSize() >= Fixed32Size);
-            auto buffer = kvHolder.toMMBuffer(basePtr, m_crypter);
-            auto ptr = (uint8_t *) buffer.getPtr();
-            ptr += buffer.length() - Fixed32Size;
-            auto time = *(const uint32_t *) ptr;
-            if (time != ExpireNever && time <= now) {
-                auto oldKey = itr->first;
-                itr = m_dicCrypt->erase(itr);
-#    ifdef MMKV_APPLE
-                MMKVInfo("deleting expired key [%@], due date %u", oldKey, time);
-                [oldKey release];
-#    else
-                MMKVInfo("deleting expired key [%s], due date %u", oldKey.c_str(), time);
+        for (const auto &itr : *m_dicCrypt) {
+            auto buffer = itr.second.toMMBuffer(basePtr, m_crypter);
+            if (buffer.length() >= Fixed32Size) {
+                addKey(itr.first, (const uint8_t *) buffer.getPtr() + buffer.length());
+            }
+        }
+    } else
 #    endif
-                count++;
-            } else {
-                itr++;
+    {
+        for (const auto &itr : *m_dic) {
+            auto &kvHolder = itr.second;
+            if (kvHolder.valueSize >= Fixed32Size) {
+                addKey(itr.first, basePtr + kvHolder.offset + kvHolder.computedKVSize + kvHolder.valueSize);
             }
         }
+    }
+    m_expireIndexValid = true;
+    MMKVInfo("build expire index of [%s] with %zu keys", m_mmapID.c_str(), m_expireDates->size());
+}
+
+void MMKV::eraseFromExpireIndex(string_view key) {
+    if (!m_expireIndexValid) {
+        return;
+    }
+    auto itr = m_expireDates->find(key);
+    if (itr != m_expireDates->end()) {
+        m_expireQueue->erase({itr->second, itr->first});
+        m_expireDates->erase(itr);
+    }
+}
+
+void MMKV::updateExpireIndex(string_view key, uint32_t expireDate) {
+    if (!m_expireIndexValid) {
+        return;
+    }
+    eraseFromExpireIndex(key);
+    if (expireDate == ExpireNever) {
+        return;
+    }
+    // the views must point to the key stored in the dictionary
+    string_view storedKey;
+#    ifndef MMKV_DISABLE_CRYPT
+    if (m_crypter) {
+        auto itr = m_dicCrypt->find(key);
+        if (itr == m_dicCrypt->end()) {
+            return;
+        }
+        storedKey = itr->first;
     } else
-#endif // !MMKV_DISABLE_CRYPT
+#    endif
     {
-        for (auto itr = m_dic->begin(); itr != m_dic->end(); NOOP) {
-            auto &kvHolder = itr->second;
-            assert(kvHolder.valueSize >= Fixed32Size);
-            auto ptr = basePtr + kvHolder.offset + kvHolder.computedKVSize;
-            ptr += kvHolder.valueSize - Fixed32Size;
-            auto time = *(const uint32_t *) ptr;
-            if (time != ExpireNever && time <= now) {
-                auto oldKey = itr->first;
-                itr = m_dic->erase(itr);
-#ifdef MMKV_APPLE
-                MMKVInfo("deleting expired key [%@], due date %u", oldKey, time);
-                [oldKey release];
-#else
-                MMKVInfo("deleting expired key [%s], due date %u", oldKey.c_str(), time);
-#endif
-                count++;
-            } else {
-                itr++;
+        auto itr = m_dic->find(key);
+        if (itr == m_dic->end()) {
+            return;
+        }
+        storedKey = itr->first;
+    }
+    m_expireDates->emplace(storedKey, expireDate);
+    m_expireQueue->emplace(expireDate, storedKey);
+}
+
+// ---- expire reaper ----
+
+void MMKV::startExpireReaper(uint32_t intervalInSeconds, size_t maxKeysPerRound, uint32_t timeBudgetInMS) {
+    if (!g_instanceLock) {
+        MMKVError("MMKV not initialized, call initializeMMKV() first");
+        return;
+    }
+    stopExpireReaper();
+    intervalInSeconds = max<uint32_t>(intervalInSeconds, 1);
+    maxKeysPerRound = max<size_t>(maxKeysPerRound, 1);
+    MMKVInfo("start expire reaper, interval: %u s, max keys per round: %zu, time budget: %u ms", intervalInSeconds,
+             maxKeysPerRound, timeBudgetInMS);
+
+    lock_guard<mutex> lock(g_reaperMutex);
+    g_reaperStopping = false;
+    g_reaperRunning = true;
+    g_reaperThread = new thread([=] {
+        unique_lock<mutex> lock(g_reaperMutex);
+        while (!g_reaperCondition.wait_for(lock, chrono::seconds(intervalInSeconds), [] { return g_reaperStopping; })) {
+            lock.unlock();
+            reapExpiredKeys(maxKeysPerRound, timeBudgetInMS);
+            lock.lock();
+        }
+    });
+}
+
+void MMKV::stopExpireReaper() {
+    thread *reaper = nullptr;
+    {
+        lock_guard<mutex> lock(g_reaperMutex);
+        if (!g_reaperThread) {
+            return;
+        }
+        reaper = g_reaperThread;
+        g_reaperThread = nullptr;
+        g_reaperStopping = true;
+    }
+    g_reaperCondition.notify_all();
+    reaper->join();
+    delete reaper;
+    g_reaperRunning = false;
+    MMKVInfo("expire reaper stopped");
+}
+
+bool MMKV::isExpireReaperRunning() {
+    return g_reaperRunning;
+}
+
+// remove at most maxCount expired keys from all instances within timeBudgetInMS, by appending deletion records
+// instances busy with other threads or processes, or not loaded yet, are left for the next round
+size_t MMKV::reapExpiredKeys(size_t maxCount, uint32_t timeBudgetInMS) {
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeBudgetInMS);
+    size_t total = 0;
+    SCOPED_LOCK(g_instanceLock);
+    for (auto kv : allInstances()) {
+        if (total >= maxCount || chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        // never wait on an instance lock while holding g_instanceLock
+        if (!kv->m_lock->try_lock()) {
+            continue;
+        }
+        // nor on a file lock, which another process may hold for long
+        auto processLock = kv->m_exclusiveProcessLock;
+        if (kv->m_enableKeyExpire && !kv->m_needLoadFromFile && !kv->isReadOnly() &&
+            (!processLock->m_enable || processLock->try_lock())) {
+            kv->checkLoadData();
+            if (kv->m_enableKeyExpire && kv->isFileValid()) {
+                if (!kv->m_expireIndexValid) {
+                    kv->buildExpireIndex();
+                }
+                // copy the keys, the views die with the entries
+                auto now = getCurrentTimeInSecond();
+                vector<string> expiredKeys;
+                for (auto &item : *kv->m_expireQueue) {
+                    if (item.first > now || total + expiredKeys.size() >= maxCount) {
+                        break;
+                    }
+                    expiredKeys.emplace_back(item.second);
+                }
+                size_t count = 0;
+                for (auto &key : expiredKeys) {
+                    if (chrono::steady_clock::now() >= deadline) {
+                        break;
+                    }
+                    kv->removeDataForKey(key);
+                    count++;
+                }
+                if (count > 0) {
+                    MMKVInfo("reaped %zu expired keys inside [%s]", count, kv->m_mmapID.c_str());
+                }
+                total += count;
             }
+            processLock->unlock();
         }
+        kv->m_lock->unlock();
     }
-    if (count != 0) {
-        MMKVInfo("deleted %zu expired keys inside [%s]", count, m_mmapID.c_str());
+    return total;
+}
+
+// ---- write behind ----
+
+constexpr size_t DefaultWriteBehindCapacity = 1024;
+
+struct MMKV::WriteBehindQueue {
+    mutex lock;
+    // signaled when the writer pool is done with it
+    condition_variable condition;
+    // key -> value as stored in the file, expire date included
+    unordered_map<string, MMBuffer> pending;
+    // for reads to skip the lock while nothing is queued
+    atomic<size_t> pendingCount{0};
+    size_t capacity = DefaultWriteBehindCapacity;
+    bool stopping = false;
+    // a task is posted to the writer pool and not finished yet
+    bool scheduled = false;
+    // the task is appending the key-values
+    bool running = false;
+};
+
+// the writer pool shared by all instances, started on first use
+// never destructed, its threads are still waiting at exit
+static mutex &g_writerMutex = *new mutex();
+static condition_variable &g_writerCondition = *new condition_variable();
+static deque<function<void()>> &g_writerTasks = *new deque<function<void()>>();
+static bool g_writersStarted = false;
+
+static void runOnWriters(function<void()> task) {
+    lock_guard<mutex> lock(g_writerMutex);
+    g_writerTasks.push_back(std::move(task));
+    if (!g_writersStarted) {
+        g_writersStarted = true;
+        // appending is mostly bound by m_lock of each instance, a couple of threads are enough
+        auto count = std::min<unsigned>(std::max<unsigned>(thread::hardware_concurrency(), 1), 2);
+        for (unsigned i = 0; i < count; i++) {
+            thread([] {
+                unique_lock<mutex> lock(g_writerMutex);
+                while (true) {
+                    g_writerCondition.wait(lock, [] { return !g_writerTasks.empty(); });
+                    auto task = std::move(g_writerTasks.front());
+                    g_writerTasks.pop_front();
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            }).detach();
+        }
     }
-    return count;
+    g_writerCondition.notify_one();
 }
 
-bool MMKV::enableCompareBeforeSet() {
-    MMKVInfo("enableCompareBeforeSet for [%s]", m_mmapID.c_str());
+template <typename T>
+static MMBuffer encodeScalar(T value, size_t size, void (CodedOutputData::*write)(T)) {
+    MMBuffer data(size);
+    CodedOutputData output(data.getPtr(), size);
+    (output.*write)(value);
+    return data;
+}
+
+MMBuffer MMKV::encodeValue(bool value) {
+    return encodeScalar(value, pbBoolSize(), &CodedOutputData::writeBool);
+}
+
+MMBuffer MMKV::encodeValue(int32_t value) {
+    return encodeScalar(value, pbInt32Size(value), &CodedOutputData::writeInt32);
+}
+
+MMBuffer MMKV::encodeValue(uint32_t value) {
+    return encodeScalar(value, pbUInt32Size(value), &CodedOutputData::writeUInt32);
+}
+
+MMBuffer MMKV::encodeValue(int64_t value) {
+    return encodeScalar(value, pbInt64Size(value), &CodedOutputData::writeInt64);
+}
+
+MMBuffer MMKV::encodeValue(uint64_t value) {
+    return encodeScalar(value, pbUInt64Size(value), &CodedOutputData::writeUInt64);
+}
+
+MMBuffer MMKV::encodeValue(float value) {
+    return encodeScalar(value, pbFloatSize(), &CodedOutputData::writeFloat);
+}
+
+MMBuffer MMKV::encodeValue(double value) {
+    return encodeScalar(value, pbDoubleSize(), &CodedOutputData::writeDouble);
+}
+
+MMBuffer MMKV::encodeValue(const char *value) {
+    return encodeValue(string_view(value));
+}
+
+MMBuffer MMKV::encodeValue(const string &value) {
+    return encodeValue(string_view(value));
+}
+
+MMBuffer MMKV::encodeValue(string_view value) {
+    return MiniPBCoder::encodeDataWithObject(MMBuffer((void *) value.data(), value.length(), MMBufferNoCopy));
+}
+
+MMBuffer MMKV::encodeValue(const MMBuffer &value) {
+    return MiniPBCoder::encodeDataWithObject(value);
+}
+
+MMBuffer MMKV::encodeValue(const vector<string> &value) {
+#    ifdef MMKV_HAS_CPP20
+    return MiniPBCoder::encodeDataWithObject(std::span(value));
+#    else
+    return MiniPBCoder::encodeDataWithObject(value);
+#    endif
+}
+
+MMKV::WriteBehindQueue *MMKV::writeBehindQueue() {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_likely(queue)) {
+        return queue;
+    }
     SCOPED_LOCK(m_lock);
-    SCOPED_LOCK(m_exclusiveProcessLock);
+    queue = m_writeBehind.load(memory_order_relaxed);
+    if (!queue) {
+        m_writeBehindOwner = make_shared<WriteBehindQueue>();
+        queue = m_writeBehindOwner.get();
+        m_writeBehind.store(queue, memory_order_release);
+        MMKVInfo("start write behind for [%s]", m_mmapID.c_str());
+    }
+    return queue;
+}
 
-    assert(!m_enableKeyExpire && "enableCompareBeforeSet is invalid when Expiration is on");
-    assert(!m_dicCrypt && "enableCompareBeforeSet is invalid when key encryption is on");
-    if (m_enableKeyExpire || m_dicCrypt) {
+bool MMKV::enqueueWrite(MMBuffer &&data, string_view key, uint32_t expireDuration) {
+    if (key.empty() || data.length() == 0) {
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
         return false;
     }
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        auto tmp = MMBuffer(data.length() + Fixed32Size);
+        auto ptr = (uint8_t *) tmp.getPtr();
+        memcpy(ptr, data.getPtr(), data.length());
+        auto time = (expireDuration != ExpireNever) ? getCurrentTimeInSecond() + expireDuration : ExpireNever;
+        memcpy(ptr + data.length(), &time, Fixed32Size);
+        data = std::move(tmp);
+    } else {
+        assert(expireDuration == ExpireNever && "setting expire duration without calling enableAutoKeyExpire() first");
+    }
 
-    m_enableCompareBeforeSet = true;
-    return true;
+    auto queue = writeBehindQueue();
+    string realKey(key);
+    while (true) {
+        unique_lock<mutex> lock(queue->lock);
+        if (queue->stopping) {
+            MMKVWarning("[%s] is closing, drop async write of [%s]", m_mmapID.c_str(), realKey.c_str());
+            return false;
+        }
+        auto itr = queue->pending.find(realKey);
+        if (itr != queue->pending.end()) {
+            itr->second = std::move(data);
+            return true;
+        }
+        if (queue->pending.size() < queue->capacity) {
+            queue->pending.emplace(std::move(realKey), std::move(data));
+            queue->pendingCount = queue->pending.size();
+            if (!queue->scheduled) {
+                queue->scheduled = true;
+                lock.unlock();
+                runOnWriters([kv = this, owner = m_writeBehindOwner] { runWriteBehind(kv, owner); });
+            }
+            return true;
+        }
+        // never wait for the writer pool, the caller might be holding m_lock
+        lock.unlock();
+        applyPendingWrites(queue);
+    }
 }
 
-bool MMKV::disableCompareBeforeSet() {
-    MMKVInfo("disableCompareBeforeSet for [%s]", m_mmapID.c_str());
+void MMKV::runWriteBehind(MMKV *kv, shared_ptr<WriteBehindQueue> queue) {
+    {
+        lock_guard<mutex> lock(queue->lock);
+        if (queue->stopping) {
+            // drained by stopWriteBehind(), kv might be gone already
+            queue->scheduled = false;
+            return;
+        }
+        queue->running = true;
+    }
+    kv->applyPendingWrites(queue.get());
+    bool more = false;
+    {
+        lock_guard<mutex> lock(queue->lock);
+        queue->running = false;
+        more = !queue->stopping && !queue->pending.empty();
+        queue->scheduled = more;
+        queue->condition.notify_all();
+    }
+    if (more) {
+        // queued meanwhile, take turns with other instances
+        runOnWriters([kv, queue] { runWriteBehind(kv, queue); });
+    }
+}
+
+void MMKV::applyPendingWrites(WriteBehindQueue *queue) {
     SCOPED_LOCK(m_lock);
     SCOPED_LOCK(m_exclusiveProcessLock);
+    checkLoadData();
 
-    assert(!m_enableKeyExpire && "disableCompareBeforeSet is invalid when Expiration is on");
-    assert(!m_dicCrypt && "disableCompareBeforeSet is invalid when key encryption is on");
-    if (m_enableKeyExpire || m_dicCrypt) {
-        return false;
+    // swapped under m_lock, so that readers see each key-value either queued or appended
+    unordered_map<string, MMBuffer> batch;
+    {
+        lock_guard<mutex> lock(queue->lock);
+        batch.swap(queue->pending);
+        queue->pendingCount = 0;
     }
-
-    m_enableCompareBeforeSet = false;
+    if (batch.empty()) {
+        return;
+    }
+    m_applyingPendingWrites = true;
+    for (auto &pair : batch) {
+        setDataForKey(std::move(pair.second), pair.first);
+    }
+    m_applyingPendingWrites = false;
+    MMKVDebug("appended %zu async writes to [%s]", batch.size(), m_mmapID.c_str());
+}
+
+void MMKV::applyPendingWrites() {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_unlikely(queue) && queue->pendingCount.load(memory_order_relaxed) > 0) {
+        applyPendingWrites(queue);
+    }
+}
+
+bool MMKV::pendingDataForKey(string_view key, MMBuffer &result) {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_likely(!queue) || queue->pendingCount.load(memory_order_relaxed) == 0) {
+        return false;
+    }
+    lock_guard<mutex> lock(queue->lock);
+    auto itr = queue->pending.find(string(key));
+    if (itr == queue->pending.end()) {
+        return false;
+    }
+    auto &raw = itr->second;
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        auto newLength = raw.length() - Fixed32Size;
+        uint32_t time = 0;
+        memcpy(&time, (const uint8_t *) raw.getPtr() + newLength, Fixed32Size);
+        if (time != ExpireNever && time <= getCurrentTimeInSecond()) {
+            result = MMBuffer();
+        } else {
+            result = MMBuffer(raw.getPtr(), newLength);
+        }
+        return true;
+    }
+    result = MMBuffer(raw.getPtr(), raw.length());
+    return true;
+}
+
+void MMKV::dropPendingWrite(string_view key) {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_likely(!queue) || m_applyingPendingWrites || queue->pendingCount.load(memory_order_relaxed) == 0) {
+        return;
+    }
+    lock_guard<mutex> lock(queue->lock);
+    queue->pending.erase(string(key));
+    queue->pendingCount = queue->pending.size();
+}
+
+void MMKV::discardPendingWrites() {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_likely(!queue)) {
+        return;
+    }
+    lock_guard<mutex> lock(queue->lock);
+    queue->pending.clear();
+    queue->pendingCount = 0;
+}
+
+void MMKV::setWriteBehindCapacity(size_t maxPendingKeys) {
+    auto queue = writeBehindQueue();
+    lock_guard<mutex> lock(queue->lock);
+    queue->capacity = std::max<size_t>(maxPendingKeys, 1);
+}
+
+void MMKV::stopWriteBehind() {
+    auto queue = m_writeBehind.load(memory_order_acquire);
+    if (mmkv_likely(!queue)) {
+        return;
+    }
+    {
+        // a task not started yet returns without touching this instance
+        unique_lock<mutex> lock(queue->lock);
+        queue->stopping = true;
+        queue->condition.wait(lock, [queue] { return !queue->running; });
+    }
+    applyPendingWrites(queue);
+    m_writeBehind = nullptr;
+    m_writeBehindOwner.reset();
+    MMKVInfo("stop write behind for [%s]", m_mmapID.c_str());
+}
+
+#endif // !MMKV_APPLE
+
+#define NOOP ((void) 0)
+
+size_t MMKV::filterExpiredKeys() {
+    if (!m_enableKeyExpire || (m_crypter ? m_dicCrypt->empty() : m_dic->empty())) {
+        return 0;
+    }
+    SCOPED_LOCK(m_sharedProcessLock);
+
+    auto now = getCurrentTimeInSecond();
+    MMKVInfo("filtering expired keys inside [%s] now: %u, m_expiredInSeconds: %u", m_mmapID.c_str(), now,
+             m_expiredInSeconds);
+
+    size_t count = 0;
+#ifndef MMKV_APPLE
+    if (!m_expireIndexValid) {
+        buildExpireIndex();
+    }
+    // only the expired keys are touched
+    while (!m_expireQueue->empty()) {
+        auto first = m_expireQueue->begin();
+        auto time = first->first;
+        if (time > now) {
+            break;
+        }
+        // a view of the key in the dictionary, valid until it's erased from there
+        auto key = first->second;
+        MMKVInfo("deleting expired key [%.*s], due date %u", (int) key.length(), key.data(), time);
+        // the elements go with the list, their keys are taken before the view dies
+        auto eraseKey = [this](auto &dic, string_view key) {
+            auto itr = dic.find(key);
+            eraseKeyFromIndexes(key);
+            if (itr != dic.end()) {
+                auto itemKeys = listItemKeys(key, itr->second);
+                dic.erase(itr);
+                for (const auto &itemKey : itemKeys) {
+                    eraseKeyFromIndexes(itemKey);
+                    dic.erase(itemKey);
+                }
+            }
+        };
+#    ifndef MMKV_DISABLE_CRYPT
+        if (m_crypter) {
+            eraseKey(*m_dicCrypt, key);
+        } else
+#    endif
+        {
+            eraseKey(*m_dic, key);
+        }
+        count++;
+    }
+#else
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+#    ifndef MMKV_DISABLE_CRYPT
+    if (m_crypter) {
+        for (auto itr = m_dicCrypt->begin(); itr != m_dicCrypt->end(); NOOP) {
+            auto &kvHolder = itr->second;
+            assert(kvHolder.realValueSize() >= Fixed32Size);
+            auto buffer = kvHolder.toMMBuffer(basePtr, m_crypter);
+            auto ptr = (uint8_t *) buffer.getPtr();
+            ptr += buffer.length() - Fixed32Size;
+            auto time = *(const uint32_t *) ptr;
+            if (time != ExpireNever && time <= now) {
+                auto oldKey = itr->first;
+                itr = m_dicCrypt->erase(itr);
+                MMKVInfo("deleting expired key [%@], due date %u", oldKey, time);
+                [oldKey release];
+                count++;
+            } else {
+                itr++;
+            }
+        }
+    } else
+#    endif // !MMKV_DISABLE_CRYPT
+    {
+        for (auto itr = m_dic->begin(); itr != m_dic->end(); NOOP) {
+            auto &kvHolder = itr->second;
+            assert(kvHolder.valueSize >= Fixed32Size);
+            auto ptr = basePtr + kvHolder.offset + kvHolder.computedKVSize;
+            ptr += kvHolder.valueSize - Fixed32Size;
+            auto time = *(const uint32_t *) ptr;
+            if (time != ExpireNever && time <= now) {
+                auto oldKey = itr->first;
+                itr = m_dic->erase(itr);
+                MMKVInfo("deleting expired key [%@], due date %u", oldKey, time);
+                [oldKey release];
+                count++;
+            } else {
+                itr++;
+            }
+        }
+    }
+#endif // !MMKV_APPLE
+    if (count != 0) {
+        MMKVInfo("deleted %zu expired keys inside [%s]", count, m_mmapID.c_str());
+    }
+    return count;
+}
+
+bool MMKV::enableCompareBeforeSet() {
+    MMKVInfo("enableCompareBeforeSet for [%s]", m_mmapID.c_str());
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+
+    assert(!m_enableKeyExpire && "enableCompareBeforeSet is invalid when Expiration is on");
+    assert(!m_dicCrypt && "enableCompareBeforeSet is invalid when key encryption is on");
+    if (m_enableKeyExpire || m_dicCrypt) {
+        return false;
+    }
+
+    m_enableCompareBeforeSet = true;
+    return true;
+}
+
+bool MMKV::disableCompareBeforeSet() {
+    MMKVInfo("disableCompareBeforeSet for [%s]", m_mmapID.c_str());
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+
+    assert(!m_enableKeyExpire && "disableCompareBeforeSet is invalid when Expiration is on");
+    assert(!m_dicCrypt && "disableCompareBeforeSet is invalid when key encryption is on");
+    if (m_enableKeyExpire || m_dicCrypt) {
+        return false;
+    }
+
+    m_enableCompareBeforeSet = false;
+    return true;
+}
+
+#ifndef MMKV_APPLE
+
+// the codec of a compressed value, after the leading 0x00
+constexpr uint8_t CompressedValueLZ4 = 'L';
+constexpr size_t CompressedValueTagSize = 2;
+
+static uint64_t nanosecondsSince(chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+bool MMKV::enableCompression(size_t thresholdBytes, double minRatio) {
+    MMKVInfo("enableCompression for [%s], threshold %zu, min ratio %.2f", m_mmapID.c_str(), thresholdBytes, minRatio);
+    // anything stored compressed has to be smaller at least, NaN is rejected as well
+    if (!(minRatio >= 1.0)) {
+        MMKVError("invalid min compression ratio %f for [%s]", minRatio, m_mmapID.c_str());
+        return false;
+    }
+    SCOPED_LOCK(m_lock);
+    m_compressionThreshold = std::max(thresholdBytes, MinCompressionThreshold);
+    m_minCompressionRatio = minRatio;
+    return true;
+}
+
+bool MMKV::disableCompression() {
+    MMKVInfo("disableCompression for [%s]", m_mmapID.c_str());
+    SCOPED_LOCK(m_lock);
+    m_compressionThreshold = 0;
+    return true;
+}
+
+MMKVCompressionStats MMKV::compressionStats() {
+    SCOPED_LOCK(m_lock);
+    return m_compressionStats;
+}
+
+bool MMKV::isCompressedValue(const MMBuffer &data) {
+    auto ptr = (const uint8_t *) data.getPtr();
+    return data.length() > CompressedValueTagSize && ptr[0] == 0 && ptr[1] == CompressedValueLZ4;
+}
+
+bool MMKV::compressedValueLength(const MMBuffer &data, size_t &length, size_t &headerSize) {
+    if (!isCompressedValue(data)) {
+        return false;
+    }
+    CodedInputData input((const uint8_t *) data.getPtr() + CompressedValueTagSize, data.length() - CompressedValueTagSize);
+    uint32_t rawLength = 0;
+    if (!input.tryReadUInt32(rawLength)) {
+        MMKVError("malformed compressed value: %s", input.lastError());
+        return false;
+    }
+    length = rawLength;
+    headerSize = CompressedValueTagSize + pbRawVarint32Size(rawLength);
+    return true;
+}
+
+bool MMKV::decompressValue(const MMBuffer &data, void *dst, size_t length, MMKVCompressionStats *stats) {
+    size_t rawLength = 0, headerSize = 0;
+    if (!compressedValueLength(data, rawLength, headerSize) || rawLength != length) {
+        return false;
+    }
+    auto start = chrono::steady_clock::now();
+    auto ret = lz4Decompress((const uint8_t *) data.getPtr() + headerSize, data.length() - headerSize, dst, length);
+    if (!ret) {
+        MMKVError("fail to decompress a value of %zu bytes", length);
+        return false;
+    }
+    if (stats) {
+        stats->decompressedCount++;
+        stats->decompressTime += nanosecondsSince(start);
+    }
+    return true;
+}
+
+bool MMKV::decompressValue(const MMBuffer &data, MMBuffer &result, MMKVCompressionStats *stats) {
+    size_t length = 0, headerSize = 0;
+    if (!compressedValueLength(data, length, headerSize)) {
+        return false;
+    }
+    MMBuffer buffer(length);
+    if (!decompressValue(data, buffer.getPtr(), length, stats)) {
+        return false;
+    }
+    result = std::move(buffer);
+    return true;
+}
+
+MMBuffer MMKV::compressValue(const MMBuffer &raw, double minRatio) {
+    auto start = chrono::steady_clock::now();
+    auto rawLength = static_cast<uint32_t>(raw.length());
+    auto headerSize = CompressedValueTagSize + pbRawVarint32Size(rawLength);
+    // not worth it unless it reaches minRatio, the compressor gives up as soon as it's over
+    auto maxSize = std::min(static_cast<size_t>(raw.length() / minRatio), raw.length() - 1);
+    MMBuffer result(maxSize);
+    auto ptr = (uint8_t *) result.getPtr();
+    size_t compressedSize = 0;
+    if (maxSize > headerSize) {
+        compressedSize = lz4Compress(raw.getPtr(), raw.length(), ptr + headerSize, maxSize - headerSize);
+    }
+    auto time = nanosecondsSince(start);
+
+    SCOPED_LOCK(m_lock);
+    m_compressionStats.compressTime += time;
+    if (compressedSize == 0) {
+        m_compressionStats.skippedCount++;
+        return MMBuffer();
+    }
+    ptr[0] = 0;
+    ptr[1] = CompressedValueLZ4;
+    CodedOutputData output(ptr + CompressedValueTagSize, headerSize - CompressedValueTagSize);
+    output.writeUInt32(rawLength);
+
+    m_compressionStats.compressedCount++;
+    m_compressionStats.rawBytes += raw.length();
+    m_compressionStats.compressedBytes += headerSize + compressedSize;
+    return MMBuffer(std::move(result), headerSize + compressedSize);
+}
+
+// the kind of reference, after the leading 0x00
+constexpr uint8_t BlobReferenceTag = 'B';
+constexpr size_t BlobReferenceTagSize = 2;
+// the blob id & CRC after the length
+constexpr size_t BlobReferenceTailSize = sizeof(uint64_t) + Fixed32Size;
+// blob files are named by the id in hex
+constexpr size_t BlobNameLength = sizeof(uint64_t) * 2;
+// superseded blobs taking more than this force a full write back to sweep them, see supersedeBlob()
+constexpr size_t MaxSupersededBlobBytes = 1024 * 1024;
+
+bool MMKV::enableBlobStorage(size_t thresholdBytes) {
+    SCOPED_LOCK(m_lock);
+    if (m_crypter) {
+        MMKVWarning("blob storage is not supported by encrypted [%s]", m_mmapID.c_str());
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
+#    ifdef MMKV_ANDROID
+    if (m_file->m_fileType == MMFILE_TYPE_ASHMEM) {
+        MMKVWarning("blob storage is not supported by ashmem [%s]", m_mmapID.c_str());
+        return false;
+    }
+#    endif
+    MMKVInfo("enableBlobStorage for [%s], threshold %zu", m_mmapID.c_str(), thresholdBytes);
+    m_blobThreshold = std::max(thresholdBytes, MinBlobThreshold);
+    return true;
+}
+
+bool MMKV::disableBlobStorage() {
+    MMKVInfo("disableBlobStorage for [%s]", m_mmapID.c_str());
+    SCOPED_LOCK(m_lock);
+    m_blobThreshold = 0;
+    return true;
+}
+
+bool MMKV::enableKeyReference() {
+    SCOPED_LOCK(m_lock);
+    if (m_crypter) {
+        MMKVWarning("key reference is not supported by encrypted [%s]", m_mmapID.c_str());
+        return false;
+    }
+    MMKVInfo("enableKeyReference for [%s]", m_mmapID.c_str());
+    m_enableKeyReference = true;
+    return true;
+}
+
+bool MMKV::disableKeyReference() {
+    MMKVInfo("disableKeyReference for [%s]", m_mmapID.c_str());
+    SCOPED_LOCK(m_lock);
+    m_enableKeyReference = false;
+    return true;
+}
+
+bool MMKV::isBlobReference(const MMBuffer &data) {
+    auto ptr = (const uint8_t *) data.getPtr();
+    return data.length() > BlobReferenceTagSize + BlobReferenceTailSize && ptr[0] == 0 && ptr[1] == BlobReferenceTag;
+}
+
+bool MMKV::parseBlobReference(const MMBuffer &data, size_t &length, uint64_t &blobID, uint32_t &crcDigest) {
+    if (!isBlobReference(data)) {
+        return false;
+    }
+    auto ptr = (const uint8_t *) data.getPtr();
+    CodedInputData input(ptr + BlobReferenceTagSize, data.length() - BlobReferenceTagSize);
+    uint32_t blobLength = 0;
+    if (!input.tryReadUInt32(blobLength)) {
+        MMKVError("malformed blob reference: %s", input.lastError());
+        return false;
+    }
+    auto headerSize = BlobReferenceTagSize + pbRawVarint32Size(blobLength);
+    if (headerSize + BlobReferenceTailSize != data.length()) {
+        MMKVError("malformed blob reference of %zu bytes", data.length());
+        return false;
+    }
+    length = blobLength;
+    memcpy(&blobID, ptr + headerSize, sizeof(blobID));
+    memcpy(&crcDigest, ptr + headerSize + sizeof(blobID), sizeof(crcDigest));
+    return true;
+}
+
+MMKVPath_t MMKV::blobPath(uint64_t blobID) const {
+    char name[BlobNameLength + 1];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(blobID));
+    return blobDirWithKVPath(m_path) + MMKV_PATH_SLASH + string2MMKVPath_t(name);
+}
+
+static uint64_t randomBlobID() {
+    static thread_local mt19937_64 engine(random_device{}());
+    return engine();
+}
+
+// the caller holds m_lock & m_exclusiveProcessLock until the reference is appended, see removeUnreferencedBlobs()
+MMBuffer MMKV::writeBlob(const MMBuffer &raw) {
+    auto blobDir = blobDirWithKVPath(m_path);
+    if (!isFileExist(blobDir) && !mkPath(blobDir)) {
+        return MMBuffer();
+    }
+    m_hasBlobs = true;
+    uint64_t blobID;
+    MMKVPath_t path;
+    do {
+        blobID = randomBlobID();
+        path = blobPath(blobID);
+    } while (isFileExist(path));
+    if (!writeFileContent(path, raw.getPtr(), raw.length())) {
+        removeFile(path);
+        return MMBuffer();
+    }
+    auto crcDigest = static_cast<uint32_t>(CRC32(0, (const uint8_t *) raw.getPtr(), raw.length()));
+
+    auto rawLength = static_cast<uint32_t>(raw.length());
+    auto headerSize = BlobReferenceTagSize + pbRawVarint32Size(rawLength);
+    MMBuffer reference(headerSize + BlobReferenceTailSize);
+    auto ptr = (uint8_t *) reference.getPtr();
+    ptr[0] = 0;
+    ptr[1] = BlobReferenceTag;
+    CodedOutputData output(ptr + BlobReferenceTagSize, headerSize - BlobReferenceTagSize);
+    output.writeUInt32(rawLength);
+    memcpy(ptr + headerSize, &blobID, sizeof(blobID));
+    memcpy(ptr + headerSize + sizeof(blobID), &crcDigest, sizeof(crcDigest));
+    return reference;
+}
+
+bool MMKV::readBlob(const MMBuffer &reference, void *dst, size_t length) {
+    size_t blobLength = 0;
+    uint64_t blobID = 0;
+    uint32_t crcDigest = 0;
+    if (!parseBlobReference(reference, blobLength, blobID, crcDigest) || blobLength != length) {
+        return false;
+    }
+    if (!readFileContent(blobPath(blobID), dst, length)) {
+        MMKVError("fail to read blob %016llx of [%s]", static_cast<unsigned long long>(blobID), m_mmapID.c_str());
+        return false;
+    }
+    if (static_cast<uint32_t>(CRC32(0, (const uint8_t *) dst, length)) != crcDigest) {
+        MMKVError("check crc of blob %016llx of [%s] fail", static_cast<unsigned long long>(blobID), m_mmapID.c_str());
+        return false;
+    }
+    return true;
+}
+
+MMBuffer MMKV::readBlob(const MMBuffer &reference) {
+    size_t length = 0;
+    uint64_t blobID = 0;
+    uint32_t crcDigest = 0;
+    if (!parseBlobReference(reference, length, blobID, crcDigest)) {
+        return MMBuffer();
+    }
+    auto headerSize = pbRawVarint32Size(static_cast<uint32_t>(length));
+    MMBuffer result(headerSize + length);
+    CodedOutputData output(result.getPtr(), headerSize);
+    output.writeUInt32(static_cast<uint32_t>(length));
+    if (!readBlob(reference, (uint8_t *) result.getPtr() + headerSize, length)) {
+        return MMBuffer();
+    }
+    return result;
+}
+
+void MMKV::removeBlob(const MMBuffer &reference) {
+    size_t length = 0;
+    uint64_t blobID = 0;
+    uint32_t crcDigest = 0;
+    if (parseBlobReference(reference, length, blobID, crcDigest)) {
+        removeFile(blobPath(blobID));
+    }
+}
+
+// the blob of an overwritten or removed value, the last confirmed data might still refer to it after a crash
+// so it's left to the sweep after the next full write back, which confirms the data that doesn't
+void MMKV::supersedeBlob(const MMBuffer &reference) {
+    size_t length = 0;
+    uint64_t blobID = 0;
+    uint32_t crcDigest = 0;
+    if (!parseBlobReference(reference, length, blobID, crcDigest)) {
+        return;
+    }
+    m_supersededBlobBytes += length;
+    if (m_supersededBlobBytes > MaxSupersededBlobBytes) {
+        MMKVInfo("sweeping %zu bytes of superseded blobs of [%s]", m_supersededBlobBytes, m_mmapID.c_str());
+        m_hasFullWriteback = false;
+        fullWriteback();
+    }
+}
+
+MMBuffer MMKV::blobReferenceForKey(MMKVKey_t key) const {
+    if (mmkv_likely(!m_hasBlobs) || m_crypter) {
+        return MMBuffer();
+    }
+    auto itr = m_dic->find(key);
+    if (itr == m_dic->end()) {
+        return MMBuffer();
+    }
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    return copyBlobReference(itr->second.toMMBuffer(basePtr));
+}
+
+// the new value of a key is in place, common to setDataForKey() & setEncodedDataForKey()
+void MMKV::didSetDataForKey(const MMBuffer &oldBlob) {
+    m_hasFullWriteback = false;
+    if (mmkv_unlikely(oldBlob.length() > 0)) {
+        supersedeBlob(oldBlob);
+    }
+}
+
+MMBuffer MMKV::copyBlobReference(const MMBuffer &stored) const {
+    auto length = stored.length();
+    if (mmkv_unlikely(m_enableKeyExpire)) {
+        if (length < Fixed32Size) {
+            return MMBuffer();
+        }
+        length -= Fixed32Size;
+    }
+    MMBuffer reference(stored.getPtr(), length, MMBufferNoCopy);
+    if (!isBlobReference(reference)) {
+        return MMBuffer();
+    }
+    return MMBuffer(reference.getPtr(), reference.length());
+}
+
+// the caller holds m_lock & m_exclusiveProcessLock
+void MMKV::removeUnreferencedBlobs() {
+    m_supersededBlobBytes = 0;
+    auto blobDir = blobDirWithKVPath(m_path);
+    if (m_crypter || !isFileExist(blobDir)) {
+        m_hasBlobs = false;
+        return;
+    }
+    unordered_set<uint64_t> referenced;
+    auto basePtr = (uint8_t *) (m_file->getMemory()) + Fixed32Size;
+    for (auto &itr : *m_dic) {
+        auto reference = copyBlobReference(itr.second.toMMBuffer(basePtr));
+        size_t length = 0;
+        uint64_t blobID = 0;
+        uint32_t crcDigest = 0;
+        if (reference.length() > 0 && parseBlobReference(reference, length, blobID, crcDigest)) {
+            referenced.insert(blobID);
+        }
+    }
+
+    size_t removedCount = 0;
+    walkInDir(blobDir, WalkFile, [&](const MMKVPath_t &filePath, WalkType) {
+        auto name = MMKVPath_t2String(filePath.substr(filePath.rfind(MMKV_PATH_SLASH) + 1));
+        char *end = nullptr;
+        auto blobID = static_cast<uint64_t>(strtoull(name.c_str(), &end, 16));
+        bool isBlob = name.length() == BlobNameLength && end == name.c_str() + name.length();
+        if (!isBlob || referenced.find(blobID) == referenced.end()) {
+            removeFile(filePath);
+            removedCount++;
+        }
+    });
+    if (referenced.empty()) {
+        removeDirectory(blobDir);
+        m_hasBlobs = false;
+    }
+    if (removedCount > 0) {
+        MMKVInfo("removed %zu unreferenced blobs of [%s]", removedCount, m_mmapID.c_str());
+    }
+}
+
+// only the header is checked, nothing is parsed or copied
+void MMKV::loadFrozenFile() {
+    if (!m_file->isFileValid()) {
+        m_file->reloadFromFile(m_expectedCapacity);
+    }
+    if (!m_frozen) {
+        m_frozen = new FrozenIndex();
+    }
+    if (!m_file->isFileValid() || !m_frozen->open(m_file->getMemory(), m_file->getFileSize())) {
+        // the index is left empty, so is the instance
+        MMKVError("[%s] is not a valid frozen file", m_mmapID.c_str());
+        return;
+    }
+    MMKVInfo("loaded frozen [%s] with %zu keys, file size %zu", m_mmapID.c_str(), m_frozen->count(),
+             m_file->getFileSize());
+}
+
+bool MMKV::exportFrozen(const string &dstMMapID, MMKVPath_t *dstRootPath) {
+    auto dstPath = mappedKVPathWithID(dstMMapID, MMKV_SINGLE_PROCESS, dstRootPath);
+    if (dstPath == m_path) {
+        MMKVError("can't export [%s] as a frozen file onto itself", m_mmapID.c_str());
+        return false;
+    }
+    MMBuffer content;
+    size_t count = 0;
+    {
+        MMKVVector items;
+        // expired keys are filtered, blobs are read, encrypted values are decrypted, list elements are kept
+        doEnumerate(
+            [&](string_view key, const MMBuffer &value) {
+                if (value.length() > 0) {
+                    items.emplace_back(string(key), MMBuffer(value.getPtr(), value.length()));
+                }
+                return true;
+            },
+            true);
+        sort(items.begin(), items.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        content = FrozenIndex::build(items);
+        count = items.size();
+    }
+    if (content.length() == 0) {
+        MMKVError("fail to build frozen file of [%s]", m_mmapID.c_str());
+        return false;
+    }
+    // replaced atomically, the old file stays valid for instances still mapping it
+    auto tmpPath = dstPath + string2MMKVPath_t(".tmp");
+    if (!writeFileContent(tmpPath, content.getPtr(), content.length()) || !tryAtomicRename(tmpPath, dstPath)) {
+        removeFile(tmpPath);
+        return false;
+    }
+    MMKVInfo("exported [%s] to frozen [%s] with %zu keys, file size %zu", m_mmapID.c_str(), dstMMapID.c_str(), count,
+             content.length());
     return true;
 }
 
+MMKV::BulkBuilder::BulkBuilder(const string &mmapID, MMKVMode mode, MMKVPath_t *rootPath)
+    : m_kv(mmkvHandleWithID(mmapID, mode, nullptr, rootPath)), m_dic(new MMKVMap()) {
+    if (m_kv) {
+        SCOPED_LOCK(m_kv->m_lock);
+        m_kv->checkLoadData();
+        // the expire date itself is taken on commit()
+        m_hasExpireDate = m_kv->m_enableKeyExpire;
+        m_compressionThreshold = m_kv->m_compressionThreshold;
+        m_minCompressionRatio = m_kv->m_minCompressionRatio;
+        m_blobThreshold = m_kv->m_blobThreshold;
+    }
+    m_data.resize(ItemSizeHolderSize);
+    CodedOutputData output(m_data.data(), ItemSizeHolderSize);
+    output.writeUInt32(AESCrypt::randomItemSizeHolder(ItemSizeHolderSize));
+}
+
+MMKV::BulkBuilder::~BulkBuilder() {
+    delete m_dic;
+}
+
+void MMKV::BulkBuilder::reserve(size_t keyCount, size_t size) {
+    m_dic->reserve(keyCount);
+    m_data.reserve(ItemSizeHolderSize + size);
+}
+
+size_t MMKV::BulkBuilder::count() const {
+    return m_dic->size();
+}
+
+// the expire date is left as ExpireNever, see writeExpireDate()
+uint8_t *MMKV::BulkBuilder::writeRecord(string_view key, size_t size, KeyValueHolder &kvHolder) {
+    auto keyLength = static_cast<uint32_t>(key.length());
+    auto valueLength = size + (m_hasExpireDate ? Fixed32Size : 0);
+    auto offset = m_data.size();
+    auto recordSize = pbRawVarint32Size(keyLength) + keyLength + pbRawVarint32Size((uint32_t) valueLength) + valueLength;
+    m_data.resize(offset + recordSize);
+    CodedOutputData output(m_data.data() + offset, recordSize);
+    output.writeRawVarint32(static_cast<int32_t>(keyLength));
+    output.writeRawData(MMBuffer((void *) key.data(), keyLength, MMBufferNoCopy));
+    output.writeRawVarint32(static_cast<int32_t>(valueLength));
+    kvHolder = KeyValueHolder(keyLength, static_cast<uint32_t>(valueLength), static_cast<uint32_t>(offset));
+    return m_data.data() + offset + output.getPosition();
+}
+
+uint8_t *MMKV::BulkBuilder::appendRecord(string_view key, size_t size) {
+    if (!m_kv || m_committed || key.empty()) {
+        return nullptr;
+    }
+    auto valueLength = size + (m_hasExpireDate ? Fixed32Size : 0);
+    auto recordSize = pbRawVarint32Size(static_cast<uint32_t>(key.length())) + key.length() +
+                      pbRawVarint32Size((uint32_t) valueLength) + valueLength;
+    if (m_data.size() + recordSize > UINT32_MAX) {
+        MMKVError("bulk data of [%s] exceeds 4GB", m_kv->m_mmapID.c_str());
+        return nullptr;
+    }
+    KeyValueHolder kvHolder;
+    auto value = writeRecord(key, size, kvHolder);
+    if (!m_blobKeys.empty()) {
+        m_blobKeys.erase(string(key));
+    }
+    auto result = m_dic->try_emplace(string(key), kvHolder);
+    if (!result.second) {
+        m_deadBytes += result.first->second.computedKVSize + result.first->second.valueSize;
+        result.first->second = kvHolder;
+    }
+    return value;
+}
+
+bool MMKV::BulkBuilder::append(const MMBuffer &value, string_view key) {
+    auto ptr = appendRecord(key, value.length());
+    if (!ptr) {
+        return false;
+    }
+    if (value.length() > 0) {
+        memcpy(ptr, value.getPtr(), value.length());
+    }
+    return true;
+}
+
+// the same as encodeValue(), without the coder, compressed or left for a blob as setDataForKey() does
+bool MMKV::BulkBuilder::appendBytes(const void *value, size_t length, string_view key) {
+    if (!m_kv || m_committed || key.empty()) {
+        return false;
+    }
+    bool isBlob = m_blobThreshold > 0 && length >= m_blobThreshold;
+    if (!isBlob && m_compressionThreshold > 0 && length >= m_compressionThreshold) {
+        auto compressed = m_kv->compressValue(MMBuffer((void *) value, length, MMBufferNoCopy), m_minCompressionRatio);
+        if (compressed.length() > 0) {
+            return append(compressed, key);
+        }
+    }
+    auto lengthSize = pbRawVarint32Size(static_cast<uint32_t>(length));
+    auto ptr = appendRecord(key, lengthSize + length);
+    if (!ptr) {
+        return false;
+    }
+    CodedOutputData output(ptr, lengthSize + length);
+    output.writeRawVarint32(static_cast<int32_t>(length));
+    if (length > 0) {
+        memcpy(ptr + lengthSize, value, length);
+    }
+    if (isBlob) {
+        m_blobKeys.emplace(key);
+    }
+    return true;
+}
+
+vector<pair<const string *, KeyValueHolder *>> MMKV::BulkBuilder::recordsInOrder() {
+    vector<pair<const string *, KeyValueHolder *>> vec;
+    vec.reserve(m_dic->size());
+    for (auto &itr : *m_dic) {
+        vec.emplace_back(&itr.first, &itr.second);
+    }
+    sort(vec.begin(), vec.end(), [](auto &left, auto &right) { return left.second->offset < right.second->offset; });
+    return vec;
+}
+
+// move the last record of each key down over the earlier ones, in the order they're set
+void MMKV::BulkBuilder::compact() {
+    uint32_t offset = ItemSizeHolderSize;
+    for (auto [key, kvHolder] : recordsInOrder()) {
+        auto size = kvHolder->computedKVSize + kvHolder->valueSize;
+        if (kvHolder->offset != offset) {
+            memmove(m_data.data() + offset, m_data.data() + kvHolder->offset, size);
+            kvHolder->offset = offset;
+        }
+        offset += size;
+    }
+    m_data.resize(offset);
+    m_deadBytes = 0;
+}
+
+// the caller holds m_lock & m_exclusiveProcessLock until the references are written into the file
+vector<MMBuffer> MMKV::BulkBuilder::writeBlobs() {
+    vector<MMBuffer> references;
+    vector<uint8_t> data(m_data.begin(), m_data.begin() + ItemSizeHolderSize);
+    data.reserve(m_data.size());
+    data.swap(m_data);
+    auto expireSize = m_hasExpireDate ? Fixed32Size : 0;
+    for (auto [key, kvHolder] : recordsInOrder()) {
+        auto value = data.data() + kvHolder->offset + kvHolder->computedKVSize;
+        auto size = kvHolder->valueSize - expireSize;
+        MMBuffer raw, reference;
+        if (m_blobKeys.find(*key) != m_blobKeys.end() && CodedInputData(value, size).tryReadData(raw, false)) {
+            reference = m_kv->writeBlob(raw);
+        }
+        // never larger than the record it replaces, the 4GB limit holds
+        if (reference.length() > 0) {
+            memcpy(writeRecord(*key, reference.length(), *kvHolder), reference.getPtr(), reference.length());
+            references.push_back(std::move(reference));
+        } else {
+            memcpy(writeRecord(*key, size, *kvHolder), value, size);
+        }
+    }
+    m_deadBytes = 0;
+    m_blobKeys.clear();
+    return references;
+}
+
+void MMKV::BulkBuilder::writeExpireDate(uint32_t expireDate) {
+    for (auto &itr : *m_dic) {
+        auto &kvHolder = itr.second;
+        auto ptr = m_data.data() + kvHolder.offset + kvHolder.computedKVSize + kvHolder.valueSize - Fixed32Size;
+        CodedOutputData output(ptr, Fixed32Size);
+        output.writeRawLittleEndian32(UInt32ToInt32(expireDate));
+    }
+}
+
+bool MMKV::BulkBuilder::commit() {
+    if (!m_kv || m_committed) {
+        return false;
+    }
+    m_committed = true;
+    // no sweeping in between writing the blobs & writing their references, see removeUnreferencedBlobs()
+    SCOPED_LOCK(m_kv->m_lock);
+    SCOPED_LOCK(m_kv->m_exclusiveProcessLock);
+    m_kv->checkLoadData();
+    vector<MMBuffer> references;
+    if (!m_blobKeys.empty() && !m_kv->m_crypter) {
+        // compacts duplicates as well
+        references = writeBlobs();
+    } else if (m_compactDuplicates && m_deadBytes > 0) {
+        compact();
+    }
+    // the same expire date as set() would write now
+    if (m_hasExpireDate && m_kv->m_expiredInSeconds != ExpireNever) {
+        writeExpireDate(getCurrentTimeInSecond() + m_kv->m_expiredInSeconds);
+    }
+    auto ret = m_kv->writeBulkData(m_data, *m_dic, m_hasExpireDate);
+    if (!ret) {
+        for (auto &reference : references) {
+            m_kv->removeBlob(reference);
+        }
+    }
+    // the dictionary is taken by the instance
+    vector<uint8_t>().swap(m_data);
+    m_dic->clear();
+    return ret;
+}
+
+bool MMKV::writeBulkData(const vector<uint8_t> &data, MMKVMap &dic, bool hasExpireDate) {
+    SCOPED_LOCK(m_lock);
+    SCOPED_LOCK(m_exclusiveProcessLock);
+    // they would be replaced anyway
+    discardPendingWrites();
+
+    checkLoadData();
+    if (!isFileValid()) {
+        MMKVWarning("[%s] file not valid", m_mmapID.c_str());
+        return false;
+    }
+    if (isReadOnly()) {
+        MMKVWarning("[%s] file readonly", m_mmapID.c_str());
+        return false;
+    }
+    if (m_crypter) {
+        MMKVWarning("bulk building is not supported by encrypted [%s]", m_mmapID.c_str());
+        return false;
+    }
+    if (hasExpireDate != m_enableKeyExpire) {
+        MMKVError("auto key expiration of [%s] changed during bulk building", m_mmapID.c_str());
+        return false;
+    }
+#    ifdef MMKV_ANDROID
+    if (m_file->m_fileType == MMFILE_TYPE_ASHMEM && data.size() + Fixed32Size > m_file->getFileSize()) {
+        MMKVError("ashmem [%s] is too small for %zu bytes of bulk data", m_mmapID.c_str(), data.size());
+        return false;
+    }
+#    endif
+
+    // sized once, instead of doubling on the way
+    auto fileSize = roundUp<size_t>(data.size() + Fixed32Size, DEFAULT_MMAP_SIZE);
+    if (fileSize > m_file->getFileSize()) {
+        MMKVInfo("extending [%s] file size from %zu to %zu for bulk data", m_mmapID.c_str(), m_file->getFileSize(),
+                 fileSize);
+        if (!m_file->truncate(fileSize) || !isFileValid()) {
+            return false;
+        }
+    }
+    auto ptr = (uint8_t *) m_file->getMemory();
+    memcpy(ptr + Fixed32Size, data.data(), data.size());
+    m_actualSize = data.size();
+    delete m_output;
+    m_output = new CodedOutputData(ptr + Fixed32Size, m_file->getFileSize() - Fixed32Size);
+    m_output->seek(m_actualSize);
+
+    invalidateIndexes();
+    clearDictionary(m_dic);
+    m_dic->swap(dic);
+    // the only pass of CRC, & the new sequence tells other processes to reload
+    recalculateCRCDigestWithIV(nullptr);
+    m_hasFullWriteback = true;
+    writeSnapshot();
+    sync(MMKV_SYNC);
+    if (mmkv_unlikely(m_hasBlobs)) {
+        removeUnreferencedBlobs();
+    }
+    MMKVInfo("wrote %zu key-values of bulk data into [%s], size %zu", m_dic->size(), m_mmapID.c_str(), m_actualSize);
+    return true;
+}
+
+#endif // !MMKV_APPLE
+
 MMKV_NAMESPACE_END
@@ -29,6 +29,8 @@ MMKV_NAMESPACE_BEGIN
 std::string mmapedKVKey(const std::string &mmapID, const MMKVPath_t *rootPath = nullptr);
 MMKVPath_t mappedKVPathWithID(const std::string &mmapID, MMKVMode mode, const MMKVPath_t *rootPath);
 MMKVPath_t crcPathWithID(const std::string &mmapID, MMKVMode mode, const MMKVPath_t *rootPath);
+MMKVPath_t snapshotPathWithKVPath(const MMKVPath_t &kvPath);
+MMKVPath_t blobDirWithKVPath(const MMKVPath_t &kvPath);
 
 MMKVRecoverStrategic onMMKVCRCCheckFail(const std::string &mmapID);
 MMKVRecoverStrategic onMMKVFileLengthError(const std::string &mmapID);
@@ -35,6 +35,7 @@
 #    include <sys/file.h>
 #    include <dirent.h>
 #    include <cstring>
+#    include <vector>
 #    include <unistd.h>
 
 using namespace std;
@@ -203,6 +204,29 @@ bool MemoryFile::msync(SyncFlag syncFlag) {
     return false;
 }
 
+size_t MemoryFile::getResidentSize() const {
+    if (!m_ptr || m_size == 0) {
+        return 0;
+    }
+    auto pageSize = getPageSize();
+    auto pageCount = (m_size + pageSize - 1) / pageSize;
+    vector<unsigned char> pages(pageCount);
+#    ifdef MMKV_APPLE
+    auto ret = ::mincore(m_ptr, m_size, (char *) pages.data());
+#    else
+    auto ret = ::mincore(m_ptr, m_size, pages.data());
+#    endif
+    if (ret != 0) {
+        MMKVError("fail to mincore [%s], %s", m_diskFile.m_path.c_str(), strerror(errno));
+        return 0;
+    }
+    size_t residentCount = 0;
+    for (auto page : pages) {
+        residentCount += (page & 1);
+    }
+    return residentCount * pageSize;
+}
+
 bool MemoryFile::mmap() {
     auto oldPtr = m_ptr;
     auto mode = m_readOnly ? PROT_READ : (PROT_READ | PROT_WRITE);
@@ -552,6 +576,68 @@ bool copyFileContent(const MMKVPath_t &srcPath, MMKVFileHandle_t dstFD) {
 
 #endif // !defined(MMKV_APPLE)
 
+bool readFileContent(const MMKVPath_t &path, void *ptr, size_t size) {
+    File file(path, OpenFlag::ReadOnly);
+    if (!file.isFileValid()) {
+        return false;
+    }
+    auto buffer = (uint8_t *) ptr;
+    size_t totalRead = 0;
+    while (totalRead < size) {
+        auto sizeRead = read(file.getFd(), buffer + totalRead, size - totalRead);
+        if (sizeRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            MMKVError("fail to read file [%s], %d(%s)", path.c_str(), errno, strerror(errno));
+            return false;
+        }
+        if (sizeRead == 0) {
+            MMKVError("file [%s] is shorter than %zu", path.c_str(), size);
+            return false;
+        }
+        totalRead += static_cast<size_t>(sizeRead);
+    }
+    return true;
+}
+
+bool writeFileContent(const MMKVPath_t &path, const void *ptr, size_t size) {
+    File file(path, OpenFlag::WriteOnly | OpenFlag::Create | OpenFlag::Truncate);
+    if (!file.isFileValid()) {
+        return false;
+    }
+    auto buffer = (const uint8_t *) ptr;
+    size_t totalWrite = 0;
+    while (totalWrite < size) {
+        auto sizeWrite = write(file.getFd(), buffer + totalWrite, size - totalWrite);
+        if (sizeWrite < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            MMKVError("fail to write file [%s], %d(%s)", path.c_str(), errno, strerror(errno));
+            return false;
+        }
+        totalWrite += static_cast<size_t>(sizeWrite);
+    }
+    return true;
+}
+
+bool removeFile(const MMKVPath_t &path) {
+    if (::unlink(path.c_str()) != 0) {
+        MMKVWarning("fail to remove file [%s], %d(%s)", path.c_str(), errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool removeDirectory(const MMKVPath_t &path) {
+    if (::rmdir(path.c_str()) != 0) {
+        MMKVWarning("fail to remove directory [%s], %d(%s)", path.c_str(), errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
 void walkInDir(const MMKVPath_t &dirPath, WalkType type, const function<void(const MMKVPath_t&, WalkType)> &walker) {
     auto folderPathStr = dirPath.data();
     DIR *dir = opendir(folderPathStr);
@@ -148,6 +148,9 @@ public:
 
     bool msync(SyncFlag syncFlag);
 
+    // the size of mapped pages currently resident in memory
+    size_t getResidentSize() const;
+
     // call this if clearMemoryCache() has been called
     void reloadFromFile(size_t expectedCapacity = 0);
 
@@ -182,6 +185,14 @@ extern bool copyFileContent(const MMKVPath_t &srcPath, const MMKVPath_t &dstPath
 extern bool copyFileContent(const MMKVPath_t &srcPath, MMKVFileHandle_t dstFD);
 extern bool copyFileContent(const MMKVPath_t &srcPath, MMKVFileHandle_t dstFD, bool needTruncate);
 
+// read exactly size bytes from the beginning of the file
+extern bool readFileContent(const MMKVPath_t &path, void *ptr, size_t size);
+// create or truncate the file, then write size bytes into it
+extern bool writeFileContent(const MMKVPath_t &path, const void *ptr, size_t size);
+extern bool removeFile(const MMKVPath_t &path);
+// the directory must be empty
+extern bool removeDirectory(const MMKVPath_t &path);
+
 enum WalkType : uint32_t {
     WalkFile = 1 << 0,
     WalkFolder = 1 << 1,
@@ -27,8 +27,11 @@
 #    include "MMKVLog.h"
 #    include "ScopedLock.hpp"
 #    include "ThreadLock.h"
+#    include <algorithm>
 #    include <cassert>
+#    include <psapi.h>
 #    include <strsafe.h>
+#    include <vector>
 
 using namespace std;
 
@@ -176,6 +179,28 @@ bool MemoryFile::msync(SyncFlag syncFlag) {
     return false;
 }
 
+size_t MemoryFile::getResidentSize() const {
+    if (!m_ptr || m_size == 0) {
+        return 0;
+    }
+    auto pageSize = getPageSize();
+    auto pageCount = (m_size + pageSize - 1) / pageSize;
+    vector<PSAPI_WORKING_SET_EX_INFORMATION> pages(pageCount);
+    for (size_t index = 0; index < pageCount; index++) {
+        pages[index].VirtualAddress = (char *) m_ptr + index * pageSize;
+    }
+    auto size = (DWORD) (pages.size() * sizeof(PSAPI_WORKING_SET_EX_INFORMATION));
+    if (!QueryWorkingSetEx(GetCurrentProcess(), pages.data(), size)) {
+        MMKVError("fail to QueryWorkingSetEx [%ls]:%d", m_diskFile.m_path.c_str(), GetLastError());
+        return 0;
+    }
+    size_t residentCount = 0;
+    for (auto &page : pages) {
+        residentCount += page.VirtualAttributes.Valid;
+    }
+    return residentCount * pageSize;
+}
+
 bool MemoryFile::mmap() {
     auto mode = m_readOnly ? PAGE_READONLY : PAGE_READWRITE;
     m_fileMapping = CreateFileMapping(m_diskFile.getFd(), nullptr, mode, 0, 0, nullptr);
@@ -497,6 +522,64 @@ bool copyFileContent(const MMKVPath_t &srcPath, MMKVFileHandle_t dstFD) {
     return copyFileContent(srcPath, dstFD, true);
 }
 
+bool readFileContent(const MMKVPath_t &path, void *ptr, size_t size) {
+    File file(path, OpenFlag::ReadOnly);
+    if (!file.isFileValid()) {
+        return false;
+    }
+    auto buffer = (uint8_t *) ptr;
+    size_t totalRead = 0;
+    while (totalRead < size) {
+        auto sizeToRead = (DWORD) std::min<size_t>(size - totalRead, MAXDWORD);
+        DWORD sizeRead = 0;
+        if (!ReadFile(file.getFd(), buffer + totalRead, sizeToRead, &sizeRead, nullptr)) {
+            MMKVError("fail to read %ls: %d", path.c_str(), GetLastError());
+            return false;
+        }
+        if (sizeRead == 0) {
+            MMKVError("file [%ls] is shorter than %zu", path.c_str(), size);
+            return false;
+        }
+        totalRead += sizeRead;
+    }
+    return true;
+}
+
+bool writeFileContent(const MMKVPath_t &path, const void *ptr, size_t size) {
+    File file(path, OpenFlag::WriteOnly | OpenFlag::Create | OpenFlag::Truncate);
+    if (!file.isFileValid()) {
+        return false;
+    }
+    auto buffer = (const uint8_t *) ptr;
+    size_t totalWrite = 0;
+    while (totalWrite < size) {
+        auto sizeToWrite = (DWORD) std::min<size_t>(size - totalWrite, MAXDWORD);
+        DWORD sizeWrite = 0;
+        if (!WriteFile(file.getFd(), buffer + totalWrite, sizeToWrite, &sizeWrite, nullptr)) {
+            MMKVError("fail to write %ls: %d", path.c_str(), GetLastError());
+            return false;
+        }
+        totalWrite += sizeWrite;
+    }
+    return true;
+}
+
+bool removeFile(const MMKVPath_t &path) {
+    if (!DeleteFile(path.c_str())) {
+        MMKVWarning("fail to remove file [%ls]: %d", path.c_str(), GetLastError());
+        return false;
+    }
+    return true;
+}
+
+bool removeDirectory(const MMKVPath_t &path) {
+    if (!RemoveDirectory(path.c_str())) {
+        MMKVWarning("fail to remove directory [%ls]: %d", path.c_str(), GetLastError());
+        return false;
+    }
+    return true;
+}
+
 void walkInDir(const MMKVPath_t &dirPath,
                WalkType type,
                const std::function<void(const MMKVPath_t &, WalkType)> &walker) {
@@ -25,6 +25,13 @@
 #include "PBEncodeItem.hpp"
 #include "PBUtility.h"
 #include "MMKVLog.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#ifdef MMKV_HAS_CPP20
+#    include <bit>
+#endif
 
 #ifdef MMKV_APPLE
 #    if __has_feature(objc_arc)
@@ -36,10 +43,29 @@ using namespace std;
 
 namespace mmkv {
 
-MiniPBCoder::MiniPBCoder() : m_encodeItems(new std::vector<PBEncodeItem>()) {
+// the encode items are reset & reused by the next coder on the same thread, keeping their capacity
+struct EncodeArena {
+    std::vector<PBEncodeItem> items;
+    bool inUse = false;
+};
+static thread_local EncodeArena t_encodeArena;
+
+// don't hold on to the memory of an unusually large container
+constexpr size_t EncodeArenaMaxItems = 4096;
+
+MiniPBCoder::MiniPBCoder() {
+    auto &arena = t_encodeArena;
+    if (mmkv_likely(!arena.inUse)) {
+        arena.inUse = true;
+        m_encodeItems = &arena.items;
+        m_ownsArena = true;
+    } else {
+        // nested encoding, fall back to a private one
+        m_encodeItems = new std::vector<PBEncodeItem>();
+    }
 }
 
-MiniPBCoder::MiniPBCoder(const MMBuffer *inputBuffer, AESCrypt *crypter) : MiniPBCoder() {
+MiniPBCoder::MiniPBCoder(const MMBuffer *inputBuffer, AESCrypt *crypter) {
     m_inputBuffer = inputBuffer;
 #ifndef MMKV_DISABLE_CRYPT
     if (crypter) {
@@ -57,9 +83,17 @@ MiniPBCoder::~MiniPBCoder() {
 #ifndef MMKV_DISABLE_CRYPT
     delete m_inputDataDecrpt;
 #endif
-    delete m_outputBuffer;
-    delete m_outputData;
-    delete m_encodeItems;
+    if (m_ownsArena) {
+        auto &arena = t_encodeArena;
+        if (arena.items.capacity() > EncodeArenaMaxItems) {
+            std::vector<PBEncodeItem>().swap(arena.items);
+        } else {
+            arena.items.clear();
+        }
+        arena.inUse = false;
+    } else {
+        delete m_encodeItems;
+    }
 }
 
 // encode
@@ -185,23 +219,48 @@ size_t MiniPBCoder::prepareObjectForEncode(const MMKVVector &vec) {
     return index;
 }
 
+// run a sized encoder into a newly allocated MMBuffer
+template <typename Encoder>
+static MMBuffer encodeIntoBuffer(Encoder &&encoder) {
+    MMBuffer result;
+    auto size = encoder([&result](size_t compiledSize) -> void * {
+        result = MMBuffer(compiledSize);
+        return result.getPtr();
+    });
+    if (size == 0) {
+        return MMBuffer();
+    }
+    return result;
+}
+
 MMBuffer MiniPBCoder::writePreparedItems(size_t index) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return writePreparedItems(index, reserve); });
+}
+
+size_t MiniPBCoder::writePreparedItems(size_t index, const EncodeReserver &reserve) {
     try {
         PBEncodeItem *oItem = (index < m_encodeItems->size()) ? &(*m_encodeItems)[index] : nullptr;
-        if (oItem && oItem->compiledSize > 0) {
-            m_outputBuffer = new MMBuffer(oItem->compiledSize);
-            m_outputData = new CodedOutputData(m_outputBuffer->getPtr(), m_outputBuffer->length());
-
-            writeRootObject();
+        if (!oItem || oItem->compiledSize == 0) {
+            return 0;
+        }
+        auto ptr = reserve(oItem->compiledSize);
+        if (!ptr) {
+            return 0;
         }
+        CodedOutputData output(ptr, oItem->compiledSize);
+        m_outputData = &output;
+        writeRootObject();
+        m_outputData = nullptr;
 
-        return std::move(*m_outputBuffer);
+        return oItem->compiledSize;
     } catch (const std::exception &exception) {
+        m_outputData = nullptr;
         MMKVError("%s", exception.what());
-        return MMBuffer();
+        return 0;
     } catch (...) {
+        m_outputData = nullptr;
         MMKVError("encode fail");
-        return MMBuffer();
+        return 0;
     }
 }
 
@@ -260,262 +319,239 @@ size_t MiniPBCoder::prepareObjectForEncode(const MMKV_STRING_CONTAINER &v) {
     return index;
 }
 
-#ifdef MMKV_HAS_CPP20
-
-size_t MiniPBCoder::prepareObjectForEncode(const std::span<const int32_t> &vec) {
-    m_encodeItems->push_back(PBEncodeItem());
-    PBEncodeItem *encodeItem = &(m_encodeItems->back());
-    size_t index = m_encodeItems->size() - 1;
-    {
-        encodeItem->type = PBEncodeItemType_Container;
-        encodeItem->value.bufferValue = nullptr;
-
-        for (const auto value : vec) {
-            PBEncodeItem item;
-            item.type = PBEncodeItemType_Int32;
-            item.value.int32Value = value;
-            item.compiledSize = pbInt32Size(value);
+vector<string> MiniPBCoder::decodeOneVector() {
+    vector<string> v;
 
-            (*m_encodeItems)[index].valueSize += item.compiledSize;
-            m_encodeItems->push_back(std::move(item));
-        }
+    m_inputData->readInt32();
 
-        encodeItem = &(*m_encodeItems)[index];
+    while (!m_inputData->isAtEnd()) {
+        auto value = m_inputData->readString();
+        v.push_back(std::move(value));
     }
-    encodeItem->compiledSize = pbRawVarint32Size(encodeItem->valueSize) + encodeItem->valueSize;
 
-    return index;
+    return v;
 }
 
-size_t MiniPBCoder::prepareObjectForEncode(const std::span<const uint32_t> &vec) {
-    m_encodeItems->push_back(PBEncodeItem());
-    PBEncodeItem *encodeItem = &(m_encodeItems->back());
-    size_t index = m_encodeItems->size() - 1;
-    {
-        encodeItem->type = PBEncodeItemType_Container;
-        encodeItem->value.bufferValue = nullptr;
-
-        for (const auto value : vec) {
-            PBEncodeItem item;
-            item.type = PBEncodeItemType_UInt32;
-            item.value.uint32Value = value;
-            item.compiledSize = pbUInt32Size(value);
-
-            (*m_encodeItems)[index].valueSize += item.compiledSize;
-            m_encodeItems->push_back(std::move(item));
+bool MiniPBCoder::decodeOneVector(vector<string> &result) {
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
+    }
+    while (!m_inputData->isAtEnd()) {
+        string value;
+        if (!m_inputData->tryReadString(value)) {
+            MMKVError("%s", m_inputData->lastError());
+            return false;
         }
-
-        encodeItem = &(*m_encodeItems)[index];
+        result.push_back(std::move(value));
     }
-    encodeItem->compiledSize = pbRawVarint32Size(encodeItem->valueSize) + encodeItem->valueSize;
-
-    return index;
+    return true;
 }
 
-size_t MiniPBCoder::prepareObjectForEncode(const std::span<const int64_t> &vec) {
-    m_encodeItems->push_back(PBEncodeItem());
-    PBEncodeItem *encodeItem = &(m_encodeItems->back());
-    size_t index = m_encodeItems->size() - 1;
-    {
-        encodeItem->type = PBEncodeItemType_Container;
-        encodeItem->value.bufferValue = nullptr;
+#ifdef MMKV_HAS_CPP20
 
-        for (const auto value : vec) {
-            PBEncodeItem item;
-            item.type = PBEncodeItemType_Int64;
-            item.value.int64Value = value;
-            item.compiledSize = pbInt64Size(value);
+// a varint vector starting with a zero length is empty, so that a longer one is free for the fixed-width format:
+// 0x00, element width, raw little-endian elements
+constexpr uint8_t FixedWidthVectorMarker = 0;
+constexpr size_t FixedWidthVectorHeaderSize = 2;
 
-            (*m_encodeItems)[index].valueSize += item.compiledSize;
-            m_encodeItems->push_back(std::move(item));
-        }
+static bool isFixedWidthVector(const MMBuffer &data) {
+    return data.length() >= FixedWidthVectorHeaderSize && ((const uint8_t *) data.getPtr())[0] == FixedWidthVectorMarker;
+}
 
-        encodeItem = &(*m_encodeItems)[index];
+// copy size bytes of fixed-size little-endian values starting from position
+template <typename T>
+static bool copyFixedSizeValues(const MMBuffer &data, size_t position, int32_t size, std::vector<T> &result) {
+    if (size < 0 || size % sizeof(T) != 0 || position + size != data.length()) {
+        MMKVError("invalid fixed-size vector of %d bytes, %zu bytes available", size, data.length() - position);
+        return false;
     }
-    encodeItem->compiledSize = pbRawVarint32Size(encodeItem->valueSize) + encodeItem->valueSize;
-
-    return index;
+    auto count = size / sizeof(T);
+    auto ptr = (const uint8_t *) data.getPtr() + position;
+    result.resize(count);
+    if constexpr (std::endian::native == std::endian::little) {
+        memcpy(result.data(), ptr, size);
+    } else {
+        for (size_t index = 0; index < count; index++, ptr += sizeof(T)) {
+            std::make_unsigned_t<std::conditional_t<sizeof(T) == 4, int32_t, int64_t>> bits = 0;
+            for (size_t byte = 0; byte < sizeof(T); byte++) {
+                bits |= static_cast<decltype(bits)>(ptr[byte]) << (byte * 8);
+            }
+            memcpy(&result[index], &bits, sizeof(T));
+        }
+    }
+    return true;
 }
 
-size_t MiniPBCoder::prepareObjectForEncode(const std::span<const uint64_t> &vec) {
-    m_encodeItems->push_back(PBEncodeItem());
-    PBEncodeItem *encodeItem = &(m_encodeItems->back());
-    size_t index = m_encodeItems->size() - 1;
-    {
-        encodeItem->type = PBEncodeItemType_Container;
-        encodeItem->value.bufferValue = nullptr;
-
-        for (const auto value : vec) {
-            PBEncodeItem item;
-            item.type = PBEncodeItemType_UInt64;
-            item.value.uint64Value = value;
-            item.compiledSize = pbUInt64Size(value);
+template <typename T>
+static bool decodeFixedWidthVector(const MMBuffer &data, std::vector<T> &result) {
+    auto width = ((const uint8_t *) data.getPtr())[1];
+    if (width != sizeof(T)) {
+        MMKVError("fixed-width vector of %u bytes elements, expected %zu", width, sizeof(T));
+        return false;
+    }
+    auto size = data.length() - FixedWidthVectorHeaderSize;
+    return copyFixedSizeValues(data, FixedWidthVectorHeaderSize, static_cast<int32_t>(size), result);
+}
 
-            (*m_encodeItems)[index].valueSize += item.compiledSize;
-            m_encodeItems->push_back(std::move(item));
+template <typename T>
+static void copyToLittleEndian(uint8_t *ptr, const std::span<const T> &values) {
+    if constexpr (std::endian::native == std::endian::little) {
+        memcpy(ptr, values.data(), values.size_bytes());
+    } else {
+        for (auto value : values) {
+            std::make_unsigned_t<std::conditional_t<sizeof(T) == 4, int32_t, int64_t>> bits = 0;
+            memcpy(&bits, &value, sizeof(T));
+            for (size_t byte = 0; byte < sizeof(T); byte++, bits >>= 8) {
+                *ptr++ = static_cast<uint8_t>(bits);
+            }
         }
-
-        encodeItem = &(*m_encodeItems)[index];
     }
-    encodeItem->compiledSize = pbRawVarint32Size(encodeItem->valueSize) + encodeItem->valueSize;
-
-    return index;
 }
 
-#endif // MMKV_HAS_CPP20
-
-vector<string> MiniPBCoder::decodeOneVector() {
-    vector<string> v;
+template <typename T>
+static MMBuffer encodeFixedWidth(const std::span<const T> &values) {
+    if (values.empty()) {
+        // the same as an empty varint vector
+        return MiniPBCoder::encodeDataWithObject(values);
+    }
+    auto buffer = MMBuffer(FixedWidthVectorHeaderSize + values.size_bytes());
+    auto ptr = (uint8_t *) buffer.getPtr();
+    ptr[0] = FixedWidthVectorMarker;
+    ptr[1] = sizeof(T);
+    copyToLittleEndian(ptr + FixedWidthVectorHeaderSize, values);
+    return buffer;
+}
 
-    m_inputData->readInt32();
+MMBuffer MiniPBCoder::encodeFixedWidthVector(const std::span<const int32_t> &obj) {
+    return encodeFixedWidth(obj);
+}
 
-    while (!m_inputData->isAtEnd()) {
-        auto value = m_inputData->readString();
-        v.push_back(std::move(value));
-    }
+MMBuffer MiniPBCoder::encodeFixedWidthVector(const std::span<const uint32_t> &obj) {
+    return encodeFixedWidth(obj);
+}
 
-    return v;
+MMBuffer MiniPBCoder::encodeFixedWidthVector(const std::span<const int64_t> &obj) {
+    return encodeFixedWidth(obj);
 }
 
-#ifdef MMKV_HAS_CPP20
+MMBuffer MiniPBCoder::encodeFixedWidthVector(const std::span<const uint64_t> &obj) {
+    return encodeFixedWidth(obj);
+}
 
 bool MiniPBCoder::decodeOneVector(std::vector<bool> &result) {
-    try {
-        auto size = m_inputData->readInt32();
-        result.reserve(size / pbBoolSize());
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
+    }
+    result.reserve(std::max(size, 0) / pbBoolSize());
 
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readBool();
-            result.push_back(value);
+    while (!m_inputData->isAtEnd()) {
+        bool value;
+        if (!m_inputData->tryReadBool(value)) {
+            MMKVError("%s", m_inputData->lastError());
+            return false;
         }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+        result.push_back(value);
     }
-    return false;
+    return true;
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<int32_t> &result) {
-    try {
-        m_inputData->readInt32();
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readInt32();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    if (isFixedWidthVector(*m_inputBuffer)) {
+        return decodeFixedWidthVector(*m_inputBuffer, result);
     }
-    return false;
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size) || !m_inputData->tryReadVarints(result)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
+    }
+    return true;
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<uint32_t> &result) {
-    try {
-        m_inputData->readInt32();
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readUInt32();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    if (isFixedWidthVector(*m_inputBuffer)) {
+        return decodeFixedWidthVector(*m_inputBuffer, result);
     }
-    return false;
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size) || !m_inputData->tryReadVarints(result)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
+    }
+    return true;
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<int64_t> &result) {
-    try {
-        m_inputData->readInt32();
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readInt64();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    if (isFixedWidthVector(*m_inputBuffer)) {
+        return decodeFixedWidthVector(*m_inputBuffer, result);
+    }
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size) || !m_inputData->tryReadVarints(result)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
     }
-    return false;
+    return true;
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<uint64_t> &result) {
-    try {
-        m_inputData->readInt32();
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readUInt64();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    if (isFixedWidthVector(*m_inputBuffer)) {
+        return decodeFixedWidthVector(*m_inputBuffer, result);
+    }
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size) || !m_inputData->tryReadVarints(result)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
     }
-    return false;
+    return true;
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<float> &result) {
-    try {
-        auto size = m_inputData->readInt32();
-        result.reserve(size / pbFloatSize());
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readFloat();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
     }
-    return false;
+    return copyFixedSizeValues(*m_inputBuffer, m_inputData->getPosition(), size, result);
 }
 
 bool MiniPBCoder::decodeOneVector(std::vector<double> &result) {
-    try {
-        auto size = m_inputData->readInt32();
-        result.reserve(size / pbDoubleSize());
-
-        while (!m_inputData->isAtEnd()) {
-            auto value = m_inputData->readDouble();
-            result.push_back(value);
-        }
-        return true;
-    } catch (std::exception &exception) {
-        MMKVError("%s", exception.what());
-    } catch (...) {
-        MMKVError("decode fail");
+    int32_t size;
+    if (!m_inputData->tryReadInt32(size)) {
+        MMKVError("%s", m_inputData->lastError());
+        return false;
     }
-    return false;
+    return copyFixedSizeValues(*m_inputBuffer, m_inputData->getPosition(), size, result);
 }
 
 #endif // MMKV_HAS_CPP20
 
 void MiniPBCoder::decodeOneMap(MMKVMap &dic, size_t position, bool greedy) {
-    auto block = [position, this](MMKVMap &dictionary) {
+    // no exception on malformed data, a partially written file is decoded as far as possible when greedy
+    // keepDeleted: deleted keys are kept with an empty value, to be applied later
+    auto block = [position, this](MMKVMap &dictionary, bool keepDeleted) {
         if (position) {
-            m_inputData->seek(position);
+            if (!m_inputData->trySeek(position)) {
+                return false;
+            }
         } else {
-            m_inputData->readInt32();
+            int32_t size;
+            if (!m_inputData->tryReadInt32(size)) {
+                return false;
+            }
         }
+        string key;
         while (!m_inputData->isAtEnd()) {
             KeyValueHolder kvHolder;
-            const auto &key = m_inputData->readString(kvHolder);
+            if (!m_inputData->tryReadString(kvHolder, key)) {
+                return false;
+            }
             if (key.length() > 0) {
-                m_inputData->readData(kvHolder);
-                if (kvHolder.valueSize > 0) {
+                if (!m_inputData->tryReadData(kvHolder)) {
+                    return false;
+                }
+                if (kvHolder.valueSize > 0 || keepDeleted) {
                     dictionary[key] = std::move(kvHolder);
                 } else {
                     auto itr = dictionary.find(key);
@@ -525,29 +561,172 @@ void MiniPBCoder::decodeOneMap(MMKVMap &dic, size_t position, bool greedy) {
                 }
             }
         }
+        return true;
     };
 
     if (greedy) {
-        try {
-            block(dic);
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("prepare encode fail");
+        if (!block(dic, false)) {
+            MMKVError("%s", m_inputData->lastError());
+        }
+    } else if (position) {
+        // the records after position are applied onto dic, all or nothing
+        MMKVMap tmpDic;
+        if (block(tmpDic, true)) {
+            for (auto &itr : tmpDic) {
+                if (itr.second.valueSize > 0) {
+                    dic.insert_or_assign(itr.first, itr.second);
+                } else {
+                    dic.erase(itr.first);
+                }
+            }
+        } else {
+            MMKVError("%s", m_inputData->lastError());
+            // the same result as decoding from the beginning
+            dic.clear();
         }
     } else {
-        try {
-            MMKVMap tmpDic;
-            block(tmpDic);
+        MMKVMap tmpDic;
+        if (block(tmpDic, false)) {
             dic.swap(tmpDic);
-        } catch (std::exception &exception) {
-            MMKVError("%s", exception.what());
-        } catch (...) {
-            MMKVError("prepare encode fail");
+        } else {
+            MMKVError("%s", m_inputData->lastError());
         }
     }
 }
 
+// it's not worth spawning threads for files smaller than this
+constexpr size_t ParallelDecodeMinSize = 8 * 1024 * 1024;
+constexpr size_t ParallelDecodeMinChunkSize = 2 * 1024 * 1024;
+constexpr size_t ParallelDecodeMaxThreads = 8;
+
+bool MiniPBCoder::decodeMapParallel(MMKVMap &dic, const MMBuffer &oData, size_t position) {
+    auto length = oData.length();
+    if (length < ParallelDecodeMinSize) {
+        return false;
+    }
+    size_t threadCount = std::min<size_t>(thread::hardware_concurrency(), ParallelDecodeMaxThreads);
+    threadCount = std::min<size_t>(threadCount, length / ParallelDecodeMinChunkSize);
+    if (threadCount < 2) {
+        return false;
+    }
+
+    // skip through the records to find out the chunk boundaries, without decoding any key
+    vector<size_t> boundaries;
+    {
+        // let the single thread path report any error
+        CodedInputData input(oData.getPtr(), length);
+        int32_t size;
+        if (position ? !input.trySeek(position) : !input.tryReadInt32(size)) {
+            return false;
+        }
+        boundaries.push_back(input.getPosition());
+        auto chunkSize = (length - input.getPosition()) / threadCount;
+        auto nextBoundary = input.getPosition() + chunkSize;
+        while (!input.isAtEnd()) {
+            int32_t keySize;
+            if (!input.tryReadInt32(keySize) || keySize < 0) {
+                return false;
+            }
+            // a key reference holds no key bytes, it's resolved by decodeChunk()
+            if (static_cast<uint32_t>(keySize) < KeyValueHolder::KeyReferenceBase &&
+                !input.trySeek(static_cast<size_t>(keySize))) {
+                return false;
+            }
+            // keep in sync with decodeOneMap(): empty key has no value
+            if (keySize > 0) {
+                int32_t valueSize;
+                if (!input.tryReadInt32(valueSize) || valueSize < 0 || !input.trySeek(static_cast<size_t>(valueSize))) {
+                    return false;
+                }
+            }
+            if (input.getPosition() >= nextBoundary && boundaries.size() < threadCount) {
+                boundaries.push_back(input.getPosition());
+                nextBoundary += chunkSize;
+            }
+        }
+        if (boundaries.back() != length) {
+            boundaries.push_back(length);
+        }
+    }
+    auto chunkCount = boundaries.size() - 1;
+    if (chunkCount < 2) {
+        return false;
+    }
+
+    // decode each chunk into its own dictionary, deleted keys are kept to be merged later
+    vector<MMKVMap> chunkDics(chunkCount);
+    vector<uint8_t> chunkFails(chunkCount, false);
+    auto decodeChunk = [&](size_t index) {
+        auto &chunkDic = chunkDics[index];
+        CodedInputData input(oData.getPtr(), boundaries[index + 1]);
+        if (!input.trySeek(boundaries[index])) {
+            chunkFails[index] = true;
+            return;
+        }
+        string key;
+        while (!input.isAtEnd()) {
+            KeyValueHolder kvHolder;
+            if (!input.tryReadString(kvHolder, key)) {
+                MMKVError("%s", input.lastError());
+                chunkFails[index] = true;
+                return;
+            }
+            if (key.length() > 0) {
+                if (!input.tryReadData(kvHolder)) {
+                    MMKVError("%s", input.lastError());
+                    chunkFails[index] = true;
+                    return;
+                }
+                chunkDic[key] = std::move(kvHolder);
+            }
+        }
+    };
+    vector<thread> workers;
+    workers.reserve(chunkCount - 1);
+    try {
+        for (size_t index = 1; index < chunkCount; index++) {
+            workers.emplace_back(decodeChunk, index);
+        }
+    } catch (std::exception &exception) {
+        MMKVWarning("fail to start decoding thread: %s", exception.what());
+        // decode the rest on current thread
+        for (auto index = workers.size() + 1; index < chunkCount; index++) {
+            decodeChunk(index);
+        }
+    }
+    decodeChunk(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto fail : chunkFails) {
+        if (fail) {
+            // let the single thread path handle the error
+            return false;
+        }
+    }
+
+    // merge from the newest chunk to the oldest, merge() won't override an existing (newer) key
+    size_t totalCount = 0;
+    for (auto &chunkDic : chunkDics) {
+        totalCount += chunkDic.size();
+    }
+    MMKVMap tmpDic = std::move(chunkDics.back());
+    tmpDic.reserve(totalCount);
+    for (auto index = chunkCount - 1; index > 0; index--) {
+        tmpDic.merge(chunkDics[index - 1]);
+    }
+    for (auto itr = tmpDic.begin(); itr != tmpDic.end();) {
+        if (itr->second.valueSize == 0) {
+            itr = tmpDic.erase(itr);
+        } else {
+            itr++;
+        }
+    }
+    dic.swap(tmpDic);
+    MMKVInfo("decoded %zu bytes with %zu threads", length, chunkCount);
+    return true;
+}
+
 #    ifndef MMKV_DISABLE_CRYPT
 
 void MiniPBCoder::decodeOneMap(MMKVMapCrypt &dic, size_t position, bool greedy) {
@@ -603,49 +782,148 @@ vector<string> MiniPBCoder::decodeVector(const MMBuffer &oData) {
 }
 
 #ifdef MMKV_HAS_CPP20
-MMBuffer MiniPBCoder::getEncodeData(const std::vector<bool> &value) {
+size_t MiniPBCoder::getEncodeData(const std::vector<bool> &value, const EncodeReserver &reserve) {
     auto valueLength = static_cast<uint32_t>(value.size() * pbBoolSize());
     auto size = pbRawVarint32Size(valueLength) + valueLength;
-    auto buffer = MMBuffer(size);
-    CodedOutputData output(buffer.getPtr(), size);
+    auto ptr = reserve(size);
+    if (!ptr) {
+        return 0;
+    }
+    CodedOutputData output(ptr, size);
     output.writeUInt32(valueLength);
 
     for (auto single : value) {
         output.writeBool(single);
     }
-    return buffer;
+    return size;
 }
 
-MMBuffer MiniPBCoder::getEncodeData(const std::span<const float> &value) {
-    auto valueLength = static_cast<uint32_t>(value.size() * pbFloatSize());
-    auto size = pbRawVarint32Size(valueLength) + valueLength;
-    auto buffer = MMBuffer(size);
-    CodedOutputData output(buffer.getPtr(), size);
+template <typename T>
+static size_t encodeFixedSizeValues(const std::span<const T> &values, const MiniPBCoder::EncodeReserver &reserve) {
+    auto valueLength = static_cast<uint32_t>(values.size_bytes());
+    auto headerSize = pbRawVarint32Size(valueLength);
+    auto ptr = (uint8_t *) reserve(headerSize + valueLength);
+    if (!ptr) {
+        return 0;
+    }
+    CodedOutputData output(ptr, headerSize);
     output.writeUInt32(valueLength);
+    copyToLittleEndian(ptr + headerSize, values);
+    return headerSize + valueLength;
+}
 
-    for (auto single : value) {
-        output.writeFloat(single);
+size_t MiniPBCoder::getEncodeData(const std::span<const float> &value, const EncodeReserver &reserve) {
+    return encodeFixedSizeValues(value, reserve);
+}
+
+size_t MiniPBCoder::getEncodeData(const std::span<const double> &value, const EncodeReserver &reserve) {
+    return encodeFixedSizeValues(value, reserve);
+}
+
+// negative int32 is sign-extended to 10 bytes, the same as CodedOutputData::writeInt32()
+static inline uint64_t toVarint(int32_t value) {
+    return static_cast<uint64_t>(static_cast<int64_t>(value));
+}
+
+static inline uint64_t toVarint(uint32_t value) {
+    return value;
+}
+
+static inline uint64_t toVarint(int64_t value) {
+    return static_cast<uint64_t>(value);
+}
+
+static inline uint64_t toVarint(uint64_t value) {
+    return value;
+}
+
+// branchless, 7 bits a byte, so that the loop can be vectorized
+static inline size_t varintSize(uint64_t value) {
+    return (static_cast<size_t>(std::bit_width(value | 1)) * 9 + 64) / 64;
+}
+
+static inline uint8_t *writeVarint(uint8_t *ptr, uint64_t value) {
+    while (value >= 0x80) {
+        *ptr++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
     }
-    return buffer;
+    *ptr++ = static_cast<uint8_t>(value);
+    return ptr;
+}
+
+template <typename T>
+static size_t encodeVarints(const std::span<const T> &values, const MiniPBCoder::EncodeReserver &reserve) {
+    size_t valueLength = 0;
+    for (auto value : values) {
+        valueLength += varintSize(toVarint(value));
+    }
+    auto size = pbRawVarint32Size(static_cast<uint32_t>(valueLength)) + valueLength;
+    auto begin = (uint8_t *) reserve(size);
+    if (!begin) {
+        return 0;
+    }
+    auto ptr = writeVarint(begin, valueLength);
+    for (auto value : values) {
+        ptr = writeVarint(ptr, toVarint(value));
+    }
+    assert(ptr == begin + size);
+    return size;
+}
+
+size_t MiniPBCoder::getEncodeData(const std::span<const int32_t> &value, const EncodeReserver &reserve) {
+    return encodeVarints(value, reserve);
+}
+
+size_t MiniPBCoder::getEncodeData(const std::span<const uint32_t> &value, const EncodeReserver &reserve) {
+    return encodeVarints(value, reserve);
+}
+
+size_t MiniPBCoder::getEncodeData(const std::span<const int64_t> &value, const EncodeReserver &reserve) {
+    return encodeVarints(value, reserve);
+}
+
+size_t MiniPBCoder::getEncodeData(const std::span<const uint64_t> &value, const EncodeReserver &reserve) {
+    return encodeVarints(value, reserve);
+}
+
+MMBuffer MiniPBCoder::getEncodeData(const std::vector<bool> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
+}
+
+MMBuffer MiniPBCoder::getEncodeData(const std::span<const float> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
 }
 
 MMBuffer MiniPBCoder::getEncodeData(const std::span<const double> &value) {
-    auto valueLength = static_cast<uint32_t>(value.size() * pbDoubleSize());
-    auto size = pbRawVarint32Size(valueLength) + valueLength;
-    auto buffer = MMBuffer(size);
-    CodedOutputData output(buffer.getPtr(), size);
-    output.writeUInt32(valueLength);
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
+}
 
-    for (auto single : value) {
-        output.writeDouble(single);
-    }
-    return buffer;
+MMBuffer MiniPBCoder::getEncodeData(const std::span<const int32_t> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
+}
+
+MMBuffer MiniPBCoder::getEncodeData(const std::span<const uint32_t> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
+}
+
+MMBuffer MiniPBCoder::getEncodeData(const std::span<const int64_t> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
+}
+
+MMBuffer MiniPBCoder::getEncodeData(const std::span<const uint64_t> &value) {
+    return encodeIntoBuffer([&](const EncodeReserver &reserve) { return getEncodeData(value, reserve); });
 }
 #endif // MMKV_HAS_CPP20
 
 #endif // !MMKV_APPLE
 
 void MiniPBCoder::decodeMap(MMKVMap &dic, const MMBuffer &oData, size_t position) {
+#ifndef MMKV_APPLE
+    // the parallel decoding replaces dic as a whole
+    if (position == 0 && decodeMapParallel(dic, oData, position)) {
+        return;
+    }
+#endif
     MiniPBCoder oCoder(&oData);
     oCoder.decodeOneMap(dic, position, false);
 }
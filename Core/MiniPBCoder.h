@@ -26,6 +26,7 @@
 
 #include "MMBuffer.h"
 #include <cstdint>
+#include <functional>
 #ifdef MMKV_HAS_CPP20
 #  include <span>
 #  define MMKV_STRING_CONTAINER std::span<const std::string>
@@ -43,13 +44,20 @@ class CodedInputDataCrypt;
 struct PBEncodeItem;
 
 class MiniPBCoder {
+public:
+    // given the encoded size, return where to write it, or nullptr to abort
+    using EncodeReserver = std::function<void *(size_t compiledSize)>;
+
+private:
     const MMBuffer *m_inputBuffer = nullptr;
     CodedInputData *m_inputData = nullptr;
     CodedInputDataCrypt *m_inputDataDecrpt = nullptr;
 
-    MMBuffer *m_outputBuffer = nullptr;
+    // only valid inside writePreparedItems()
     CodedOutputData *m_outputData = nullptr;
+    // borrowed from the thread's encode arena unless it's nested, decoders have none
     std::vector<PBEncodeItem> *m_encodeItems = nullptr;
+    bool m_ownsArena = false;
 
     MiniPBCoder();
     explicit MiniPBCoder(const MMBuffer *inputBuffer, AESCrypt *crypter = nullptr);
@@ -68,7 +76,21 @@ class MiniPBCoder {
 
     MMBuffer writePreparedItems(size_t index);
 
+    // return the encoded size, 0 on error
+    size_t writePreparedItems(size_t index, const EncodeReserver &reserve);
+
+    template <typename T>
+    size_t getEncodeData(const T &obj, const EncodeReserver &reserve) {
+        size_t index = prepareObjectForEncode(obj);
+        return writePreparedItems(index, reserve);
+    }
+
     void decodeOneMap(MMKVMap &dic, size_t position, bool greedy);
+#ifndef MMKV_APPLE
+    // split a large file into chunks and decode them on multiple threads
+    // return false if it's not worth it, the caller should decode on the current thread
+    static bool decodeMapParallel(MMKVMap &dic, const MMBuffer &oData, size_t position);
+#endif
 #ifndef MMKV_DISABLE_CRYPT
     void decodeOneMap(MMKVMapCrypt &dic, size_t position, bool greedy);
 #endif
@@ -77,12 +99,8 @@ class MiniPBCoder {
     size_t prepareObjectForEncode(const std::string &str);
     size_t prepareObjectForEncode(const MMKV_STRING_CONTAINER &vector);
     std::vector<std::string> decodeOneVector();
+    bool decodeOneVector(std::vector<std::string> &result);
 #ifdef MMKV_HAS_CPP20
-    size_t prepareObjectForEncode(const std::span<const int32_t> &vec);
-    size_t prepareObjectForEncode(const std::span<const uint32_t> &vec);
-    size_t prepareObjectForEncode(const std::span<const int64_t> &vec);
-    size_t prepareObjectForEncode(const std::span<const uint64_t> &vec);
-
     bool decodeOneVector(std::vector<bool> &result);
     bool decodeOneVector(std::vector<int32_t> &result);
     bool decodeOneVector(std::vector<uint32_t> &result);
@@ -95,6 +113,33 @@ class MiniPBCoder {
     MMBuffer getEncodeData(const std::vector<bool> &obj);
     MMBuffer getEncodeData(const std::span<const float> &obj);
     MMBuffer getEncodeData(const std::span<const double> &obj);
+
+    // varints are sized in one pass & written straight into the buffer
+    MMBuffer getEncodeData(const std::span<const int32_t> &obj);
+    MMBuffer getEncodeData(const std::span<const uint32_t> &obj);
+    MMBuffer getEncodeData(const std::span<const int64_t> &obj);
+    MMBuffer getEncodeData(const std::span<const uint64_t> &obj);
+
+    // a fixed-extent span would otherwise prefer the template above to the overloads
+    template <typename T, size_t N>
+        requires(N != std::dynamic_extent)
+    MMBuffer getEncodeData(const std::span<T, N> &obj) {
+        return getEncodeData(std::span<const T>(obj));
+    }
+
+    size_t getEncodeData(const std::vector<bool> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const float> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const double> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const int32_t> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const uint32_t> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const int64_t> &obj, const EncodeReserver &reserve);
+    size_t getEncodeData(const std::span<const uint64_t> &obj, const EncodeReserver &reserve);
+
+    template <typename T, size_t N>
+        requires(N != std::dynamic_extent)
+    size_t getEncodeData(const std::span<T, N> &obj, const EncodeReserver &reserve) {
+        return getEncodeData(std::span<const T>(obj), reserve);
+    }
 #endif // MMKV_HAS_CPP20
 #else
     // NSString, NSData, NSDate
@@ -111,7 +156,16 @@ public:
     // opt encoding a single MMBuffer
     static MMBuffer encodeDataWithObject(const MMBuffer &obj);
 
+    // encode straight into the memory returned by reserve(), skipping the intermediate MMBuffer
+    // return the encoded size, 0 on error or if reserve() returns nullptr
+    template <typename T>
+    static size_t encodeDataWithObject(const T &obj, const EncodeReserver &reserve) {
+        MiniPBCoder pbCoder;
+        return pbCoder.getEncodeData(obj, reserve);
+    }
+
     // return empty result if there's any error
+    // with a position, the records after it are applied onto dic
     static void decodeMap(MMKVMap &dic, const MMBuffer &oData, size_t position = 0);
 
     // decode as much data as possible before any error happens
@@ -133,6 +187,15 @@ public:
         MiniPBCoder oCoder(&oData);
         return oCoder.decodeOneVector(result);
     }
+
+#ifdef MMKV_HAS_CPP20
+    // integers stored as fixed-width little-endian, encoding & decoding are a memcpy
+    // larger than varints for small values, decodeVector() reads both formats
+    static MMBuffer encodeFixedWidthVector(const std::span<const int32_t> &obj);
+    static MMBuffer encodeFixedWidthVector(const std::span<const uint32_t> &obj);
+    static MMBuffer encodeFixedWidthVector(const std::span<const int64_t> &obj);
+    static MMBuffer encodeFixedWidthVector(const std::span<const uint64_t> &obj);
+#endif
 #else
     // NSString, NSData, NSDate
     static NSObject *decodeObject(const MMBuffer &oData, Class cls);
@@ -47,10 +47,13 @@ void ThreadLock::lock() {
     auto ret = pthread_mutex_lock(&m_lock);
     if (ret != 0) {
         MMKVError("fail to lock %p, ret=%d, errno=%s", &m_lock, ret, strerror(errno));
+        return;
     }
+    m_lockDepth++;
 }
 
 void ThreadLock::unlock() {
+    m_lockDepth--;
     auto ret = pthread_mutex_unlock(&m_lock);
     if (ret != 0) {
         MMKVError("fail to unlock %p, ret=%d, errno=%s", &m_lock, ret, strerror(errno));
@@ -59,7 +62,11 @@ void ThreadLock::unlock() {
 
 bool ThreadLock::try_lock() {
     auto ret = pthread_mutex_trylock(&m_lock);
-    return (ret == 0);
+    if (ret != 0) {
+        return false;
+    }
+    m_lockDepth++;
+    return true;
 }
 
 void ThreadLock::initialize() {
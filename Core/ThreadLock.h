@@ -50,6 +50,8 @@ class ThreadLock {
 #else
     CRITICAL_SECTION m_lock;
 #endif
+    // how many times the owner thread holds the lock, only touched by the owner
+    int m_lockDepth = 0;
 
 public:
     ThreadLock();
@@ -59,10 +61,10 @@ public:
 
     void lock();
     void unlock();
-
-#ifndef MMKV_WIN32
     bool try_lock();
-#endif
+
+    // whether the current thread, which holds the lock, held it before the last lock()/try_lock()
+    bool isHeldRecursively() const { return m_lockDepth > 1; }
 
     static void ThreadOnce(ThreadOnceToken_t *onceToken, void (*callback)(void));
 
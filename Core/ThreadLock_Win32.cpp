@@ -44,12 +44,22 @@ void ThreadLock::initialize() {
 
 void ThreadLock::lock() {
     EnterCriticalSection(&m_lock);
+    m_lockDepth++;
 }
 
 void ThreadLock::unlock() {
+    m_lockDepth--;
     LeaveCriticalSection(&m_lock);
 }
 
+bool ThreadLock::try_lock() {
+    if (!TryEnterCriticalSection(&m_lock)) {
+        return false;
+    }
+    m_lockDepth++;
+    return true;
+}
+
 void ThreadLock::ThreadOnce(ThreadOnceToken_t *onceToken, void (*callback)()) {
     if (!onceToken || !callback) {
         assert(onceToken);
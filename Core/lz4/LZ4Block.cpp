@@ -0,0 +1,265 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2026 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LZ4Block.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#ifdef MMKV_HAS_CPP20
+#    include <bit>
+#endif
+
+namespace mmkv {
+
+constexpr size_t MinMatch = 4;
+// the last match must start at least 12 bytes before the end, the last 5 bytes are always literals
+constexpr size_t MatchFindLimit = 12;
+constexpr size_t LastLiterals = 5;
+constexpr size_t MaxOffset = 65535;
+constexpr uint32_t HashLog = 12;
+// search faster on data that doesn't compress
+constexpr uint32_t SkipTrigger = 6;
+constexpr size_t WildCopySize = 16;
+
+static inline uint32_t read32(const uint8_t *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read64(const uint8_t *ptr) {
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+// the end of the common bytes of ip & ref, no further than limit
+static inline const uint8_t *extendMatch(const uint8_t *ip, const uint8_t *ref, const uint8_t *limit) {
+#ifdef MMKV_HAS_CPP20
+    if constexpr (std::endian::native == std::endian::little) {
+        while (ip + sizeof(uint64_t) <= limit) {
+            auto diff = read64(ip) ^ read64(ref);
+            if (diff) {
+                return ip + std::countr_zero(diff) / 8;
+            }
+            ip += sizeof(uint64_t);
+            ref += sizeof(uint64_t);
+        }
+    }
+#endif
+    while (ip < limit && *ip == *ref) {
+        ip++;
+        ref++;
+    }
+    return ip;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HashLog);
+}
+
+// 15 in the token, followed by 255s and the remainder
+static inline uint8_t *writeLength(uint8_t *op, size_t length) {
+    length -= 15;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+static inline size_t lengthBytes(size_t length) {
+    return (length >= 15) ? (length - 15) / 255 + 1 : 0;
+}
+
+size_t lz4Compress(const void *src, size_t srcSize, void *dst, size_t dstCapacity) {
+    auto base = static_cast<const uint8_t *>(src);
+    auto ip = base;
+    auto anchor = base;
+    auto iend = base + srcSize;
+    auto op = static_cast<uint8_t *>(dst);
+    auto oend = op + dstCapacity;
+
+    if (srcSize > MatchFindLimit) {
+        const uint8_t *mflimit = iend - MatchFindLimit;
+        const uint8_t *matchLimit = iend - LastLiterals;
+        // offsets from base, a stale or empty slot is rejected by comparing the bytes
+        uint32_t table[1 << HashLog] = {};
+
+        ip++;
+        uint32_t searchCount = 1 << SkipTrigger;
+        while (ip < mflimit) {
+            auto h = hashSequence(read32(ip));
+            auto ref = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+            if (ref >= ip || static_cast<size_t>(ip - ref) > MaxOffset || read32(ref) != read32(ip)) {
+                ip += searchCount++ >> SkipTrigger;
+                continue;
+            }
+            searchCount = 1 << SkipTrigger;
+
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            auto matchEnd = extendMatch(ip + MinMatch, ref + MinMatch, matchLimit);
+
+            auto literalLength = static_cast<size_t>(ip - anchor);
+            auto matchLength = static_cast<size_t>(matchEnd - ip) - MinMatch;
+            size_t needed = 1 + lengthBytes(literalLength) + literalLength + 2 + lengthBytes(matchLength);
+            if (needed > static_cast<size_t>(oend - op)) {
+                return 0;
+            }
+            auto token = op++;
+            if (literalLength >= 15) {
+                *token = 15 << 4;
+                op = writeLength(op, literalLength);
+            } else {
+                *token = static_cast<uint8_t>(literalLength << 4);
+            }
+            memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            auto offset = static_cast<size_t>(ip - ref);
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (matchLength >= 15) {
+                *token |= 15;
+                op = writeLength(op, matchLength);
+            } else {
+                *token |= static_cast<uint8_t>(matchLength);
+            }
+
+            ip = matchEnd;
+            anchor = ip;
+            // the positions skipped by the match are worth remembering for the next ones
+            if (ip < mflimit) {
+                table[hashSequence(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+
+    auto literalLength = static_cast<size_t>(iend - anchor);
+    if (1 + lengthBytes(literalLength) + literalLength > static_cast<size_t>(oend - op)) {
+        return 0;
+    }
+    if (literalLength >= 15) {
+        *op++ = 15 << 4;
+        op = writeLength(op, literalLength);
+    } else {
+        *op++ = static_cast<uint8_t>(literalLength << 4);
+    }
+    memcpy(op, anchor, literalLength);
+    op += literalLength;
+    return static_cast<size_t>(op - static_cast<uint8_t *>(dst));
+}
+
+static inline bool readLength(const uint8_t *&ip, const uint8_t *iend, size_t &length) {
+    uint8_t byte;
+    do {
+        if (ip >= iend) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4Decompress(const void *src, size_t srcSize, void *dst, size_t dstSize) {
+    auto ip = static_cast<const uint8_t *>(src);
+    auto iend = ip + srcSize;
+    auto begin = static_cast<uint8_t *>(dst);
+    auto op = begin;
+    auto oend = op + dstSize;
+
+    while (true) {
+        if (ip >= iend) {
+            return false;
+        }
+        auto token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, iend, literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        // short literals are copied 16 bytes at once while there's room on both sides
+        if (literalLength <= WildCopySize && static_cast<size_t>(iend - ip) >= WildCopySize &&
+            static_cast<size_t>(oend - op) >= WildCopySize) {
+            memcpy(op, ip, WildCopySize);
+        } else {
+            memcpy(op, ip, literalLength);
+        }
+        op += literalLength;
+        ip += literalLength;
+        // the last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - begin)) {
+            return false;
+        }
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, iend, matchLength)) {
+            return false;
+        }
+        matchLength += MinMatch;
+        if (matchLength > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        // the match may overlap the output, copy it offset bytes at a time
+        auto match = op - offset;
+        if (offset == 1) {
+            memset(op, *match, matchLength);
+            op += matchLength;
+            continue;
+        }
+        if (offset >= sizeof(uint64_t) && static_cast<size_t>(oend - op) >= matchLength + sizeof(uint64_t)) {
+            // the 8 bytes of a copy never overlap, it may write up to 7 bytes past the match
+            auto end = op + matchLength;
+            while (op < end) {
+                memcpy(op, match, sizeof(uint64_t));
+                op += sizeof(uint64_t);
+                match += sizeof(uint64_t);
+            }
+            op = end;
+            continue;
+        }
+        while (matchLength > 0) {
+            auto chunk = std::min(offset, matchLength);
+            memcpy(op, match, chunk);
+            op += chunk;
+            match += chunk;
+            matchLength -= chunk;
+        }
+    }
+    return op == oend;
+}
+
+} // namespace mmkv
@@ -0,0 +1,47 @@
+/*
+ * Tencent is pleased to support the open source community by making
+ * MMKV available.
+ *
+ * Copyright (C) 2026 THL A29 Limited, a Tencent company.
+ * All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use
+ * this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ *       https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MMKV_LZ4BLOCK_H
+#define MMKV_LZ4BLOCK_H
+#ifdef __cplusplus
+
+#include "../MMKVPredef.h"
+#include <cstddef>
+
+namespace mmkv {
+
+// the LZ4 block format (no frame, no checksum), compatible with LZ4_compress_default() & LZ4_decompress_safe()
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+// the worst case of compressing size bytes
+constexpr size_t lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// return the compressed size, 0 if it doesn't fit in dstCapacity
+size_t lz4Compress(const void *src, size_t srcSize, void *dst, size_t dstCapacity);
+
+// return false if src is malformed or doesn't decompress to exactly dstSize bytes
+bool lz4Decompress(const void *src, size_t srcSize, void *dst, size_t dstSize);
+
+} // namespace mmkv
+
+#endif // __cplusplus
+#endif // MMKV_LZ4BLOCK_H
@@ -18,8 +18,13 @@
  * limitations under the License.
  */
 
+#include "CodedInputData.h"
 #include "InterProcessLock.h"
 #include "MMKV.h"
+#include "MMKVNamespace.h"
+#include "MemoryFile.h"
+#include "MiniPBCoder.h"
+#include "lz4/LZ4Block.h"
 #include <chrono>
 #include <cstdio>
 #include <iostream>
@@ -27,6 +32,8 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <string>
+#include <fcntl.h>
+#include <sys/file.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -36,6 +43,10 @@
 #include <cassert>
 #include <ctime>
 #include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <cinttypes> // For PRId64 & PRIu64
 
 using namespace std;
@@ -553,7 +564,7 @@ void testAutoExpiration() {
     }
 
     mmkv->removeValueForKey("never_expire_key_1");
-    mmkv->enableAutoKeyExpire(MMKV::ExpireNever);
+    mmkv->enableAutoKeyExpire();
     mmkv->set("never_expire_value_1", "never_expire_key_1");
     mmkv->set(true, "auto_expire_key_1", 1);
     sleep(2);
@@ -1264,6 +1275,2530 @@ void testReadOnly() {
     setReadOnly(crcPath, false);
 }
 
+void testLoadFromSnapshot() {
+    string mmapID = "testLoadFromSnapshot";
+    const int keyCount = 5000;
+    {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        mmkv->clearAll();
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(i, "int-" + to_string(i));
+        }
+        // a full write back leaves a snapshot behind
+        mmkv->removeValuesForKeys({"int-0", "int-1"});
+        // something appended after the snapshot
+        mmkv->set("appended", "string-0");
+        mmkv->removeValueForKey("int-2");
+        mmkv->set(-3, "int-3");
+        mmkv->close();
+    }
+
+    auto snapshotPath = MMKV::getRootDir() + MMKV_PATH_SLASH + mmapID + ".snapshot";
+    if (access(snapshotPath.c_str(), F_OK) != 0) {
+        abort();
+    }
+    {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        if (mmkv->count() != keyCount - 3 + 1) {
+            abort();
+        }
+        if (mmkv->containsKey("int-0") || mmkv->containsKey("int-2")) {
+            abort();
+        }
+        if (mmkv->getInt32("int-3") != -3 || mmkv->getInt32("int-" + to_string(keyCount - 1)) != keyCount - 1) {
+            abort();
+        }
+        string value;
+        if (!mmkv->getString("string-0", value) || value != "appended") {
+            abort();
+        }
+        // overridden from offset 0 with the same sequence, the snapshot must not be trusted
+        mmkv->clearAll();
+        mmkv->set(1, "int-1");
+        mmkv->close();
+    }
+    {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        if (mmkv->count() != 1 || mmkv->getInt32("int-1") != 1) {
+            abort();
+        }
+        mmkv->close();
+    }
+    MMKV::removeStorage(mmapID);
+    if (access(snapshotPath.c_str(), F_OK) == 0) {
+        abort();
+    }
+    printf("testLoadFromSnapshot passed\n");
+}
+
+void testSnapshotLoadSpeed() {
+    string mmapID = "testSnapshotLoadSpeed";
+    auto snapshotPath = MMKV::getRootDir() + MMKV_PATH_SLASH + mmapID + ".snapshot";
+    for (int keyCount : {10000, 100000, 1000000}) {
+        {
+            auto mmkv = MMKV::mmkvWithID(mmapID);
+            mmkv->clearAll();
+            for (int i = 0; i < keyCount; i++) {
+                mmkv->set(i, "int-" + to_string(i));
+            }
+            mmkv->trim();
+            mmkv->removeValueForKey("int-0");
+            mmkv->removeValuesForKeys({"int-1"});
+            mmkv->close();
+        }
+
+        auto start1 = getTimeInMs();
+        {
+            auto mmkv = MMKV::mmkvWithID(mmapID);
+            mmkv->count();
+            mmkv->close();
+        }
+        auto end1 = getTimeInMs();
+
+        ::unlink(snapshotPath.c_str());
+        auto start2 = getTimeInMs();
+        {
+            auto mmkv = MMKV::mmkvWithID(mmapID);
+            mmkv->count();
+            mmkv->close();
+        }
+        auto end2 = getTimeInMs();
+        printf("%d keys: load with snapshot = %" PRId64 ", without snapshot = %" PRId64 "\n", keyCount, end1 - start1,
+               end2 - start2);
+    }
+    MMKV::removeStorage(mmapID);
+}
+
+void testParallelDecode() {
+    string mmapID = "testParallelDecode";
+    // large enough to be decoded on multiple threads
+    const int keyCount = 200000;
+    string value(40, 'v');
+    {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        mmkv->clearAll();
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < keyCount; i++) {
+                mmkv->set(value + to_string(i + round), "key-" + to_string(i));
+            }
+        }
+        // deleted in a later chunk, re-added in an even later one
+        for (int i = 0; i < keyCount; i += 10) {
+            mmkv->removeValueForKey("key-" + to_string(i));
+        }
+        for (int i = 0; i < keyCount; i += 20) {
+            mmkv->set(i, "key-" + to_string(i));
+        }
+        mmkv->close();
+    }
+    // make sure the whole file is decoded
+    auto snapshotPath = MMKV::getRootDir() + MMKV_PATH_SLASH + mmapID + ".snapshot";
+    ::unlink(snapshotPath.c_str());
+    {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        if (mmkv->count() != keyCount - keyCount / 10 + keyCount / 20) {
+            abort();
+        }
+        string result;
+        for (int i = 0; i < keyCount; i++) {
+            auto key = "key-" + to_string(i);
+            if (i % 20 == 0) {
+                if (mmkv->getInt32(key) != i) {
+                    abort();
+                }
+            } else if (i % 10 == 0) {
+                if (mmkv->containsKey(key)) {
+                    abort();
+                }
+            } else if (!mmkv->getString(key, result) || result != value + to_string(i + 1)) {
+                abort();
+            }
+        }
+        mmkv->close();
+    }
+    MMKV::removeStorage(mmapID);
+    printf("testParallelDecode passed\n");
+}
+
+void testEnumerate() {
+    string aesKey = "enumerateKey";
+    for (auto cryptKey : {(string *) nullptr, &aesKey}) {
+        auto mmkv = MMKV::mmkvWithID("testEnumerate", MMKV_SINGLE_PROCESS, cryptKey);
+        mmkv->clearAll();
+        mmkv->enableAutoKeyExpire();
+        const int keyCount = 100;
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(i, "int-" + to_string(i));
+            mmkv->set("string-" + to_string(i), "string-" + to_string(i));
+        }
+        mmkv->set(true, "expired", 1);
+        sleep(2);
+
+        size_t total = 0;
+        auto count = mmkv->enumerate([&](string_view key, const MMBuffer &value) {
+            if (key == "expired" || value.length() == 0) {
+                abort();
+            }
+            total++;
+            return true;
+        });
+        if (count != keyCount * 2 || total != count) {
+            abort();
+        }
+
+        int64_t sum = 0;
+        mmkv->enumerate<int32_t>([&](string_view key, const int32_t &value) {
+            if (key.substr(0, 4) == "int-") {
+                sum += value;
+            }
+            return true;
+        });
+        if (sum != keyCount * (keyCount - 1) / 2) {
+            abort();
+        }
+
+        size_t matched = 0;
+        mmkv->enumerate<string_view>([&](string_view key, const string_view &value) {
+            if (key.substr(0, 7) == "string-") {
+                if (key != value) {
+                    abort();
+                }
+                matched++;
+            }
+            return true;
+        });
+        if (matched != keyCount) {
+            abort();
+        }
+
+        // stop early
+        count = mmkv->enumerate([](string_view, const MMBuffer &) { return false; });
+        if (count != 1) {
+            abort();
+        }
+        mmkv->disableAutoKeyExpire();
+        mmkv->close();
+    }
+    MMKV::removeStorage("testEnumerate");
+    printf("testEnumerate passed\n");
+}
+
+void testEnumerateSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testEnumerateSpeed");
+    const int keyCount = 200000;
+    if (mmkv->count() != keyCount) {
+        mmkv->clearAll();
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set("string-value-" + to_string(i), "string-" + to_string(i));
+        }
+    }
+
+    auto start1 = getTimeInMs();
+    size_t totalLength1 = 0;
+    string result;
+    for (const auto &key : mmkv->allKeys()) {
+        if (mmkv->getString(key, result)) {
+            totalLength1 += result.length();
+        }
+    }
+    auto end1 = getTimeInMs();
+
+    auto start2 = getTimeInMs();
+    size_t totalLength2 = 0;
+    mmkv->enumerate<string_view>([&](string_view, const string_view &value) {
+        totalLength2 += value.length();
+        return true;
+    });
+    auto end2 = getTimeInMs();
+    printf("allKeys + getString = %" PRId64 ", enumerate = %" PRId64 ", %zu, %zu\n", end1 - start1, end2 - start2,
+           totalLength1, totalLength2);
+}
+
+void testScanPrefix() {
+    string aesKey = "scanKey";
+    for (auto cryptKey : {(string *) nullptr, &aesKey}) {
+        for (bool useIndex : {false, true}) {
+            auto mmkv = MMKV::mmkvWithID("testScanPrefix", MMKV_SINGLE_PROCESS, cryptKey);
+            mmkv->clearAll();
+            if (useIndex) {
+                mmkv->enableKeyIndex();
+            }
+            for (int user = 0; user < 20; user++) {
+                auto prefix = "user:" + to_string(user) + ":";
+                mmkv->set("name" + to_string(user), prefix + "name");
+                mmkv->set(user, prefix + "age");
+                mmkv->set(true, prefix + "vip");
+            }
+            mmkv->set("other", "user;");
+
+            vector<string> keys;
+            auto count = mmkv->scanPrefix("user:1:", [&](string_view key, const MMBuffer &) {
+                keys.emplace_back(key);
+                return true;
+            });
+            if (count != 3 || keys != vector<string>{"user:1:age", "user:1:name", "user:1:vip"}) {
+                abort();
+            }
+
+            // index kept up to date by set & remove
+            mmkv->set(1, "user:1:level");
+            mmkv->removeValueForKey("user:1:vip");
+            keys.clear();
+            mmkv->scanPrefix("user:1:", [&](string_view key, const MMBuffer &) {
+                keys.emplace_back(key);
+                return true;
+            });
+            if (keys != vector<string>{"user:1:age", "user:1:level", "user:1:name"}) {
+                abort();
+            }
+
+            // [user:10:, user:12:) => user 10 & 11
+            count = mmkv->scanRange("user:10:", "user:12:", [](string_view, const MMBuffer &) { return true; });
+            if (count != 6) {
+                abort();
+            }
+
+            if (mmkv->removeValuesWithPrefix("user:1") != 3 + 3 * 10) {
+                abort();
+            }
+            // reload from file, the index should be rebuilt
+            mmkv->clearMemoryCache();
+            count = mmkv->scanPrefix("user:", [](string_view key, const MMBuffer &) {
+                if (key.substr(0, 6) == "user:1") {
+                    abort();
+                }
+                return true;
+            });
+            if (count != 3 * 9 || mmkv->count() != 3 * 9 + 1) {
+                abort();
+            }
+            mmkv->close();
+        }
+    }
+    MMKV::removeStorage("testScanPrefix");
+    printf("testScanPrefix passed\n");
+}
+
+void testScanPrefixSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testScanPrefixSpeed");
+    const int userCount = 50000;
+    if (mmkv->count() != userCount * 4) {
+        mmkv->clearAll();
+        for (int user = 0; user < userCount; user++) {
+            auto prefix = "user:" + to_string(user) + ":";
+            mmkv->set("name" + to_string(user), prefix + "name");
+            mmkv->set(user, prefix + "age");
+            mmkv->set(true, prefix + "vip");
+            mmkv->set("address" + to_string(user), prefix + "address");
+        }
+    }
+
+    size_t total = 0;
+    auto start1 = getTimeInMs();
+    for (int user = 0; user < 1000; user++) {
+        auto prefix = "user:" + to_string(user) + ":";
+        for (const auto &key : mmkv->allKeys()) {
+            if (key.compare(0, prefix.length(), prefix) == 0) {
+                total++;
+            }
+        }
+    }
+    auto end1 = getTimeInMs();
+
+    mmkv->enableKeyIndex();
+    auto start2 = getTimeInMs();
+    for (int user = 0; user < 1000; user++) {
+        auto prefix = "user:" + to_string(user) + ":";
+        total += mmkv->scanPrefix(prefix, [](string_view, const MMBuffer &) { return true; });
+    }
+    auto end2 = getTimeInMs();
+    printf("allKeys + filter = %" PRId64 ", scanPrefix = %" PRId64 ", %zu\n", end1 - start1, end2 - start2, total);
+}
+
+void testExpireIndex() {
+    string aesKey = "expireIndexKey";
+    string bigValue(1000, 'b');
+    for (auto cryptKey : {(string *) nullptr, &aesKey}) {
+        auto mmkv = MMKV::mmkvWithID("testExpireIndex", MMKV_SINGLE_PROCESS, cryptKey);
+        mmkv->clearAll();
+        mmkv->enableAutoKeyExpire();
+        mmkv->enableKeyIndex();
+        const int keyCount = 100;
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(i, "never-" + to_string(i));
+            mmkv->set(i, "short-" + to_string(i), 1);
+            mmkv->set(bigValue, "big-" + to_string(i), 1);
+            mmkv->set(i, "long-" + to_string(i), 1000);
+        }
+        // build the index
+        if (mmkv->count(true) != keyCount * 4) {
+            abort();
+        }
+        // renewed, removed, or re-added after the index is built
+        mmkv->set(-1, "short-0", MMKV::ExpireNever);
+        mmkv->set(bigValue, "big-0", 1000);
+        mmkv->set(-1, "long-0", 1);
+        mmkv->removeValueForKey("short-1");
+        mmkv->set(1, "added", 1);
+        sleep(2);
+
+        size_t expected = keyCount + 2 + (keyCount - 1);
+        if (mmkv->count(true) != expected) {
+            abort();
+        }
+        if (!mmkv->containsKey("short-0") || !mmkv->containsKey("big-0") || mmkv->containsKey("long-0") ||
+            mmkv->containsKey("added") || mmkv->containsKey("big-1")) {
+            abort();
+        }
+        // the key index is in sync
+        if (mmkv->scanPrefix("big-", [](string_view, const MMBuffer &) { return true; }) != 1) {
+            abort();
+        }
+
+        // rebuilt after reloading
+        mmkv->set(1, "short-1", 1);
+        mmkv->clearMemoryCache();
+        sleep(2);
+        if (mmkv->count(true) != expected) {
+            abort();
+        }
+        mmkv->disableAutoKeyExpire();
+        mmkv->close();
+    }
+    MMKV::removeStorage("testExpireIndex");
+    printf("testExpireIndex passed\n");
+}
+
+void testExpireReaper() {
+    auto mmkv = MMKV::mmkvWithID("testExpireReaper");
+    mmkv->clearAll();
+    mmkv->enableAutoKeyExpire();
+    const int keyCount = 50;
+    for (int i = 0; i < keyCount; i++) {
+        mmkv->set(i, "expire-" + to_string(i), 1);
+    }
+    for (int i = 0; i < 10; i++) {
+        mmkv->set(i, "never-" + to_string(i));
+    }
+
+    // reading an expired key writes nothing while the reaper is running
+    MMKV::startExpireReaper(60);
+    sleep(2);
+    auto actualSize = mmkv->actualSize();
+    if (mmkv->getInt32("expire-0", -1) != -1 || mmkv->actualSize() != actualSize || mmkv->count() != keyCount + 10) {
+        abort();
+    }
+    MMKV::stopExpireReaper();
+
+    // 20 keys per second
+    MMKV::startExpireReaper(1, 20, 1000);
+    if (!MMKV::isExpireReaperRunning()) {
+        abort();
+    }
+    sleep(5);
+    MMKV::stopExpireReaper();
+    if (mmkv->count() != 10 || mmkv->getInt32("never-9") != 9 || MMKV::isExpireReaperRunning()) {
+        abort();
+    }
+    mmkv->clearMemoryCache();
+    if (mmkv->count() != 10) {
+        abort();
+    }
+
+    mmkv->disableAutoKeyExpire();
+    mmkv->close();
+    MMKV::removeStorage("testExpireReaper");
+
+    // an instance locked by another process is skipped, other instances stay available
+    string mmapID = "testExpireReaperLocked";
+    mmkv = MMKV::mmkvWithID(mmapID, MMKV_MULTI_PROCESS);
+    mmkv->clearAll();
+    mmkv->enableAutoKeyExpire();
+    mmkv->set(1, "expire", 1);
+    auto fd = open((MMKV::getRootDir() + MMKV_PATH_SLASH + mmapID + ".crc").c_str(), O_RDWR);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+        abort();
+    }
+    MMKV::startExpireReaper(1);
+    sleep(2);
+    auto start = getTimeInMs();
+    auto other = MMKV::mmkvWithID("testExpireReaperOther");
+    other->close();
+    if (getTimeInMs() - start > 500) {
+        abort();
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+    sleep(2);
+    MMKV::stopExpireReaper();
+    if (mmkv->count() != 0) {
+        abort();
+    }
+    mmkv->disableAutoKeyExpire();
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+    MMKV::removeStorage("testExpireReaperOther");
+    printf("testExpireReaper passed\n");
+}
+
+void testIncrement() {
+    string aesKey = "incrementKey";
+    for (auto cryptKey : {(string *) nullptr, &aesKey}) {
+        auto mmkv = MMKV::mmkvWithID("testIncrement", MMKV_SINGLE_PROCESS, cryptKey);
+        mmkv->clearAll();
+        mmkv->set((int64_t) 5, "int64");
+        int64_t int64Value = 0;
+        mmkv->incrementInt64("int64", 1, &int64Value);
+        auto actualSize = mmkv->actualSize();
+        for (int i = 0; i < 1000; i++) {
+            mmkv->incrementInt64("int64", -2, &int64Value);
+        }
+        // written in place
+        if (int64Value != 6 - 2000 || mmkv->getInt64("int64") != int64Value || (!cryptKey && mmkv->actualSize() != actualSize)) {
+            abort();
+        }
+
+        uint64_t uint64Value = 0;
+        mmkv->incrementUInt64("uint64", numeric_limits<uint64_t>::max());
+        mmkv->incrementUInt64("uint64", 2, &uint64Value);
+        if (uint64Value != 1 || mmkv->getUInt64("uint64") != 1) {
+            abort();
+        }
+
+        double doubleValue = 0;
+        for (int i = 0; i < 100; i++) {
+            mmkv->incrementDouble("double", 0.5, &doubleValue);
+        }
+        if (doubleValue != 50 || mmkv->getDouble("double") != 50) {
+            abort();
+        }
+
+        // survives reloading, the crc digest is kept in sync
+        mmkv->clearMemoryCache();
+        if (mmkv->getInt64("int64") != 6 - 2000 || mmkv->getUInt64("uint64") != 1 || mmkv->getDouble("double") != 50) {
+            abort();
+        }
+        mmkv->close();
+        mmkv = MMKV::mmkvWithID("testIncrement", MMKV_SINGLE_PROCESS, cryptKey);
+        if (mmkv->getInt64("int64") != 6 - 2000 || mmkv->count() != 3) {
+            abort();
+        }
+
+        // a full write back confirms the data, which is appended to once instead of rewritten
+        mmkv->removeValuesForKeys({"uint64", "none"});
+        actualSize = mmkv->actualSize();
+        mmkv->incrementInt64("int64", 2000);
+        auto appendedSize = mmkv->actualSize();
+        mmkv->incrementInt64("int64", 1);
+        if (appendedSize <= actualSize || (!cryptKey && mmkv->actualSize() != appendedSize) ||
+            mmkv->getInt64("int64") != 7) {
+            abort();
+        }
+
+        // counters expire like any other value
+        mmkv->enableAutoKeyExpire(1);
+        mmkv->incrementInt64("int64");
+        sleep(2);
+        mmkv->incrementInt64("int64");
+        if (mmkv->getInt64("int64") != 1 || mmkv->containsKey("double")) {
+            abort();
+        }
+        mmkv->disableAutoKeyExpire();
+        mmkv->close();
+        MMKV::removeStorage("testIncrement");
+    }
+    printf("testIncrement passed\n");
+}
+
+void testIncrementSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testIncrementSpeed");
+    mmkv->clearAll();
+    const int keyCount = 2000;
+    const int loops = 100000;
+    vector<string> keys;
+    for (int i = 0; i < keyCount; i++) {
+        keys.push_back("counter-" + to_string(i));
+    }
+
+    auto start1 = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        auto &key = keys[i % keyCount];
+        mmkv->set(mmkv->getInt64(key) + 1, key);
+    }
+    auto end1 = getTimeInMs();
+    auto size1 = mmkv->actualSize();
+
+    auto start2 = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        mmkv->incrementInt64(keys[i % keyCount]);
+    }
+    auto end2 = getTimeInMs();
+    printf("getInt64 + set = %" PRId64 " ms (%zu bytes), incrementInt64 = %" PRId64 " ms (%zu bytes)\n", end1 - start1,
+           size1, end2 - start2, mmkv->actualSize());
+}
+
+void testCompareAndSet() {
+    auto mmkv = MMKV::mmkvWithID("testCompareAndSet");
+    mmkv->clearAll();
+
+    int32_t observed = 0;
+    bool hasObserved = true;
+    if (mmkv->compareAndSet("int32", 0, 1, &observed, &hasObserved) || hasObserved) {
+        abort();
+    }
+    mmkv->set(1, "int32");
+    if (!mmkv->compareAndSet("int32", 1, 2) || mmkv->compareAndSet("int32", 1, 3, &observed) || observed != 2) {
+        abort();
+    }
+    int32_t oldValue = 0;
+    if (!mmkv->exchange("int32", 4, &oldValue) || oldValue != 2 || mmkv->getInt32("int32") != 4) {
+        abort();
+    }
+
+    string observedString;
+    bool hasOldValue = true;
+    mmkv->exchange("string", string("owner-1"), &observedString, &hasOldValue);
+    if (hasOldValue || mmkv->compareAndSet("string", string("owner-2"), string("owner-3"), &observedString) ||
+        observedString != "owner-1" || !mmkv->compareAndSet("string", string("owner-1"), string("owner-2"))) {
+        abort();
+    }
+
+    MMBuffer observedBuffer;
+    mmkv->set(MMBuffer((void *) "abc", 3), "bytes");
+    if (!mmkv->compareAndSet("bytes", MMBuffer((void *) "abc", 3), MMBuffer((void *) "abcd", 4)) ||
+        mmkv->compareAndSet("bytes", MMBuffer((void *) "abc", 3), MMBuffer(), &observedBuffer) ||
+        observedBuffer != MMBuffer((void *) "abcd", 4)) {
+        abort();
+    }
+
+    vector<string> observedVector;
+    mmkv->set(vector<string>{"a", "b"}, "vector");
+    if (!mmkv->compareAndSet("vector", vector<string>{"a", "b"}, vector<string>{"c"}) ||
+        !mmkv->exchange("vector", vector<string>{}, &observedVector) || observedVector != vector<string>{"c"}) {
+        abort();
+    }
+
+    // only a missing key is created
+    if (!mmkv->setIfAbsent("created", string("first")) ||
+        mmkv->setIfAbsent("created", string("second"), &observedString) || observedString != "first" ||
+        mmkv->setIfAbsent("int32", 5, &observed) || observed != 4 || mmkv->getInt32("int32") != 4) {
+        abort();
+    }
+
+    // a counter shared by processes
+    mmkv->close();
+    auto kv = MMKV::mmkvWithID("testCompareAndSetMP", MMKV_MULTI_PROCESS);
+    kv->set((int64_t) 0, "counter");
+    kv->close();
+    constexpr auto processCount = 2;
+    constexpr auto loops = 200;
+    pid_t processHandles[processCount] = {0};
+    for (int &processHandle : processHandles) {
+        auto pid = fork();
+        if (pid == 0) {
+            kv = MMKV::mmkvWithID("testCompareAndSetMP", MMKV_MULTI_PROCESS);
+            for (int i = 0; i < loops; i++) {
+                auto value = kv->getInt64("counter");
+                while (!kv->compareAndSet("counter", value, value + 1, &value)) {
+                }
+            }
+            _exit(0);
+        }
+        processHandle = pid;
+    }
+    for (int &processHandle : processHandles) {
+        waitpid(processHandle, nullptr, 0);
+    }
+    kv = MMKV::mmkvWithID("testCompareAndSetMP", MMKV_MULTI_PROCESS);
+    if (kv->getInt64("counter") != processCount * loops) {
+        printf("testCompareAndSet counter = %" PRId64 "\n", kv->getInt64("counter"));
+        abort();
+    }
+    kv->close();
+    MMKV::removeStorage("testCompareAndSetMP");
+    MMKV::removeStorage("testCompareAndSet");
+    printf("testCompareAndSet passed\n");
+}
+
+void testList() {
+    auto mmkv = MMKV::mmkvWithID("testList");
+    mmkv->clearAll();
+    for (int i = 0; i < 10; i++) {
+        mmkv->listPushBack("events", "event-" + to_string(i));
+    }
+    string item;
+    if (!mmkv->listPopFront("events", &item) || item != "event-0" || mmkv->listSize("events") != 9) {
+        abort();
+    }
+    vector<string> items;
+    if (!mmkv->listRange("events", 1, 3, items) || items != vector<string>{"event-2", "event-3", "event-4"}) {
+        abort();
+    }
+    if (!mmkv->listRange("events", 8, 100, items) || items != vector<string>{"event-9"}) {
+        abort();
+    }
+
+    // not a list
+    mmkv->set(1, "int");
+    if (mmkv->listPushBack("int", "item") || mmkv->listSize("int") != 0) {
+        abort();
+    }
+    uint8_t bytes[20] = {};
+    mmkv->set(MMBuffer(bytes, sizeof(bytes), MMBufferNoCopy), "bytes");
+    if (mmkv->listPushBack("bytes", "item") || mmkv->listSize("bytes") != 0 || mmkv->removeList("bytes")) {
+        abort();
+    }
+    mmkv->removeValueForKey("bytes");
+
+    // the elements are not keys of their own
+    size_t visited = 0;
+    mmkv->enumerate([&](string_view, const MMBuffer &) {
+        visited++;
+        return true;
+    });
+    auto keys = mmkv->allKeys();
+    sort(keys.begin(), keys.end());
+    if (mmkv->count() != 2 || keys != vector<string>{"events", "int"} || visited != 2 ||
+        mmkv->scanPrefix("", [](string_view, const MMBuffer &) { return true; }) != 2) {
+        abort();
+    }
+
+    // the elements go with the list, whichever way it's removed
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 10; i++) {
+            mmkv->listPushBack("removed", "item-" + to_string(i));
+        }
+        if (round == 0) {
+            mmkv->removeValueForKey("removed");
+        } else if (round == 1) {
+            mmkv->removeValuesForKeys({"removed", "none"});
+        } else {
+            mmkv->removeValuesWithPrefix("remove");
+        }
+        if (mmkv->listSize("removed") != 0 || mmkv->count() != 2) {
+            abort();
+        }
+    }
+
+    // kept in a frozen file
+    auto frozenID = string("testListFrozen");
+    if (!mmkv->exportFrozen(frozenID)) {
+        abort();
+    }
+    auto frozen = MMKV::mmkvWithID(frozenID, MMKV_FROZEN);
+    if (!frozen->listRange("events", 0, 100, items) || items.size() != 9 || frozen->count() != 2 ||
+        frozen->allKeys().size() != 2) {
+        abort();
+    }
+    frozen->close();
+    MMKV::removeStorage(frozenID);
+
+    mmkv->trim();
+    mmkv->clearMemoryCache();
+    if (!mmkv->listRange("events", 0, 100, items) || items.size() != 9 || items[0] != "event-1") {
+        abort();
+    }
+    while (mmkv->listPopFront("events")) {
+    }
+    if (mmkv->containsKey("events") || mmkv->count() != 1) {
+        abort();
+    }
+    mmkv->listPushBack("events", "event-10");
+    if (!mmkv->removeList("events") || mmkv->count() != 1) {
+        abort();
+    }
+    // nothing is left behind
+    mmkv->removeValuesForKeys({"int", "none"});
+    if (mmkv->actualSize() > 4) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testList");
+
+    // elements live as long as the list, whose expire date is refreshed on each change
+    mmkv = MMKV::mmkvWithID("testListExpire");
+    mmkv->clearAll();
+    mmkv->enableAutoKeyExpire(4);
+    mmkv->listPushBack("events", "a");
+    sleep(2);
+    mmkv->listPushBack("events", "b");
+    sleep(3);
+    if (mmkv->listSize("events") != 2 || !mmkv->listRange("events", 0, 10, items) ||
+        items != vector<string>{"a", "b"} || !mmkv->listPopFront("events", &item) || item != "a") {
+        abort();
+    }
+    // an expired list takes its elements with it, when filtered or reaped
+    auto isEmptied = [&] {
+        mmkv->set("tmp", "tmp");
+        mmkv->removeValuesForKeys({"tmp", "none"});
+        return mmkv->actualSize() <= 4;
+    };
+    sleep(5);
+    if (mmkv->listSize("events") != 0 || !isEmptied()) {
+        abort();
+    }
+    mmkv->listPushBack("events", "c");
+    sleep(5);
+    MMKV::startExpireReaper(1, 1000, 1000);
+    sleep(2);
+    MMKV::stopExpireReaper();
+    if (mmkv->containsKey("events") || !isEmptied()) {
+        abort();
+    }
+    // a missing element fails instead of being read as empty
+    mmkv->listPushBack("events", "d");
+    mmkv->listPushBack("events", "e");
+    mmkv->removeValueForKey(string("\0\0\0" "0\0" "events", 11));
+    if (mmkv->listPopFront("events", &item) || mmkv->listRange("events", 0, 10, items) || !items.empty()) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testListExpire");
+    printf("testList passed\n");
+}
+
+void testListSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testListSpeed");
+    mmkv->clearAll();
+    const int loops = 5000;
+
+    auto start1 = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        vector<string> events;
+        mmkv->getVector("vector", events);
+        events.push_back("event-" + to_string(i));
+        mmkv->set(events, "vector");
+    }
+    auto end1 = getTimeInMs();
+    auto size1 = mmkv->actualSize();
+    mmkv->clearAll();
+
+    auto start2 = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        mmkv->listPushBack("list", "event-" + to_string(i));
+    }
+    auto end2 = getTimeInMs();
+    printf("vector push = %" PRId64 " ms (%zu bytes), listPushBack = %" PRId64 " ms (%zu bytes)\n", end1 - start1,
+           size1, end2 - start2, mmkv->actualSize());
+}
+
+void testMemoryStats() {
+    string aesKey = "memoryStatsKey";
+    for (auto cryptKey : {(string *) nullptr, &aesKey}) {
+        auto mmkv = MMKV::mmkvWithID("testMemoryStats", MMKV_SINGLE_PROCESS, cryptKey);
+        mmkv->clearAll();
+        const int keyCount = 1000;
+        string value(100, 'v');
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(value, "a-rather-long-key-stored-on-heap-" + to_string(i));
+        }
+        auto stats = mmkv->memoryStats();
+        if (stats.keyBytes < keyCount * 34 || stats.dictionaryBytes < stats.keyBytes || stats.deadBytes != 0 ||
+            stats.mappedBytes < mmkv->totalSize() || stats.residentBytes == 0) {
+            abort();
+        }
+        if ((cryptKey != nullptr) != (stats.cryptValueBytes >= keyCount * value.length())) {
+            abort();
+        }
+
+        for (int i = 0; i < keyCount / 2; i++) {
+            mmkv->set(value, "a-rather-long-key-stored-on-heap-" + to_string(i));
+        }
+        if (mmkv->memoryStats().deadBytes == 0) {
+            abort();
+        }
+        mmkv->trim();
+        if (mmkv->memoryStats().deadBytes != 0 || MMKV::globalMemoryStats().keyBytes < stats.keyBytes) {
+            abort();
+        }
+        mmkv->clearMemoryCache();
+        if (mmkv->memoryStats().mappedBytes != 0) {
+            abort();
+        }
+        mmkv->close();
+        MMKV::removeStorage("testMemoryStats");
+    }
+    printf("testMemoryStats passed\n");
+}
+
+void testMemoryBudget() {
+    const int instanceCount = 5;
+    vector<MMKV *> instances;
+    for (int i = 0; i < instanceCount; i++) {
+        auto mmkv = MMKV::mmkvWithID("testMemoryBudget-" + to_string(i));
+        mmkv->set(i, "index");
+        instances.push_back(mmkv);
+    }
+
+    // the least recently used ones are evicted
+    MMKV::setMemoryBudget(3);
+    auto isLoaded = [](MMKV *mmkv) { return mmkv->memoryStats().mappedBytes > 0; };
+    if (isLoaded(instances[0]) || isLoaded(instances[1]) || !isLoaded(instances[4])) {
+        abort();
+    }
+    // and reloaded on next access
+    if (instances[0]->getInt32("index") != 0 || !isLoaded(instances[0]) || isLoaded(instances[2])) {
+        abort();
+    }
+    if (instances[0]->memoryStats().evictionCount != 1 || MMKV::globalMemoryStats().evictionCount < 3) {
+        abort();
+    }
+
+    // never evicted while enumerating
+    instances[1]->enumerate([&](string_view, const MMBuffer &) {
+        for (int i = 2; i < instanceCount; i++) {
+            instances[i]->getInt32("index");
+        }
+        return true;
+    });
+    if (!isLoaded(instances[1]) || instances[1]->getInt32("index") != 1) {
+        abort();
+    }
+
+    // nor while this thread holds its lock
+    instances[0]->getInt32("index");
+    instances[0]->lock_thread();
+    for (int i = 1; i < instanceCount; i++) {
+        instances[i]->getInt32("index");
+    }
+    if (!isLoaded(instances[0])) {
+        abort();
+    }
+    instances[0]->unlock_thread();
+
+    MMKV::setMemoryBudget(0);
+    for (int i = 0; i < instanceCount; i++) {
+        instances[i]->close();
+        MMKV::removeStorage("testMemoryBudget-" + to_string(i));
+    }
+    printf("testMemoryBudget passed\n");
+}
+
+void testNamespace() {
+    auto container = MMKV::mmkvWithID("testNamespace");
+    container->clearAll();
+    auto user1 = container->namespaceWithID("user1");
+    auto user2 = container->namespaceWithID("user2");
+    if (!user1 || !user2 || user1 == user2 || container->namespaceWithID("user1") != user1) {
+        abort();
+    }
+    user1->set("Alice", "name");
+    user1->set(18, "age");
+    user2->set("Bob", "name");
+    user2->incrementInt64("visits", 3);
+    container->set(true, "plain");
+
+    string name;
+    if (!user1->getString("name", name) || name != "Alice" || !user2->getString("name", name) || name != "Bob") {
+        abort();
+    }
+    if (user1->count() != 2 || user2->count() != 2 || user1->containsKey("visits") || container->containsKey("name")) {
+        abort();
+    }
+    if (user1->allKeys() != vector<string>{"age", "name"} || container->allNamespaces() != vector<string>{"user1", "user2"}) {
+        abort();
+    }
+
+    // namespaces & their registry survive a reload
+    container->clearMemoryCache();
+    if (user2->getInt64("visits") != 3 || container->namespaceWithID("user2") != user2) {
+        abort();
+    }
+
+    user1->clearAll();
+    if (user1->count() != 0 || user2->count() != 2 || !container->getBool("plain")) {
+        abort();
+    }
+
+    // ids of closed namespaces are reloaded from the file
+    container->close();
+    container = MMKV::mmkvWithID("testNamespace");
+    user2 = container->namespaceWithID("user2");
+    auto user3 = container->namespaceWithID("user3");
+    if (user2->getInt64("visits") != 3 || user3->count() != 0) {
+        abort();
+    }
+    user3->set(1, "age");
+    if (user2->count() != 2 || container->allNamespaces().size() != 3) {
+        abort();
+    }
+    container->close();
+    MMKV::removeStorage("testNamespace");
+    printf("testNamespace passed\n");
+}
+
+void testAsyncOpen() {
+    const int instanceCount = 4;
+    auto idOf = [](int i) { return "testAsyncOpen-" + to_string(i); };
+    for (int i = 0; i < instanceCount; i++) {
+        auto mmkv = MMKV::mmkvWithID(idOf(i));
+        mmkv->set(i, "index");
+        mmkv->close();
+    }
+
+    MMKV::prewarm({idOf(0), idOf(1)});
+    // waits for the one being opened in background, instead of opening it twice
+    auto mmkv0 = MMKV::mmkvWithID(idOf(0));
+    if (mmkv0->getInt32("index") != 0) {
+        abort();
+    }
+
+    auto future = MMKV::mmkvWithIDAsync(idOf(2));
+    auto mmkv2 = future.get();
+    // fully loaded before returned
+    if (!mmkv2 || mmkv2->memoryStats().mappedBytes == 0 || mmkv2->getInt32("index") != 2) {
+        abort();
+    }
+    if (MMKV::mmkvWithIDAsync(idOf(2)).get() != mmkv2 || MMKV::mmkvWithIDAsync(idOf(1)).get() != MMKV::mmkvWithID(idOf(1))) {
+        abort();
+    }
+
+    string aesKey = "asyncKey";
+    mutex mtx;
+    condition_variable cv;
+    MMKV *mmkv3 = nullptr;
+    bool done = false;
+    MMKV::mmkvWithIDAsync(idOf(3) + "-crypt", [&](MMKV *kv) {
+        kv->set("secret", "value");
+        lock_guard<mutex> lock(mtx);
+        mmkv3 = kv;
+        done = true;
+        cv.notify_one();
+    }, MMKV_SINGLE_PROCESS, &aesKey);
+    aesKey.clear(); // copied before the task runs
+    {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [&] { return done; });
+    }
+    string value;
+    if (!mmkv3 || mmkv3->cryptKey() != "asyncKey" || !mmkv3->getString("value", value) || value != "secret") {
+        abort();
+    }
+
+    mmkv3->close();
+    MMKV::removeStorage(idOf(3) + "-crypt");
+    for (int i = 0; i < instanceCount; i++) {
+        MMKV::mmkvWithID(idOf(i))->close();
+        MMKV::removeStorage(idOf(i));
+    }
+    printf("testAsyncOpen passed\n");
+}
+
+// onExit() stops the async pool, initializing again brings it back
+void testAsyncOpenAfterExit() {
+    auto rootDir = MMKV::getRootDir();
+    MMKV::onExit();
+    MMKV::initializeMMKV(rootDir);
+
+    auto mmkv = MMKV::mmkvWithIDAsync("testAsyncOpenAfterExit").get();
+    if (!mmkv || mmkv != MMKV::mmkvWithID("testAsyncOpenAfterExit")) {
+        abort();
+    }
+    mmkv->set(1, "int");
+    if (mmkv->getInt32("int") != 1) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testAsyncOpenAfterExit");
+    printf("testAsyncOpenAfterExit passed\n");
+}
+
+void testInstanceHandle() {
+    const string mmapID = "testInstanceHandle";
+    {
+        auto handle = MMKV::mmkvHandleWithID(mmapID);
+        auto copy = handle;
+        // deferred till the last handle is gone
+        handle->close();
+        copy->set(1, "key");
+        handle.reset();
+        if (copy->getInt32("key") != 1) {
+            abort();
+        }
+        auto mappedBytes = MMKV::globalMemoryStats().mappedBytes;
+        copy.reset();
+        if (MMKV::globalMemoryStats().mappedBytes >= mappedBytes) {
+            abort();
+        }
+    }
+    // looked up again before the last handle is gone, the close is canceled so that the pointer stays valid
+    {
+        auto handle = MMKV::mmkvHandleWithID(mmapID);
+        auto kv = handle.get();
+        kv->close();
+        if (MMKV::mmkvWithID(mmapID) != kv) {
+            abort();
+        }
+        handle.reset();
+        if (kv->getInt32("key") != 1) {
+            abort();
+        }
+        // it takes another close()
+        auto mappedBytes = MMKV::globalMemoryStats().mappedBytes;
+        kv->close();
+        if (MMKV::globalMemoryStats().mappedBytes >= mappedBytes) {
+            abort();
+        }
+    }
+    // removed storage is detached, until the last handle is gone
+    {
+        auto handle = MMKV::mmkvHandleWithID(mmapID);
+        MMKV::removeStorage(mmapID);
+        auto kv = MMKV::mmkvWithID(mmapID);
+        if (kv == handle.get() || kv->containsKey("key") || handle->getInt32("key") != 1) {
+            abort();
+        }
+        kv->close();
+    }
+    // a backup waiting for an opened instance doesn't keep other ones from being opened
+    {
+        string backupDir = "/tmp/mmkv_backup_handle";
+        auto kv = MMKV::mmkvWithID(mmapID);
+        kv->set(2, "key");
+        bool backupRet = false;
+        thread backup;
+        kv->enumerate([&](string_view, const MMBuffer &) {
+            // blocked by the instance lock held by enumerate()
+            backup = thread([&] { backupRet = MMKV::backupOneToDirectory(mmapID, backupDir); });
+            this_thread::sleep_for(chrono::milliseconds(100));
+            atomic<bool> opened(false);
+            thread other([&] {
+                MMKV::mmkvWithID(mmapID + "-other")->close();
+                opened = true;
+            });
+            for (int i = 0; i < 100 && !opened; i++) {
+                this_thread::sleep_for(chrono::milliseconds(20));
+            }
+            if (!opened) {
+                abort();
+            }
+            other.join();
+            return false;
+        });
+        backup.join();
+        auto copy = MMKV::mmkvWithID(mmapID, MMKV_SINGLE_PROCESS, nullptr, &backupDir);
+        if (!backupRet || copy->getInt32("key") != 2) {
+            abort();
+        }
+        copy->close();
+        MMKV::removeStorage(mmapID, &backupDir);
+        MMKV::removeStorage(mmapID + "-other");
+        kv->close();
+    }
+
+    // lookups & closing racing each other
+    atomic<bool> stop(false);
+    vector<thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&, i] {
+            for (int loop = 0; !stop; loop++) {
+                auto handle = MMKV::mmkvHandleWithID(mmapID);
+                handle->set(loop, "thread-" + to_string(i));
+            }
+        });
+    }
+    for (int i = 0; i < 200; i++) {
+        MMKV::mmkvWithID(mmapID)->close();
+    }
+    stop = true;
+    for (auto &t : threads) {
+        t.join();
+    }
+    MMKV::mmkvWithID(mmapID)->close();
+    MMKV::removeStorage(mmapID);
+    printf("testInstanceHandle passed\n");
+}
+
+void testWriteBehind() {
+    const string mmapID = "testWriteBehind";
+    auto kv = MMKV::mmkvWithID(mmapID);
+    kv->clearAll();
+
+    // read your own writes, later ones collapse
+    for (int i = 0; i < 100; i++) {
+        kv->setAsync(i, "int");
+    }
+    kv->setAsync("hello", "string");
+    kv->setAsync(vector<string>{"a", "b"}, "vector");
+    string str;
+    vector<string> vec;
+    if (kv->getInt32("int") != 99 || !kv->getString("string", str) || str != "hello" || !kv->getVector("vector", vec) ||
+        vec.size() != 2 || !kv->containsKey("int")) {
+        abort();
+    }
+    // a sync set wins over the queued one
+    kv->setAsync(true, "bool");
+    kv->set(false, "bool");
+    kv->flush();
+    if (kv->getBool("bool", true) || kv->count() != 4) {
+        abort();
+    }
+    // so does a remove
+    kv->setAsync(1.5, "double");
+    kv->removeValueForKey("double");
+    kv->flush();
+    if (kv->containsKey("double")) {
+        abort();
+    }
+    // a full queue is drained by the caller
+    kv->setWriteBehindCapacity(8);
+    for (int i = 0; i < 100; i++) {
+        kv->setAsync(i, "key-" + to_string(i));
+    }
+    if (kv->allKeys().size() != 104 || kv->getInt32("key-50") != 50) {
+        abort();
+    }
+    kv->clearAll();
+    kv->setAsync(1, "int");
+    kv->clearAll();
+    kv->flush();
+    if (kv->count() != 0) {
+        abort();
+    }
+
+    // queued key-values are appended on close
+    kv->setAsync(string("world"), "string");
+    kv->close();
+    kv = MMKV::mmkvWithID(mmapID);
+    if (!kv->getString("string", str) || str != "world") {
+        abort();
+    }
+
+    kv->enableAutoKeyExpire();
+    kv->setAsync(1, "expire", 1);
+    if (kv->getInt32("expire") != 1) {
+        abort();
+    }
+    sleep(2);
+    if (kv->containsKey("expire")) {
+        abort();
+    }
+    kv->flush();
+    if (kv->containsKey("expire")) {
+        abort();
+    }
+    kv->close();
+    MMKV::removeStorage(mmapID);
+
+    // instances share the writer pool, closed ones leave their tasks harmless
+    auto threadCount = [] {
+        size_t count = 0;
+#ifdef __linux__
+        if (auto file = fopen("/proc/self/status", "r")) {
+            char line[256];
+            while (fgets(line, sizeof(line), file)) {
+                if (sscanf(line, "Threads: %zu", &count) == 1) {
+                    break;
+                }
+            }
+            fclose(file);
+        }
+#endif
+        return count;
+    };
+    const int instanceCount = 16;
+    auto idOf = [&](int i) { return mmapID + "-" + to_string(i); };
+    auto threadsBefore = threadCount();
+    for (int i = 0; i < instanceCount; i++) {
+        auto mmkv = MMKV::mmkvWithID(idOf(i));
+        for (int j = 0; j < 100; j++) {
+            mmkv->setAsync(j, "key-" + to_string(j));
+        }
+    }
+    if (threadCount() > threadsBefore + 2) {
+        abort();
+    }
+    for (int i = 0; i < instanceCount; i++) {
+        MMKV::mmkvWithID(idOf(i))->close();
+    }
+    for (int i = 0; i < instanceCount; i++) {
+        auto mmkv = MMKV::mmkvWithID(idOf(i));
+        if (mmkv->count() != 100 || mmkv->getInt32("key-99") != 99) {
+            abort();
+        }
+        mmkv->close();
+        MMKV::removeStorage(idOf(i));
+    }
+    printf("testWriteBehind passed\n");
+}
+
+void testFixedWidthVector() {
+#if __cplusplus >= 202002L
+    auto mmkv = MMKV::mmkvWithID("testFixedWidthVector");
+    mmkv->clearAll();
+    vector<int32_t> int32s = {1024, 0, -1, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()};
+    vector<uint64_t> uint64s = {2048, 0, std::numeric_limits<uint64_t>::max()};
+    vector<double> doubles = {1024.0, 0.0, -1.5, std::numeric_limits<double>::max()};
+
+    // varints & fixed-width read back the same
+    mmkv->set(int32s, "int32-varint");
+    mmkv->setFixedWidth(int32s, "int32-fixed");
+    mmkv->setFixedWidth(std::span(uint64s), "uint64-fixed");
+    mmkv->setFixedWidth(vector<int64_t>(), "empty-fixed");
+    mmkv->set(doubles, "double");
+    vector<int32_t> int32Result1, int32Result2;
+    vector<uint64_t> uint64Result;
+    vector<int64_t> emptyResult;
+    vector<double> doubleResult;
+    if (!mmkv->getVector("int32-varint", int32Result1) || int32Result1 != int32s ||
+        !mmkv->getVector("int32-fixed", int32Result2) || int32Result2 != int32s ||
+        !mmkv->getVector("uint64-fixed", uint64Result) || uint64Result != uint64s ||
+        !mmkv->getVector("empty-fixed", emptyResult) || !emptyResult.empty() ||
+        !mmkv->getVector("double", doubleResult) || doubleResult != doubles) {
+        abort();
+    }
+    // element width mismatch
+    vector<int64_t> int64Result;
+    if (mmkv->getVector("int32-fixed", int64Result)) {
+        abort();
+    }
+
+    mmkv->enableAutoKeyExpire();
+    mmkv->setFixedWidth(int32s, "int32-expire", 1);
+    int32Result2.clear();
+    if (!mmkv->getVector("int32-expire", int32Result2) || int32Result2 != int32s) {
+        abort();
+    }
+    mmkv->disableAutoKeyExpire();
+    mmkv->close();
+    MMKV::removeStorage("testFixedWidthVector");
+    printf("testFixedWidthVector passed\n");
+#endif
+}
+
+void testVectorSpeed() {
+#if __cplusplus >= 202002L
+    auto mmkv = MMKV::mmkvWithID("testVectorSpeed");
+    for (size_t size : {10, 1000, 100000}) {
+        mmkv->clearAll();
+        vector<int64_t> vec(size);
+        for (size_t i = 0; i < size; i++) {
+            vec[i] = static_cast<int64_t>(i * i);
+        }
+        const size_t loops = std::max<size_t>(1000000 / size, 10);
+        vector<int64_t> result;
+
+        auto start = getTimeInMs();
+        for (size_t i = 0; i < loops; i++) {
+            mmkv->set(vec, "varint");
+        }
+        auto setTime = getTimeInMs() - start;
+        start = getTimeInMs();
+        for (size_t i = 0; i < loops; i++) {
+            result.clear();
+            mmkv->getVector("varint", result);
+        }
+        auto getTime = getTimeInMs() - start;
+
+        start = getTimeInMs();
+        for (size_t i = 0; i < loops; i++) {
+            mmkv->setFixedWidth(vec, "fixed");
+        }
+        auto fixedSetTime = getTimeInMs() - start;
+        start = getTimeInMs();
+        for (size_t i = 0; i < loops; i++) {
+            result.clear();
+            mmkv->getVector("fixed", result);
+        }
+        auto fixedGetTime = getTimeInMs() - start;
+        printf("int64 vector of %zu x %zu: varint set = %" PRId64 " ms, get = %" PRId64 " ms; fixed-width set = %" PRId64
+               " ms, get = %" PRId64 " ms\n",
+               size, loops, setTime, getTime, fixedSetTime, fixedGetTime);
+    }
+#endif
+}
+
+#if __cplusplus >= 202002L
+// values taking about byteCount bytes as varints, negative ones take 10 bytes
+static vector<int64_t> varintValues(size_t count, int byteCount, uint32_t seed) {
+    mt19937_64 random(seed);
+    vector<int64_t> values(count);
+    for (auto &value : values) {
+        if (byteCount >= 10) {
+            value = -static_cast<int64_t>(random() % 1000000) - 1;
+        } else if (byteCount > 0) {
+            auto bits = std::min(7 * byteCount, 63);
+            value = static_cast<int64_t>(random() & ((1ULL << bits) - 1));
+        } else {
+            // mixed lengths
+            value = static_cast<int64_t>(random() >> (random() % 64));
+        }
+    }
+    return values;
+}
+
+template <typename T>
+static void checkVarintVector(MMKV *mmkv, const vector<int64_t> &source) {
+    vector<T> values(source.size());
+    for (size_t i = 0; i < source.size(); i++) {
+        values[i] = static_cast<T>(source[i]);
+    }
+    mmkv->set(values, "vector");
+    vector<T> result;
+    if (!mmkv->getVector("vector", result) || result != values) {
+        abort();
+    }
+}
+#endif
+
+void testVarintVector() {
+#if __cplusplus >= 202002L
+    auto mmkv = MMKV::mmkvWithID("testVarintVector");
+    for (int byteCount : {0, 1, 2, 3, 5, 8, 9, 10}) {
+        // lengths around the 16 bytes runs
+        for (size_t count : {1, 15, 16, 17, 33, 1000}) {
+            auto values = varintValues(count, byteCount, static_cast<uint32_t>(count * 16 + byteCount));
+            checkVarintVector<int32_t>(mmkv, values);
+            checkVarintVector<uint32_t>(mmkv, values);
+            checkVarintVector<int64_t>(mmkv, values);
+            checkVarintVector<uint64_t>(mmkv, values);
+        }
+    }
+    // truncated in the middle of a varint
+    mmkv->set(vector<int64_t>{1, 300, -1}, "vector");
+    auto data = mmkv->getBytes("vector");
+    data = MMBuffer(data.getPtr(), data.length() - 1);
+    mmkv->set(data, "truncated");
+    vector<int64_t> result;
+    if (mmkv->getVector("truncated", result)) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testVarintVector");
+    printf("testVarintVector passed\n");
+#endif
+}
+
+void testVarintDecodeSpeed() {
+#if __cplusplus >= 202002L
+    auto mmkv = MMKV::mmkvWithID("testVarintDecodeSpeed");
+    const size_t count = 100000;
+    const int loops = 100;
+    for (int byteCount : {1, 2, 3, 5, 10, 0}) {
+        mmkv->set(varintValues(count, byteCount, byteCount), "vector");
+        vector<int64_t> result;
+        auto start = getTimeInMs();
+        for (int i = 0; i < loops; i++) {
+            result.clear();
+            mmkv->getVector("vector", result);
+        }
+        auto cost = getTimeInMs() - start;
+        auto size = mmkv->getValueSize("vector", true);
+        printf("decode %zu varints of %s bytes x %d: %" PRId64 " ms, %.1f MB/s\n", count,
+               byteCount ? to_string(byteCount).c_str() : "mixed", loops, cost,
+               cost ? size * loops / 1000.0 / cost : 0.0);
+    }
+    mmkv->clearAll();
+#endif
+}
+
+void testTryDecode() {
+    // a varint cut in the middle
+    uint8_t bytes[] = {0xac, 0x82};
+    CodedInputData input(bytes, sizeof(bytes));
+    int64_t value = 0;
+    if (input.tryReadInt64(value) || strlen(input.lastError()) == 0) {
+        abort();
+    }
+    bool thrown = false;
+    try {
+        CodedInputData(bytes, sizeof(bytes)).readInt64();
+    } catch (std::out_of_range &) {
+        thrown = true;
+    }
+    if (!thrown) {
+        abort();
+    }
+
+    auto mmkv = MMKV::mmkvWithID("testTryDecode");
+    mmkv->clearAll();
+    // 300 as the size of a string with nothing after it
+    mmkv->set(300, "int");
+    string str = "untouched";
+    MMBuffer buffer;
+    if (mmkv->getString("int", str) || str != "untouched" || mmkv->getBytes("int", buffer) ||
+        mmkv->getInt32("int") != 300) {
+        abort();
+    }
+    bool hasValue = true;
+    mmkv->set(string(), "empty");
+    if (mmkv->getDouble("empty", 1.5, &hasValue) != 1.5 || hasValue) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testTryDecode");
+    printf("testTryDecode passed\n");
+}
+
+void testEncodeArena() {
+    vector<string> vec = {"Hello", "MMKV", "arena"};
+    auto buffer = MiniPBCoder::encodeDataWithObject(vec);
+    // encoded in place, into a caller owned buffer
+    char raw[64];
+    size_t reserved = 0;
+    auto size = MiniPBCoder::encodeDataWithObject(vec, [&](size_t compiledSize) -> void * {
+        reserved = compiledSize;
+        return compiledSize <= sizeof(raw) ? raw : nullptr;
+    });
+    if (size == 0 || size != reserved || size != buffer.length() || memcmp(raw, buffer.getPtr(), size) != 0) {
+        abort();
+    }
+    if (MiniPBCoder::encodeDataWithObject(vec, [](size_t) -> void * { return nullptr; }) != 0) {
+        abort();
+    }
+    // the arena is reused, a large container must not leave stale items behind
+    vector<string> large(10000, "x");
+    auto largeBuffer = MiniPBCoder::encodeDataWithObject(large);
+    if (MiniPBCoder::decodeVector(largeBuffer).size() != large.size()) {
+        abort();
+    }
+    auto again = MiniPBCoder::encodeDataWithObject(vec);
+    if (!(again == buffer)) {
+        abort();
+    }
+    // each thread has its own arena
+    vector<thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; i++) {
+                vector<string> local = {to_string(t), to_string(i)};
+                auto result = MiniPBCoder::decodeVector(MiniPBCoder::encodeDataWithObject(local));
+                if (result != local) {
+                    abort();
+                }
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    printf("testEncodeArena passed\n");
+}
+
+void testSmallVectorSetSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testSmallVectorSetSpeed");
+    mmkv->clearAll();
+    vector<string> vec = {"Hello", "MMKV", "small", "vector"};
+    const int loops = 200000;
+    auto start = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        mmkv->set(vec, "vec");
+    }
+    printf("set small vector<string> %d times: %lld ms\n", loops, (long long) (getTimeInMs() - start));
+    mmkv->close();
+    MMKV::removeStorage("testSmallVectorSetSpeed");
+}
+
+void testDirectEncode() {
+    string cryptKey = "direct";
+    for (auto key : {(string *) nullptr, &cryptKey}) {
+        auto mmkv = MMKV::mmkvWithID("testDirectEncode", MMKV_SINGLE_PROCESS, key);
+        mmkv->clearAll();
+        // the only key is overridden, not appended
+        vector<string> small = {"Hello", "MMKV"};
+        mmkv->set(small, "small");
+        mmkv->set(small, "small");
+        // large enough to grow the file while being appended
+        vector<string> large(20000, "direct encoding into the file");
+        mmkv->set(large, "large");
+        // encrypted values are encoded into a buffer, no plaintext ever reaches the file
+        if (key) {
+            string content;
+            if (auto file = fopen("/tmp/mmkv/testDirectEncode", "rb")) {
+                char buffer[4096];
+                size_t size;
+                while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+                    content.append(buffer, size);
+                }
+                fclose(file);
+            }
+            if (content.empty() || content.find(large[0]) != string::npos) {
+                abort();
+            }
+        }
+#ifdef MMKV_HAS_CPP20
+        vector<int64_t> numbers(10000);
+        for (size_t i = 0; i < numbers.size(); i++) {
+            numbers[i] = static_cast<int64_t>(i * i) - 5000;
+        }
+        mmkv->set(numbers, "numbers");
+        vector<bool> flags = {true, false, true};
+        mmkv->set(flags, "flags");
+#endif
+        mmkv->set(small, "large");
+        mmkv->close();
+
+        // reload from the file to check CRC & encryption
+        mmkv = MMKV::mmkvWithID("testDirectEncode", MMKV_SINGLE_PROCESS, key);
+        vector<string> result;
+        if (!mmkv->getVector("small", result) || result != small) {
+            abort();
+        }
+        if (!mmkv->getVector("large", result) || result != small) {
+            abort();
+        }
+#ifdef MMKV_HAS_CPP20
+        vector<int64_t> numbersResult;
+        vector<bool> flagsResult;
+        if (!mmkv->getVector("numbers", numbersResult) || numbersResult != numbers ||
+            !mmkv->getVector("flags", flagsResult) || flagsResult != flags) {
+            abort();
+        }
+#endif
+        mmkv->set(large, "large");
+        mmkv->trim();
+        if (!mmkv->getVector("large", result) || result != large) {
+            abort();
+        }
+        mmkv->close();
+        MMKV::removeStorage("testDirectEncode");
+    }
+    printf("testDirectEncode passed\n");
+}
+
+void testLargeVectorSetSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testLargeVectorSetSpeed");
+    mmkv->clearAll();
+    vector<string> vec(1000, "a string of a large vector");
+    const int loops = 20000;
+    auto start = getTimeInMs();
+    for (int i = 0; i < loops; i++) {
+        mmkv->set(vec, "vec" + to_string(i % 10));
+    }
+    printf("set 1000-element vector<string> %d times: %lld ms\n", loops, (long long) (getTimeInMs() - start));
+    mmkv->close();
+    MMKV::removeStorage("testLargeVectorSetSpeed");
+}
+
+// JSON-like text that compresses a few times
+static string compressibleString(size_t length, uint32_t seed) {
+    mt19937 rng(seed);
+    const char *words[] = {"\"name\": ", "\"value\": ", "\"id\": ", "{", "}, ", "true", "false", "\"MMKV\""};
+    string result;
+    while (result.length() < length) {
+        result += words[rng() % 8];
+        result += to_string(rng() % 10);
+    }
+    result.resize(length);
+    return result;
+}
+
+static void checkLZ4RoundTrip(const string &source) {
+    vector<uint8_t> compressed(lz4CompressBound(source.length()));
+    auto size = lz4Compress(source.data(), source.length(), compressed.data(), compressed.size());
+    string result(source.length(), '\0');
+    if (size == 0 || !lz4Decompress(compressed.data(), size, result.data(), result.length()) || result != source) {
+        abort();
+    }
+    // truncated or mis-sized input is rejected, not overrun
+    if (size > 1 && lz4Decompress(compressed.data(), size - 1, result.data(), result.length())) {
+        abort();
+    }
+    if (lz4Decompress(compressed.data(), size, result.data(), result.length() + 1)) {
+        abort();
+    }
+}
+
+void testCompression() {
+    mt19937 rng(46);
+    for (size_t length : {0, 1, 12, 13, 100, 4096, 70000, 200000}) {
+        checkLZ4RoundTrip(compressibleString(length, 1));
+        string random(length, '\0');
+        for (auto &ch : random) {
+            ch = static_cast<char>(rng());
+        }
+        checkLZ4RoundTrip(random);
+        checkLZ4RoundTrip(string(length, 'a'));
+    }
+
+    string cryptKey = "compression";
+    auto json = compressibleString(50000, 2);
+    string random(5000, '\0');
+    for (auto &ch : random) {
+        ch = static_cast<char>(rng());
+    }
+    for (auto key : {(string *) nullptr, &cryptKey}) {
+        for (bool expire : {false, true}) {
+            auto mmkv = MMKV::mmkvWithID("testCompression", MMKV_SINGLE_PROCESS, key);
+            mmkv->clearAll();
+            if (expire) {
+                mmkv->enableAutoKeyExpire(MMKV::ExpireNever);
+            }
+            mmkv->enableCompression(256);
+            mmkv->set(json, "json");
+            mmkv->set(mmkv::MMBuffer((void *) json.data(), json.length(), mmkv::MMBufferNoCopy), "bytes");
+            mmkv->set(random, "random");
+            mmkv->set("short", "short");
+            auto stats = mmkv->compressionStats();
+            if (stats.compressedCount != 2 || stats.skippedCount != 1 || stats.compressionRatio() < 2) {
+                abort();
+            }
+            if (mmkv->getValueSize("json", true) != json.length() || mmkv->getValueSize("json", false) >= json.length() / 2) {
+                abort();
+            }
+            string result;
+            if (!mmkv->getString("json", result) || result != json || !mmkv->getString("json", result, false) || result != json) {
+                abort();
+            }
+            vector<char> raw(json.length());
+            if (mmkv->writeValueToBuffer("json", raw.data(), (int32_t) raw.size()) != (int32_t) json.length() ||
+                memcmp(raw.data(), json.data(), json.length()) != 0) {
+                abort();
+            }
+            if (mmkv->writeValueToBuffer("json", raw.data(), (int32_t) raw.size() - 1) != -1) {
+                abort();
+            }
+            auto bytes = mmkv->getBytes("bytes");
+            if (bytes.length() != json.length() || memcmp(bytes.getPtr(), json.data(), json.length()) != 0) {
+                abort();
+            }
+            if (mmkv->compressionStats().decompressedCount != 4) {
+                abort();
+            }
+            size_t decoded = mmkv->enumerate(function<bool(string_view, const string &)>([&](string_view, const string &value) {
+                return value == json || value == random || value == "short" ? true : (abort(), false);
+            }));
+            if (decoded != 4) {
+                abort();
+            }
+            mmkv->close();
+
+            // readable without compression enabled
+            mmkv = MMKV::mmkvWithID("testCompression", MMKV_SINGLE_PROCESS, key);
+            if (expire) {
+                mmkv->enableAutoKeyExpire(MMKV::ExpireNever);
+            }
+            if (!mmkv->getString("json", result) || result != json || !mmkv->getString("random", result) || result != random) {
+                abort();
+            }
+            mmkv->set(json, "json");
+            if (mmkv->getValueSize("json", false) <= json.length()) {
+                abort();
+            }
+            mmkv->close();
+            MMKV::removeStorage("testCompression");
+        }
+    }
+
+    // values that don't shrink enough to pay for decompressing on every read are stored as is
+    string mixed;
+    while (mixed.length() < 8192) {
+        for (int i = 0; i < 44; i++) {
+            mixed += static_cast<char>(rng());
+        }
+        mixed += string(20, ' ');
+    }
+    auto mmkv = MMKV::mmkvWithID("testCompressionRatio");
+    mmkv->enableCompression();
+    mmkv->set(mixed, "mixed");
+    if (mmkv->compressionStats().skippedCount != 1 || mmkv->getValueSize("mixed", false) <= mixed.length()) {
+        abort();
+    }
+    mmkv->enableCompression(MMKV::DefaultCompressionThreshold, 1.1);
+    mmkv->set(mixed, "mixed");
+    string result;
+    if (mmkv->compressionStats().compressedCount != 1 || mmkv->getValueSize("mixed", false) >= mixed.length() ||
+        !mmkv->getString("mixed", result) || result != mixed) {
+        abort();
+    }
+    // ratios below 1 & NaN are rejected, the last valid one is kept
+    if (mmkv->enableCompression(MMKV::DefaultCompressionThreshold, 0.5) ||
+        mmkv->enableCompression(MMKV::DefaultCompressionThreshold, numeric_limits<double>::quiet_NaN())) {
+        abort();
+    }
+    mmkv->set(mixed, "mixed");
+    if (mmkv->compressionStats().compressedCount != 2) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testCompressionRatio");
+    printf("testCompression passed\n");
+}
+
+void testCompressionSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testCompressionSpeed");
+    auto json = compressibleString(64 * 1024, 3);
+    for (bool compress : {false, true}) {
+        mmkv->clearAll();
+        if (compress) {
+            mmkv->enableCompression();
+        } else {
+            mmkv->disableCompression();
+        }
+        const int loops = 2000;
+        string result;
+        auto start = getTimeInMs();
+        for (int i = 0; i < loops; i++) {
+            mmkv->set(json, "json" + to_string(i % 100));
+        }
+        auto setTime = getTimeInMs() - start;
+        start = getTimeInMs();
+        for (int i = 0; i < loops; i++) {
+            mmkv->getString("json" + to_string(i % 100), result);
+        }
+        auto getTime = getTimeInMs() - start;
+        auto stats = mmkv->compressionStats();
+        printf("64KB JSON x %d, compression %d: set %lld ms, get %lld ms, file %zu, ratio %.2f, compress %llu ms, decompress %llu ms\n",
+               loops, compress, (long long) setTime, (long long) getTime, mmkv->totalSize(), stats.compressionRatio(),
+               (unsigned long long) stats.compressTime / 1000000, (unsigned long long) stats.decompressTime / 1000000);
+    }
+    mmkv->close();
+    MMKV::removeStorage("testCompressionSpeed");
+}
+
+static vector<string> blobFiles(const string &mmapID, const string &rootDir = "/tmp/mmkv") {
+    vector<string> files;
+    auto blobDir = rootDir + "/" + mmapID + ".blob";
+    if (mmkv::isFileExist(blobDir)) {
+        mmkv::walkInDir(blobDir, mmkv::WalkFile, [&](const string &filePath, mmkv::WalkType) { files.push_back(filePath); });
+    }
+    return files;
+}
+
+void testBlobStorage() {
+    string mmapID = "testBlobStorage";
+    string backupDir = "/tmp/mmkv_blob_backup";
+    auto big = compressibleString(300000, 4);
+    auto big2 = compressibleString(100000, 5);
+    for (bool expire : {false, true}) {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        mmkv->clearAll();
+        if (expire) {
+            mmkv->enableAutoKeyExpire(MMKV::ExpireNever);
+        }
+        if (!mmkv->enableBlobStorage(64 * 1024)) {
+            abort();
+        }
+        mmkv->set(big, "big");
+        mmkv->set(mmkv::MMBuffer((void *) big2.data(), big2.length(), mmkv::MMBufferNoCopy), "bytes");
+        mmkv->set("small", "small");
+        // only the references are in the file
+        if (blobFiles(mmapID).size() != 2 || mmkv->actualSize() > 1024) {
+            abort();
+        }
+        string result;
+        if (!mmkv->getString("big", result) || result != big || !mmkv->getString("big", result, false) || result != big) {
+            abort();
+        }
+        auto bytes = mmkv->getBytes("bytes");
+        if (bytes.length() != big2.length() || memcmp(bytes.getPtr(), big2.data(), big2.length()) != 0) {
+            abort();
+        }
+        if (mmkv->getValueSize("big", true) != big.length() || mmkv->getValueSize("big", false) <= big.length()) {
+            abort();
+        }
+        vector<char> raw(big.length());
+        if (mmkv->writeValueToBuffer("big", raw.data(), (int32_t) raw.size()) != (int32_t) big.length() ||
+            memcmp(raw.data(), big.data(), big.length()) != 0) {
+            abort();
+        }
+        if (mmkv->writeValueToBuffer("big", raw.data(), (int32_t) raw.size() - 1) != -1) {
+            abort();
+        }
+        size_t decoded = mmkv->enumerate(function<bool(string_view, const string &)>([&](string_view, const string &value) {
+            return value == big || value == big2 || value == "small" ? true : (abort(), false);
+        }));
+        if (decoded != 3) {
+            abort();
+        }
+
+        // blobs of overwritten or removed values are kept till a full write back confirms no one refers to them
+        mmkv->set(big2, "big");
+        if (blobFiles(mmapID).size() != 3 || !mmkv->getString("big", result) || result != big2) {
+            abort();
+        }
+        mmkv->set("inline", "big");
+        mmkv->removeValueForKey("bytes");
+        if (blobFiles(mmapID).size() != 3 || !mmkv->getString("big", result) || result != "inline") {
+            abort();
+        }
+        mmkv->set("tmp", "tmp");
+        mmkv->removeValuesForKeys({"tmp", "none"});
+        if (!blobFiles(mmapID).empty() || !mmkv->getString("big", result) || result != "inline") {
+            abort();
+        }
+        if (!expire) {
+            // so are values encoded straight into the file, which count towards the sweep too
+            for (int i = 0; i < 5; i++) {
+                mmkv->set(big, "vector");
+                mmkv->set(vector<string>{"a", "b"}, "vector");
+            }
+            if (blobFiles(mmapID).size() >= 5) {
+                abort();
+            }
+            mmkv->removeValueForKey("vector");
+            mmkv->set("tmp", "tmp");
+            mmkv->removeValuesForKeys({"tmp", "none"});
+            if (!blobFiles(mmapID).empty()) {
+                abort();
+            }
+        }
+        // and swept once they pile up
+        for (int i = 0; i < 10; i++) {
+            mmkv->set(i % 2 ? big : big2, "big");
+        }
+        if (blobFiles(mmapID).size() >= 6 || !mmkv->getString("big", result) || result != big) {
+            abort();
+        }
+        mmkv->set("inline", "big");
+        // removing in bulk leaves them to the full write back
+        mmkv->set(big, "a");
+        mmkv->set(big2, "b");
+        mmkv->removeValuesForKeys({"a", "small"});
+        if (blobFiles(mmapID).size() != 1 || !mmkv->getString("b", result) || result != big2) {
+            abort();
+        }
+
+        // backup & restore along with the file
+        if (!MMKV::backupOneToDirectory(mmapID, backupDir) || blobFiles(mmapID, backupDir).size() != 1) {
+            abort();
+        }
+        mmkv->set(big, "b");
+        if (!MMKV::restoreOneFromDirectory(mmapID, backupDir) || blobFiles(mmapID).size() != 1) {
+            abort();
+        }
+        if (!mmkv->getString("b", result) || result != big2) {
+            abort();
+        }
+
+        // a corrupted blob fails the CRC check
+        auto files = blobFiles(mmapID);
+        auto file = fopen(files[0].c_str(), "r+b");
+        auto ch = fgetc(file);
+        fseek(file, 0, SEEK_SET);
+        fputc(ch ^ 0xff, file);
+        fclose(file);
+        if (mmkv->getString("b", result)) {
+            abort();
+        }
+
+        mmkv->clearAll();
+        if (mmkv::isFileExist("/tmp/mmkv/" + mmapID + ".blob")) {
+            abort();
+        }
+
+        // readable without blob storage enabled
+        mmkv->set(big, "big");
+        mmkv->close();
+        mmkv = MMKV::mmkvWithID(mmapID);
+        if (expire) {
+            mmkv->enableAutoKeyExpire(MMKV::ExpireNever);
+        }
+        if (!mmkv->getString("big", result) || result != big || blobFiles(mmapID).size() != 1) {
+            abort();
+        }
+        mmkv->close();
+        MMKV::removeStorage(mmapID);
+        if (mmkv::isFileExist("/tmp/mmkv/" + mmapID + ".blob")) {
+            abort();
+        }
+        MMKV::removeStorage(mmapID, &backupDir);
+    }
+
+    string cryptKey = "blob";
+    auto mmkv = MMKV::mmkvWithID("testBlobStorageCrypt", MMKV_SINGLE_PROCESS, &cryptKey);
+    if (mmkv->enableBlobStorage()) {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage("testBlobStorageCrypt");
+
+    // encrypted references couldn't be resolved or swept
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->enableBlobStorage(64 * 1024);
+    mmkv->set(big, "big");
+    mmkv->set("small", "small");
+    if (mmkv->reKey(cryptKey)) {
+        abort();
+    }
+    mmkv->disableBlobStorage();
+    if (mmkv->reKey(cryptKey) || blobFiles(mmapID).size() != 1) {
+        abort();
+    }
+    string result;
+    mmkv->set("inline", "big");
+    if (!mmkv->reKey(cryptKey) || !blobFiles(mmapID).empty() || !mmkv->getString("big", result) || result != "inline") {
+        abort();
+    }
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+    printf("testBlobStorage passed\n");
+}
+
+void testBlobStorageSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testBlobStorageSpeed");
+    auto value = compressibleString(1024 * 1024, 6);
+    for (bool blob : {false, true}) {
+        mmkv->clearAll();
+        if (blob) {
+            mmkv->enableBlobStorage();
+        } else {
+            mmkv->disableBlobStorage();
+        }
+        for (int i = 0; i < 16; i++) {
+            mmkv->set(value, "large" + to_string(i));
+        }
+        const int loops = 20000;
+        auto start = getTimeInMs();
+        for (int i = 0; i < loops; i++) {
+            mmkv->set(i, "small" + to_string(i % 1000));
+        }
+        auto setTime = getTimeInMs() - start;
+        start = getTimeInMs();
+        mmkv->trim();
+        auto trimTime = getTimeInMs() - start;
+        printf("16 x 1MB values, blob %d: %d small sets %lld ms, trim %lld ms, file %zu\n", blob, loops,
+               (long long) setTime, (long long) trimTime, mmkv->totalSize());
+    }
+    mmkv->close();
+    MMKV::removeStorage("testBlobStorageSpeed");
+}
+
+void testKeyReference() {
+    string mmapID = "testKeyReference";
+    auto keyOf = [](int i) { return string(100, 'k') + to_string(i); };
+    const int keyCount = 10;
+    auto checkValues = [&](MMKV *mmkv, int round) {
+        if (mmkv->count() != keyCount) {
+            abort();
+        }
+        for (int i = 0; i < keyCount; i++) {
+            if (mmkv->getInt32(keyOf(i)) != round * keyCount + i) {
+                abort();
+            }
+        }
+    };
+
+    // updates carry the offset of the previous record instead of the key
+    size_t growth[2] = {0, 0};
+    for (bool reference : {false, true}) {
+        auto mmkv = MMKV::mmkvWithID(mmapID);
+        mmkv->clearAll();
+        if (reference ? !mmkv->enableKeyReference() : !mmkv->disableKeyReference()) {
+            abort();
+        }
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(i, keyOf(i));
+        }
+        auto size = mmkv->actualSize();
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(keyCount + i, keyOf(i));
+        }
+        growth[reference] = mmkv->actualSize() - size;
+        checkValues(mmkv, 1);
+        mmkv->close();
+    }
+    if (growth[1] * 10 > growth[0]) {
+        abort();
+    }
+
+    auto mmkv = MMKV::mmkvWithID(mmapID);
+    checkValues(mmkv, 1);
+    mmkv->enableKeyReference();
+    // enough rounds to go through a few full write backs
+    for (int round = 2; round < 100; round++) {
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(round * keyCount + i, keyOf(i));
+        }
+        checkValues(mmkv, round);
+    }
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    checkValues(mmkv, 99);
+
+    // values encoded straight into the file refer to the key as well
+    mmkv->enableKeyReference();
+    vector<string> strings = {"a", "b"};
+    mmkv->set(strings, keyOf(0));
+    auto sizeBefore = mmkv->actualSize();
+    mmkv->set(strings, keyOf(0));
+    vector<string> stringsResult;
+    if (mmkv->actualSize() - sizeBefore > 16 || !mmkv->getVector(keyOf(0), stringsResult) || stringsResult != strings) {
+        abort();
+    }
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    stringsResult.clear();
+    if (!mmkv->getVector(keyOf(0), stringsResult) || stringsResult != strings) {
+        abort();
+    }
+    mmkv->set(99 * keyCount, keyOf(0));
+    checkValues(mmkv, 99);
+
+    // removed by reference, a key referring to an overridden record is written in full
+    mmkv->set(1, "another");
+    for (int i = 0; i < keyCount; i++) {
+        mmkv->removeValueForKey(keyOf(i));
+    }
+    mmkv->set(2, "another");
+    mmkv->set(3, "another");
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    if (mmkv->count() != 1 || mmkv->getInt32("another") != 3) {
+        abort();
+    }
+
+    // references are replaced by keys on full write back, including the one to encrypt
+    mmkv->clearAll();
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < keyCount; i++) {
+            mmkv->set(round * keyCount + i, keyOf(i));
+        }
+    }
+    mmkv->trim();
+    checkValues(mmkv, 2);
+    mmkv->set(2 * keyCount, keyOf(0));
+    string cryptKey = "reference";
+    if (!mmkv->reKey(cryptKey) || mmkv->enableKeyReference()) {
+        abort();
+    }
+    mmkv->set(2 * keyCount, keyOf(0));
+    checkValues(mmkv, 2);
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID, MMKV_SINGLE_PROCESS, &cryptKey);
+    checkValues(mmkv, 2);
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    // referring to records covered by the snapshot, decoded on multiple threads
+    const int largeCount = 100000;
+    auto largeKeyOf = [](int i) { return string(80, 'k') + to_string(i); };
+    auto snapshotPath = MMKV::getRootDir() + MMKV_PATH_SLASH + mmapID + ".snapshot";
+    for (bool snapshot : {true, false}) {
+        mmkv = MMKV::mmkvWithID(mmapID);
+        mmkv->clearAll();
+        mmkv->enableKeyReference();
+        for (int i = 0; i < largeCount; i++) {
+            mmkv->set(i, largeKeyOf(i));
+        }
+        mmkv->removeValuesForKeys({largeKeyOf(0)});
+        for (int i = 1; i < largeCount; i++) {
+            mmkv->set(-i, largeKeyOf(i));
+        }
+        mmkv->close();
+        if (!snapshot) {
+            ::unlink(snapshotPath.c_str());
+        }
+        mmkv = MMKV::mmkvWithID(mmapID);
+        if (mmkv->count() != largeCount - 1) {
+            abort();
+        }
+        for (int i = 1; i < largeCount; i++) {
+            if (mmkv->getInt32(largeKeyOf(i)) != -i) {
+                abort();
+            }
+        }
+        mmkv->close();
+    }
+    MMKV::removeStorage(mmapID);
+    printf("testKeyReference passed\n");
+}
+
+void testKeyReferenceSpeed() {
+    auto mmkv = MMKV::mmkvWithID("testKeyReferenceSpeed");
+    const int keyCount = 1000;
+    const int loops = 200000;
+    vector<string> keys;
+    for (int i = 0; i < keyCount; i++) {
+        keys.push_back("com.example.app.settings.section" + to_string(i % 10) + ".item" + to_string(i));
+    }
+    for (bool reference : {false, true}) {
+        mmkv->clearAll();
+        if (reference) {
+            mmkv->enableKeyReference();
+        } else {
+            mmkv->disableKeyReference();
+        }
+        size_t fullWriteBack = 0;
+        auto size = mmkv->actualSize();
+        auto start = getTimeInMs();
+        for (int i = 0; i < loops; i++) {
+            mmkv->set(i, keys[i % keyCount]);
+            auto newSize = mmkv->actualSize();
+            fullWriteBack += (newSize < size);
+            size = newSize;
+        }
+        auto setTime = getTimeInMs() - start;
+        mmkv->close();
+        start = getTimeInMs();
+        mmkv = MMKV::mmkvWithID("testKeyReferenceSpeed");
+        mmkv->count();
+        auto loadTime = getTimeInMs() - start;
+        printf("key reference %d: %d sets %lld ms, %zu full write backs, load %lld ms, file %zu\n", reference, loops,
+               (long long) setTime, fullWriteBack, (long long) loadTime, mmkv->actualSize());
+    }
+    mmkv->close();
+    MMKV::removeStorage("testKeyReferenceSpeed");
+}
+
+void testFrozen() {
+    string srcID = "testFrozenSource", frozenID = "testFrozen";
+    auto src = MMKV::mmkvWithID(srcID);
+    src->clearAll();
+    const int keyCount = 1000;
+    for (int i = 0; i < keyCount; i++) {
+        src->set(i, "int" + to_string(i));
+        src->set("value" + to_string(i), "str" + to_string(i));
+    }
+    src->set(true, "bool");
+    src->set(3.5, "double");
+    src->set(numeric_limits<int64_t>::min(), "long");
+    src->set(vector<string>{"a", "bb", ""}, "vector");
+    src->set("", "empty");
+    uint8_t raw[] = {0, 1, 2, 0, 255};
+    src->set(MMBuffer(raw, sizeof(raw), MMBufferNoCopy), "bytes");
+    // stays compressed in the frozen file
+    src->enableCompression();
+    string large(100000, 'x');
+    src->set(large, "large");
+    if (!src->exportFrozen(frozenID) || src->exportFrozen(srcID)) {
+        abort();
+    }
+
+    auto check = [&](MMKV *frozen, int delta) {
+        if (!frozen->isFrozen() || !frozen->isReadOnly() || frozen->count() != src->count()) {
+            abort();
+        }
+        for (int i = 0; i < keyCount; i++) {
+            string value;
+            if (frozen->getInt32("int" + to_string(i)) != i + delta || !frozen->getString("str" + to_string(i), value) ||
+                value != "value" + to_string(i)) {
+                abort();
+            }
+        }
+        vector<string> vec;
+        string value;
+        if (!frozen->getBool("bool") || frozen->getDouble("double") != 3.5 ||
+            frozen->getInt64("long") != numeric_limits<int64_t>::min() || !frozen->getVector("vector", vec) ||
+            vec != vector<string>{"a", "bb", ""} || !frozen->getString("empty", value) || !value.empty() ||
+            !frozen->getString("large", value) || value != large) {
+            abort();
+        }
+        auto bytes = frozen->getBytes("bytes");
+        if (bytes.length() != sizeof(raw) || memcmp(bytes.getPtr(), raw, sizeof(raw)) != 0) {
+            abort();
+        }
+        if (frozen->containsKey("missing") || !frozen->containsKey("empty") || frozen->getInt32("missing", -1) != -1) {
+            abort();
+        }
+        // keys come sorted
+        auto keys = frozen->allKeys();
+        auto srcKeys = src->allKeys();
+        sort(srcKeys.begin(), srcKeys.end());
+        if (keys != srcKeys) {
+            abort();
+        }
+        vector<string> enumerated;
+        frozen->enumerate([&](string_view key, const MMBuffer &) {
+            enumerated.emplace_back(key);
+            return true;
+        });
+        size_t prefixCount = frozen->scanPrefix("str1", [](string_view, const MMBuffer &) { return true; });
+        if (enumerated != srcKeys || prefixCount != 111) {
+            abort();
+        }
+    };
+    auto frozen = MMKV::mmkvWithID(frozenID, MMKV_FROZEN);
+    check(frozen, 0);
+
+    // nothing can be written
+    if (frozen->set(1, "int0") || frozen->set("new", "str0") || frozen->removeValueForKey("int0") ||
+        frozen->enableAutoKeyExpire() || frozen->enableBlobStorage()) {
+        abort();
+    }
+    frozen->clearAll();
+    frozen->trim();
+    check(frozen, 0);
+
+    // replaced by a new export, the old file stays readable until reloading
+    for (int i = 0; i < keyCount; i++) {
+        src->set(i + 1, "int" + to_string(i));
+    }
+    if (!src->exportFrozen(frozenID)) {
+        abort();
+    }
+    check(frozen, 0);
+    frozen->clearMemoryCache();
+    check(frozen, 1);
+    frozen->close();
+    frozen = MMKV::mmkvWithID(frozenID, MMKV_FROZEN);
+    check(frozen, 1);
+    frozen->close();
+
+    // not a frozen file, or a truncated one, is empty
+    auto truncatedPath = MMKV::getRootDir() + MMKV_PATH_SLASH + "testFrozenTruncated";
+    if (!src->exportFrozen("testFrozenTruncated") || ::truncate(truncatedPath.c_str(), 64) != 0) {
+        abort();
+    }
+    src->close();
+    for (auto &mmapID : {srcID, string("testFrozenTruncated")}) {
+        auto invalid = MMKV::mmkvWithID(mmapID, MMKV_FROZEN);
+        if (invalid->count() != 0 || invalid->containsKey("int0") || invalid->getInt32("int0", -1) != -1 ||
+            !invalid->allKeys().empty()) {
+            abort();
+        }
+        invalid->close();
+    }
+
+    // an empty export
+    src = MMKV::mmkvWithID(srcID);
+    src->clearAll();
+    if (!src->exportFrozen(frozenID)) {
+        abort();
+    }
+    frozen = MMKV::mmkvWithID(frozenID, MMKV_FROZEN);
+    if (frozen->count() != 0 || frozen->containsKey("int0") || !frozen->allKeys().empty()) {
+        abort();
+    }
+    frozen->close();
+    src->close();
+    MMKV::removeStorage(srcID);
+    MMKV::removeStorage(frozenID);
+    MMKV::removeStorage("testFrozenTruncated");
+    printf("testFrozen passed\n");
+}
+
+void testFrozenSpeed() {
+    string srcID = "testFrozenSpeedSource", frozenID = "testFrozenSpeed";
+    const int keyCount = 300000;
+    vector<string> keys;
+    for (int i = 0; i < keyCount; i++) {
+        keys.push_back("config.section" + to_string(i % 100) + ".item" + to_string(i));
+    }
+    auto src = MMKV::mmkvWithID(srcID);
+    src->clearAll();
+    for (int i = 0; i < keyCount; i++) {
+        src->set("value of " + keys[i], keys[i]);
+    }
+    auto start = getTimeInMs();
+    if (!src->exportFrozen(frozenID)) {
+        abort();
+    }
+    printf("export %d keys: %lld ms\n", keyCount, (long long) (getTimeInMs() - start));
+    src->close();
+
+    for (auto mode : {MMKV_READ_ONLY, MMKV_FROZEN}) {
+        auto mmapID = mode == MMKV_FROZEN ? frozenID : srcID;
+        start = getTimeInMs();
+        auto mmkv = MMKV::mmkvWithID(mmapID, MMKV_SINGLE_PROCESS | mode);
+        mmkv->containsKey(keys[0]);
+        auto loadTime = getTimeInMs() - start;
+        start = getTimeInMs();
+        string value;
+        size_t found = 0;
+        for (int i = 0; i < keyCount; i++) {
+            found += mmkv->getString(keys[i], value);
+        }
+        auto getTime = getTimeInMs() - start;
+        auto stats = mmkv->memoryStats();
+        printf("%s: load %lld ms, %zu gets %lld ms, dictionary %zu bytes\n", mode == MMKV_FROZEN ? "frozen" : "read only",
+               (long long) loadTime, found, (long long) getTime, stats.dictionaryBytes);
+        mmkv->close();
+    }
+    MMKV::removeStorage(srcID);
+    MMKV::removeStorage(frozenID);
+}
+
+void testBulkBuilder() {
+    string mmapID = "testBulkBuilder";
+    auto mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->clearAll();
+    mmkv->set("replaced", "old");
+    const int keyCount = 1000;
+    auto check = [&](MMKV *kv, int delta) {
+        if (kv->count() != keyCount * 2 + 5 || kv->containsKey("replaced")) {
+            abort();
+        }
+        for (int i = 0; i < keyCount; i++) {
+            string value;
+            if (kv->getInt32("int" + to_string(i)) != i + delta || !kv->getString("str" + to_string(i), value) ||
+                value != "value" + to_string(i)) {
+                abort();
+            }
+        }
+        vector<string> vec;
+        string empty = "not empty";
+        auto bytes = kv->getBytes("bytes");
+        if (bytes.length() != 5 || memcmp(bytes.getPtr(), "bytes", 5) != 0 || !kv->getString("empty", empty) ||
+            !empty.empty() || !kv->getBool("bool") || kv->getDouble("double") != 3.5 || !kv->getVector("vector", vec) ||
+            vec != vector<string>{"a", "bb", ""}) {
+            abort();
+        }
+    };
+    auto build = [&](bool compact) {
+        MMKV::BulkBuilder builder(mmapID);
+        builder.setCompactDuplicates(compact);
+        builder.reserve(keyCount * 2 + 5, keyCount * 32);
+        for (int i = 0; i < keyCount; i++) {
+            builder.set(-i, "int" + to_string(i));
+            builder.set("value" + to_string(i), "str" + to_string(i));
+        }
+        // a key set again overrides the earlier value
+        for (int i = 0; i < keyCount; i++) {
+            builder.set(i, "int" + to_string(i));
+        }
+        builder.set(true, "bool");
+        builder.set(3.5, "double");
+        builder.set(vector<string>{"a", "bb", ""}, "vector");
+        builder.set(MMBuffer((void *) "bytes", 5, MMBufferNoCopy), "bytes");
+        builder.set("", "empty");
+        if (builder.count() != keyCount * 2 + 5 || builder.set(1, "") || !builder.commit() || builder.commit() ||
+            builder.set(1, "late")) {
+            abort();
+        }
+    };
+
+    // the existing key-values are replaced
+    build(false);
+    check(mmkv, 0);
+    auto uncompactedSize = mmkv->actualSize();
+    build(true);
+    check(mmkv, 0);
+    if (mmkv->actualSize() >= uncompactedSize) {
+        abort();
+    }
+
+    // appended to as usual, reloaded as usual
+    for (int i = 0; i < keyCount; i++) {
+        mmkv->set(i + 1, "int" + to_string(i));
+    }
+    check(mmkv, 1);
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    check(mmkv, 1);
+    mmkv->trim();
+    mmkv->close();
+
+    // values carry an expire date if the instance has one
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->enableAutoKeyExpire(60 * 60);
+    build(true);
+    check(mmkv, 0);
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->enableAutoKeyExpire(60 * 60);
+    check(mmkv, 0);
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    // the expire date is taken on commit(), not on building
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->enableAutoKeyExpire(2);
+    {
+        MMKV::BulkBuilder builder(mmapID);
+        builder.set(1, "key");
+        sleep(3);
+        if (!builder.commit() || mmkv->getInt32("key") != 1) {
+            abort();
+        }
+    }
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    // strings & bytes are compressed & moved into blobs as set() does
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->enableCompression();
+    mmkv->enableBlobStorage(MMKV::MinBlobThreshold);
+    {
+        string compressible(2048, 'c'), big(MMKV::MinBlobThreshold, 'b');
+        MMKV::BulkBuilder builder(mmapID);
+        builder.set(compressible, "compressed");
+        builder.set(big, "blob");
+        builder.set(big, "overridden");
+        builder.set(1, "overridden");
+        if (!builder.commit() || blobFiles(mmapID).size() != 1 || mmkv->compressionStats().compressedCount != 1 ||
+            mmkv->actualSize() > 1024 || mmkv->getInt32("overridden") != 1) {
+            abort();
+        }
+        mmkv->close();
+        mmkv = MMKV::mmkvWithID(mmapID);
+        string result;
+        if (!mmkv->getString("compressed", result) || result != compressible || !mmkv->getString("blob", result) ||
+            result != big) {
+            abort();
+        }
+    }
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    // not for encrypted instances
+    string cryptKey = "bulk";
+    mmkv = MMKV::mmkvWithID(mmapID, MMKV_SINGLE_PROCESS, &cryptKey);
+    mmkv->set(1, "key");
+    {
+        MMKV::BulkBuilder builder(mmapID);
+        builder.set(2, "key");
+        if (builder.commit() || mmkv->getInt32("key") != 1 || mmkv->count() != 1) {
+            abort();
+        }
+    }
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    // large enough to extend the file
+    const int largeCount = 200000;
+    {
+        MMKV::BulkBuilder builder(mmapID);
+        for (int i = 0; i < largeCount; i++) {
+            builder.set(i, "key" + to_string(i));
+        }
+        if (!builder.commit()) {
+            abort();
+        }
+    }
+    mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->close();
+    mmkv = MMKV::mmkvWithID(mmapID);
+    if (mmkv->count() != largeCount) {
+        abort();
+    }
+    for (int i = 0; i < largeCount; i++) {
+        if (mmkv->getInt32("key" + to_string(i), -1) != i) {
+            abort();
+        }
+    }
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+    printf("testBulkBuilder passed\n");
+}
+
+void testBulkBuilderSpeed() {
+    string mmapID = "testBulkBuilderSpeed";
+    const int keyCount = 1000000;
+    vector<string> keys;
+    for (int i = 0; i < keyCount; i++) {
+        keys.push_back("import.record" + to_string(i));
+    }
+    auto mmkv = MMKV::mmkvWithID(mmapID);
+    mmkv->clearAll();
+    mmkv->trim();
+    auto start = getTimeInMs();
+    for (int i = 0; i < keyCount; i++) {
+        mmkv->set(i, keys[i]);
+        mmkv->set("value of " + keys[i], keys[i] + ".name");
+    }
+    auto setTime = getTimeInMs() - start;
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+
+    start = getTimeInMs();
+    {
+        MMKV::BulkBuilder builder(mmapID);
+        builder.reserve(keyCount * 2, keyCount * 64);
+        for (int i = 0; i < keyCount; i++) {
+            builder.set(i, keys[i]);
+            builder.set("value of " + keys[i], keys[i] + ".name");
+        }
+        builder.commit();
+    }
+    auto bulkTime = getTimeInMs() - start;
+    mmkv = MMKV::mmkvWithID(mmapID);
+    printf("%d keys: set %lld ms, bulk builder %lld ms, count %zu\n", keyCount * 2, (long long) setTime,
+           (long long) bulkTime, mmkv->count());
+    mmkv->close();
+    MMKV::removeStorage(mmapID);
+}
+
 void MyLogHandler(MMKVLogLevel level, const char *file, int line, const char *function, const string &message) {
 
     auto desc = [level] {
@@ -1323,4 +3858,45 @@ int main() {
 //    testFtruncateFail();
     testRemoveStorage();
     testReadOnly();
+    testLoadFromSnapshot();
+    testParallelDecode();
+    testEnumerate();
+//    testEnumerateSpeed();
+    testScanPrefix();
+//    testScanPrefixSpeed();
+    testExpireIndex();
+    testExpireReaper();
+    testIncrement();
+//    testIncrementSpeed();
+    testCompareAndSet();
+    testList();
+//    testListSpeed();
+//    testVectorSpeed();
+//    testVarintDecodeSpeed();
+//    testSmallVectorSetSpeed();
+//    testLargeVectorSetSpeed();
+//    testCompressionSpeed();
+//    testBlobStorageSpeed();
+    testMemoryStats();
+    testMemoryBudget();
+    testNamespace();
+    testAsyncOpen();
+    testInstanceHandle();
+    testWriteBehind();
+    testFixedWidthVector();
+    testVarintVector();
+    testTryDecode();
+    testEncodeArena();
+    testDirectEncode();
+    testCompression();
+    testBlobStorage();
+    testKeyReference();
+//    testKeyReferenceSpeed();
+    testFrozen();
+//    testFrozenSpeed();
+    testBulkBuilder();
+//    testBulkBuilderSpeed();
+//    testSnapshotLoadSpeed();
+    // keep it last, onExit() closes every instance
+    testAsyncOpenAfterExit();
 }